@@ -0,0 +1,325 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// Load generator for Modbus TCP servers.
+//
+// Usage: modbus-bench [options] [host] [port]
+//
+//   --serve             Start built-in server (TCP::Server serving a register
+//                       bank) on the port and benchmark it over loopback
+//   --connections N     Number of connections (1)
+//   --depth N           Requests in flight per connection (1)
+//   --mix FC:W,...      Function codes with weights, e.g. 3:80,16:20 (3:1)
+//   --count N           Registers / coils per request (10)
+//   --unit ID           Unit id (1)
+//   --address A         Starting address (0)
+//   --duration S        Duration in seconds (10)
+//   --rate R            Total requests per second, 0 for closed loop (0)
+//
+// In closed loop every connection sends next request as soon as one of its
+// requests is answered. In open loop (--rate) requests are scheduled at fixed
+// intervals and latency is measured from the scheduled time, so that a stalled
+// server is not hidden by the generator waiting for it (coordinated omission).
+
+#include "MB/TCP/connection.hpp"
+#include "MB/TCP/server.hpp"
+#include "MB/concurrentRegisterBank.hpp"
+#include "MB/mbap.hpp"
+#include "MB/metrics.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/requestDispatcher.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port         = 502;
+    bool serve       = false;
+    int connections  = 1;
+    int depth        = 1;
+    uint16_t count   = 10;
+    uint8_t unit     = 1;
+    uint16_t address = 0;
+    double duration  = 10;
+    double rate      = 0;
+    //! Function codes with their weights
+    std::vector<std::pair<MB::utils::MBFunctionCode, double>> mix = {
+        {MB::utils::ReadAnalogOutputHoldingRegisters, 1}};
+};
+
+struct Results {
+    MB::LatencyHistogram latency;
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> exceptions{0};
+    std::atomic<uint64_t> unanswered{0};
+};
+
+// Request of the function code (unit id and PDU), as defined by the options
+std::vector<uint8_t> requestFor(MB::utils::MBFunctionCode code, const Options &options) {
+    const bool single = code == MB::utils::WriteSingleDiscreteOutputCoil ||
+                        code == MB::utils::WriteSingleAnalogOutputRegister;
+    const uint16_t count = single ? 1 : options.count;
+
+    std::vector<MB::ModbusCell> values;
+    if (code == MB::utils::WriteSingleDiscreteOutputCoil ||
+        code == MB::utils::WriteMultipleDiscreteOutputCoils)
+        values.assign(count, MB::ModbusCell::initCoil(true));
+    if (code == MB::utils::WriteSingleAnalogOutputRegister ||
+        code == MB::utils::WriteMultipleAnalogOutputHoldingRegisters)
+        values.assign(count, MB::ModbusCell::initReg(0x1234));
+
+    return MB::ModbusRequest(options.unit, code, options.address, count, values).toRaw();
+}
+
+void runConnection(const Options &options, Results &results, Clock::time_point end,
+                   unsigned seed) {
+    auto connection = MB::TCP::Connection::with(options.host, options.port);
+    const int fd    = connection.getSockfd();
+
+    // Frames are prepared once, only transaction id is changed
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<double> weights;
+    for (const auto &[code, weight] : options.mix) {
+        frames.push_back(MB::MBAP::wrap(0, requestFor(code, options)));
+        weights.push_back(weight);
+    }
+    std::mt19937 random(seed);
+    std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+
+    // Every connection gets its share of the total rate, closed loop has no period
+    const bool openLoop = options.rate > 0;
+    auto interval       = Clock::duration::zero();
+    if (openLoop) {
+        const std::chrono::duration<double> period(options.connections / options.rate);
+        interval = std::chrono::duration_cast<Clock::duration>(period);
+    }
+    auto nextSend = Clock::now();
+
+    std::vector<Clock::time_point> sent(65536);
+    uint16_t transactionId = 0;
+    int inFlight           = 0;
+    MB::MBAP::Deframer deframer;
+
+    const auto send = [&](Clock::time_point intended) {
+        auto &frame = frames[pick(random)];
+        frame[0]    = static_cast<uint8_t>(transactionId >> 8);
+        frame[1]    = static_cast<uint8_t>(transactionId);
+        sent[transactionId++] = intended;
+        ::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL);
+        inFlight++;
+    };
+
+    // After the end, requests in flight get one more second to be answered
+    const auto drainEnd = end + std::chrono::seconds(1);
+
+    while (true) {
+        auto now = Clock::now();
+        if (now >= end && (inFlight == 0 || now >= drainEnd))
+            break;
+
+        while (now < end && inFlight < options.depth && (!openLoop || nextSend <= now)) {
+            if (openLoop) {
+                send(nextSend);
+                nextSend += interval;
+            } else {
+                send(now);
+            }
+        }
+
+        // Wait for responses, in open loop only until next scheduled request
+        auto wait = std::chrono::milliseconds(100);
+        if (openLoop && inFlight < options.depth && now < end)
+            wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextSend - now);
+
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, static_cast<int>(std::max<long long>(wait.count(), 0))) <= 0)
+            continue;
+
+        uint8_t buffer[4096];
+        const auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (size <= 0) {
+            std::cerr << "Connection closed by the server\n";
+            break;
+        }
+
+        now = Clock::now();
+        deframer.append(buffer, static_cast<std::size_t>(size));
+        while (auto frame = deframer.next()) {
+            const auto id      = MB::MBAP::parseHeader(frame->data()).transactionId;
+            const auto latency = now - sent[id];
+            results.latency.record(
+                std::chrono::duration_cast<MB::LatencyHistogram::Duration>(latency));
+            results.completed.fetch_add(1, std::memory_order_relaxed);
+            if (frame->size() > 7 && ((*frame)[7] & 0x80) != 0)
+                results.exceptions.fetch_add(1, std::memory_order_relaxed);
+            inFlight--;
+        }
+    }
+
+    results.unanswered.fetch_add(inFlight, std::memory_order_relaxed);
+}
+
+// Serves every connection in its own thread, requests may be pipelined
+void serve(int port) {
+    static MB::ConcurrentRegisterBank bank(10000, 10000, 10000, 10000);
+    static MB::RequestDispatcher dispatcher;
+    dispatcher.serve(bank);
+
+    static MB::TCP::Server server(port);
+    std::thread([]() {
+        while (auto connection = server.awaitConnection()) {
+            std::thread([connection = std::move(*connection)]() {
+                const int fd = connection.getSockfd();
+                MB::MBAP::Deframer deframer;
+                uint8_t buffer[4096];
+
+                while (true) {
+                    const auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+                    if (size <= 0)
+                        return;
+
+                    deframer.append(buffer, static_cast<std::size_t>(size));
+                    std::vector<uint8_t> out;
+                    while (auto frame = deframer.next()) {
+                        const auto header = MB::MBAP::parseHeader(frame->data());
+                        const std::vector<uint8_t> request(frame->begin() + 6,
+                                                           frame->end());
+                        const auto response = MB::MBAP::wrap(
+                            header.transactionId, dispatcher.dispatchRaw(request));
+                        out.insert(out.end(), response.begin(), response.end());
+                    }
+                    ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+                }
+            }).detach();
+        }
+    }).detach();
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--serve") {
+            options.serve = true;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+
+        const std::string value = argv[++i];
+        if (arg == "--connections") {
+            options.connections = std::stoi(value);
+        } else if (arg == "--depth") {
+            options.depth = std::stoi(value);
+        } else if (arg == "--count") {
+            options.count = static_cast<uint16_t>(std::stoi(value));
+        } else if (arg == "--unit") {
+            options.unit = static_cast<uint8_t>(std::stoi(value));
+        } else if (arg == "--address") {
+            options.address = static_cast<uint16_t>(std::stoi(value));
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else if (arg == "--rate") {
+            options.rate = std::stod(value);
+        } else if (arg == "--mix") {
+            options.mix.clear();
+            std::stringstream entries(value);
+            std::string entry;
+            while (std::getline(entries, entry, ',')) {
+                const auto colon = entry.find(':');
+                const auto code  = std::stoi(entry.substr(0, colon));
+                const auto weight =
+                    colon == std::string::npos ? 1.0 : std::stod(entry.substr(colon + 1));
+                options.mix.emplace_back(static_cast<MB::utils::MBFunctionCode>(code),
+                                         weight);
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (positional.size() > 0)
+        options.host = positional[0];
+    if (positional.size() > 1)
+        options.port = std::stoi(positional[1]);
+
+    return options.connections > 0 && options.depth > 0 && !options.mix.empty();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--serve] [--connections N] [--depth N]"
+                      << " [--mix FC:W,...] [--count N] [--unit ID] [--address A]"
+                      << " [--duration S] [--rate R] [host] [port]\n";
+            return 1;
+        }
+        if (options.serve)
+            serve(options.port);
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+
+    Results results;
+    const auto start = Clock::now();
+    const auto end   = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(options.duration));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.connections; i++) {
+        threads.emplace_back([&options, &results, end, i]() {
+            try {
+                runConnection(options, results, end, static_cast<unsigned>(i));
+            } catch (const std::exception &ex) {
+                std::cerr << "Connection " << i << ": " << ex.what() << "\n";
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const auto elapsed = std::chrono::duration<double>(end - start).count();
+    const auto latency = results.latency.snapshot();
+    const auto millis  = [](MB::LatencyHistogram::Duration value) {
+        return static_cast<double>(value.count()) / 1000.0;
+    };
+
+    std::cout << "connections " << options.connections << ", depth " << options.depth
+              << (options.rate > 0 ? ", open loop" : ", closed loop") << "\n"
+              << "completed   " << results.completed << " ("
+              << static_cast<double>(results.completed) / elapsed << " req/s)\n"
+              << "exceptions  " << results.exceptions << "\n"
+              << "unanswered  " << results.unanswered << "\n"
+              << "latency ms  mean " << millis(latency.mean()) << ", p50 "
+              << millis(latency.percentile(0.5)) << ", p99 "
+              << millis(latency.percentile(0.99)) << ", p999 "
+              << millis(latency.percentile(0.999)) << ", max " << millis(latency.max)
+              << "\n";
+
+    return results.completed > 0 ? 0 : 1;
+}
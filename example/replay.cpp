@@ -0,0 +1,175 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// Replays requests from a capture (see MB::PcapWriter) against a Modbus TCP
+// server, keeping the original timing (optionally accelerated).
+//
+// Usage: modbus-replay <capture.pcap> <host> <port> [speed] [captured server port]
+//
+// Speed 1 keeps original timing, 10 replays ten times faster, 0 sends as fast
+// as possible. From Modbus TCP captures, every client connection is replayed
+// over its own connection. Requests of Modbus RTU captures are converted to
+// Modbus TCP and replayed over a single connection.
+
+#include "MB/TCP/connection.hpp"
+#include "MB/mbap.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/pcap.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+    MB::PcapWriter::Clock::time_point timestamp;
+    //! Original client, requests of every client use separate connection
+    MB::PcapEndpoint client;
+    std::vector<uint8_t> frame;
+};
+
+struct Client {
+    MB::TCP::Connection connection;
+    MB::MBAP::Deframer deframer;
+};
+
+std::vector<Request> loadRequests(MB::PcapReader &reader, uint16_t serverPort) {
+    std::vector<Request> requests;
+    std::vector<uint8_t> previous;
+    uint16_t transactionId = 0;
+
+    while (auto packet = reader.next()) {
+        if (reader.linkType() == MB::PcapLinkType::Raw) {
+            auto segment = MB::PcapReader::tcpPayload(packet->data);
+            if (segment && segment->to.port == serverPort && !segment->payload.empty())
+                requests.push_back({packet->timestamp, segment->from, segment->payload});
+            continue;
+        }
+
+        // RTU: responses of writes echo the request, so repeated frame is skipped,
+        // but only once - the same write may be repeated after its echo
+        auto frame = std::move(packet->data);
+        if (frame == previous) {
+            previous.clear();
+            continue;
+        }
+        previous = frame;
+
+        try {
+            MB::ModbusRequest::fromRawCRC(frame);
+        } catch (const MB::ModbusException &) {
+            continue; // Response or garbage
+        }
+
+        frame.resize(frame.size() - 2); // CRC
+        auto wrapped = MB::MBAP::wrap(transactionId++, frame);
+        requests.push_back({packet->timestamp, {}, std::move(wrapped)});
+    }
+
+    return requests;
+}
+
+// Reads everything that is available (or arrives within timeout), returns
+// number of complete responses
+std::size_t readResponses(Client &client, int timeout) {
+    std::size_t responses = 0;
+    pollfd pfd{client.connection.getSockfd(), POLLIN, 0};
+
+    while (::poll(&pfd, 1, timeout) > 0) {
+        uint8_t buffer[1024];
+        const auto size = ::recv(pfd.fd, buffer, sizeof(buffer), 0);
+        if (size <= 0)
+            break;
+
+        client.deframer.append(buffer, static_cast<std::size_t>(size));
+        while (client.deframer.next()) {
+            responses++;
+        }
+    }
+
+    return responses;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <capture.pcap> <host> <port> [speed] [captured server port]\n";
+        return 1;
+    }
+
+    const std::string host      = argv[2];
+    const int port              = std::stoi(argv[3]);
+    const double speed          = argc > 4 ? std::stod(argv[4]) : 1.0;
+    const uint16_t capturedPort = argc > 5 ? std::stoi(argv[5]) : 502;
+
+    std::vector<Request> requests;
+    try {
+        MB::PcapReader reader(argv[1]);
+        requests = loadRequests(reader, capturedPort);
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+
+    if (requests.empty()) {
+        std::cerr << "No requests found in the capture\n";
+        return 1;
+    }
+
+    std::map<MB::PcapEndpoint, Client> clients;
+    std::size_t responses = 0;
+    Clock::duration maxLag{0};
+
+    const auto start = Clock::now();
+    const auto first = requests.front().timestamp;
+
+    for (const auto &request : requests) {
+        if (speed > 0) {
+            const auto offset = std::chrono::duration_cast<Clock::duration>(
+                (request.timestamp - first) / speed);
+            std::this_thread::sleep_until(start + offset);
+            maxLag = std::max(maxLag, Clock::now() - (start + offset));
+        }
+
+        auto client = clients.find(request.client);
+        if (client == clients.end()) {
+            try {
+                client = clients
+                             .emplace(request.client,
+                                      Client{MB::TCP::Connection::with(host, port), {}})
+                             .first;
+            } catch (const std::exception &ex) {
+                std::cerr << ex.what() << "\n";
+                return 1;
+            }
+        }
+
+        ::send(client->second.connection.getSockfd(), request.frame.data(),
+               request.frame.size(), MSG_NOSIGNAL);
+        responses += readResponses(client->second, 0);
+    }
+
+    // Give the server a moment to answer the last requests
+    for (auto &[endpoint, client] : clients) {
+        responses += readResponses(client, 1000);
+    }
+
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Replayed " << requests.size() << " requests over " << clients.size()
+              << " connections in " << elapsed << " s, received " << responses
+              << " responses, max lag "
+              << std::chrono::duration_cast<std::chrono::microseconds>(maxLag).count()
+              << " us\n";
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// Throughput benchmark of the Modbus RTU master.
+//
+// Usage: modbus-rtu-bench [options] [port]
+//
+//   --baud B            Baud rate (19200)
+//   --units N           Slaves polled in turn, unit ids 1 - N (1)
+//   --count N           Registers per request (10)
+//   --duration S        Duration in seconds (10)
+//   --timeout MS        Response timeout in milliseconds (100)
+//
+// Without the port, slaves are served by built-in Serial::Server on the other
+// end of a virtual line (pseudo terminals), which delays every byte by its
+// time on a real line with the baud rate. With the port, real slaves are
+// polled. Holding registers are read in closed loop, one request at a time.
+
+#include "MB/Serial/busMaster.hpp"
+#include "MB/Serial/server.hpp"
+#include "MB/Serial/virtualLink.hpp"
+#include "MB/metrics.hpp"
+#include "MB/registerBank.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string port;
+    unsigned int baud = 19200;
+    int units         = 1;
+    uint16_t count    = 10;
+    double duration   = 10;
+    int timeout       = 100;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            options.port = arg;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+
+        const std::string value = argv[++i];
+        if (arg == "--baud") {
+            options.baud = static_cast<unsigned int>(std::stoul(value));
+        } else if (arg == "--units") {
+            options.units = std::stoi(value);
+        } else if (arg == "--count") {
+            options.count = static_cast<uint16_t>(std::stoi(value));
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else if (arg == "--timeout") {
+            options.timeout = std::stoi(value);
+        } else {
+            return false;
+        }
+    }
+
+    return options.baud > 0 && options.units > 0 && options.units <= 247 &&
+           options.count > 0 && options.count <= 125;
+}
+
+MB::Serial::Connection open(const std::string &path, const Options &options) {
+    MB::Serial::Connection connection(path);
+    connection.setBaudRate(options.baud);
+    connection.setTimeout(options.timeout);
+    connection.connect();
+    return MB::Serial::Connection(std::move(connection));
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--baud B] [--units N] [--count N] [--duration S]"
+                  << " [--timeout MS] [port]\n";
+        return 1;
+    }
+
+    std::unique_ptr<MB::Serial::VirtualLink> link;
+    std::unique_ptr<MB::Serial::Server> server;
+    std::vector<std::unique_ptr<MB::RegisterBank>> banks;
+    std::thread serving;
+    std::optional<MB::Serial::BusMaster> master;
+
+    try {
+        if (options.port.empty()) {
+            link   = std::make_unique<MB::Serial::VirtualLink>(options.baud);
+            server = std::make_unique<MB::Serial::Server>(open(link->second(), options));
+            for (int unit = 1; unit <= options.units; unit++) {
+                banks.push_back(
+                    std::make_unique<MB::RegisterBank>(0, 0, options.count, 0));
+                server->addUnit(static_cast<uint8_t>(unit), *banks.back());
+            }
+            serving = std::thread([&server]() { server->run(); });
+        }
+
+        const auto port = options.port.empty() ? link->first() : options.port;
+        master.emplace(open(port, options), options.baud);
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+
+    std::vector<MB::ModbusRequest> requests;
+    for (int unit = 1; unit <= options.units; unit++) {
+        requests.emplace_back(static_cast<uint8_t>(unit),
+                              MB::utils::ReadAnalogOutputHoldingRegisters, 0,
+                              options.count);
+    }
+
+    MB::LatencyHistogram latency;
+    uint64_t completed = 0;
+    uint64_t failed    = 0;
+    const auto start   = Clock::now();
+    const auto end     = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(options.duration));
+
+    for (std::size_t next = 0; Clock::now() < end; next = (next + 1) % requests.size()) {
+        const auto sent = Clock::now();
+        try {
+            (void)master->transact(requests[next]);
+            latency.record(std::chrono::duration_cast<MB::LatencyHistogram::Duration>(
+                Clock::now() - sent));
+            completed++;
+        } catch (const MB::ModbusException &) {
+            failed++;
+        }
+    }
+
+    if (server) {
+        server->stop();
+        serving.join();
+    }
+
+    const auto elapsed  = std::chrono::duration<double>(Clock::now() - start).count();
+    const auto snapshot = latency.snapshot();
+    const auto bus      = master->stats();
+    const auto millis   = [](MB::LatencyHistogram::Duration value) {
+        return static_cast<double>(value.count()) / 1000.0;
+    };
+
+    // Best case: both frames and the silence before every request
+    const auto request   = 8.0;
+    const auto response  = 5.0 + 2.0 * options.count;
+    const auto character = 11.0 / options.baud;
+    const auto gap       = std::chrono::duration<double>(
+                         MB::RTU::Timing::forBaudRate(options.baud).interFrame)
+                         .count();
+    const auto limit = 1.0 / ((request + response) * character + gap);
+
+    std::cout << (options.port.empty() ? "virtual line" : options.port) << ", "
+              << options.baud << " baud, " << options.units << " unit(s), "
+              << options.count << " register(s)\n"
+              << "completed   " << completed << " (" << completed / elapsed
+              << " tx/s, line limit " << limit << " tx/s)\n"
+              << "failed      " << failed << "\n"
+              << "latency ms  mean " << millis(snapshot.mean()) << ", p50 "
+              << millis(snapshot.percentile(0.5)) << ", p99 "
+              << millis(snapshot.percentile(0.99)) << ", max " << millis(snapshot.max)
+              << "\n"
+              << "bus         utilization " << bus.utilization() * 100 << "%, occupancy "
+              << bus.occupancy() * 100 << "%\n";
+
+    return completed > 0 ? 0 : 1;
+}
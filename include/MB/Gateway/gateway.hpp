@@ -0,0 +1,192 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "MB/Serial/connection.hpp"
+#include "MB/TCP/connection.hpp"
+#include "MB/TCP/server.hpp"
+#include "MB/requestQueue.hpp"
+#include "MB/responseCache.hpp"
+#include "MB/rtuBus.hpp"
+
+namespace MB::Gateway {
+/**
+ * @brief Modbus TCP to Modbus RTU gateway.
+ *
+ * Accepts MBAP frames from any number of TCP clients and forwards them to the
+ * serial ports, selected by the unit id. Every serial port has its own queue
+ * and worker, which serves the clients in round robin and starts next
+ * transaction as soon as previous one is finished.
+ *
+ * Responses are sent back to the client that asked, with the original
+ * transaction id. If the slave does not respond (or its response is corrupted),
+ * client receives GatewayTargetDeviceFailedToRespond exception and requests for
+ * unit ids without port are answered with GatewayPathUnavailable.
+ * Broadcasts (unit id 0) are forwarded to all ports and are not answered.
+ * Requests keep the inter-frame gap of the line and the turnaround delay after
+ * broadcasts (see setTurnaround()).
+ *
+ * Requests wait for the bus in priority classes: writes are queued as High,
+ * reads as Normal, unless configured otherwise per unit (see setReadPriority()).
+ *
+ * Identical reads (same unit, function code, address and count) that arrive
+ * while one of them is still queued or on the bus share a single transaction,
+ * unless a write of the overlapping range came in between.
+ * Optionally, read responses may be cached for a short time (see setCacheTtl()),
+ * writes invalidate cached reads of the overlapping range.
+ */
+class Gateway {
+  private:
+    struct Session {
+        TCP::Connection connection;
+        std::size_t id;
+        std::mutex writeMutex;
+        std::atomic<bool> closed{false};
+        std::thread reader;
+
+        Session(TCP::Connection &&connection, std::size_t id)
+            : connection(std::move(connection)), id(id) {}
+    };
+
+    struct Client {
+        std::shared_ptr<Session> session;
+        uint16_t transactionId;
+    };
+
+    //! Clients waiting for the same read
+    using Readers = std::shared_ptr<std::vector<Client>>;
+
+    struct Job {
+        Client client;
+        //! Unit id and PDU, without CRC
+        std::vector<uint8_t> request;
+        //! Set for reads
+        std::optional<ResponseCache::Key> key;
+        //! Clients of the read, shared with _inFlight until a write detaches it
+        Readers readers;
+    };
+
+    struct Port {
+        Serial::Connection connection;
+        //! Used only by the worker
+        RTU::BusSchedule schedule;
+        RequestQueue<Job> queue;
+        std::thread worker;
+
+        Port(Serial::Connection &&connection, unsigned int baudRate)
+            : connection(std::move(connection)), schedule(baudRate) {}
+    };
+
+    static constexpr int NoPort = -1;
+    //! Pause after failed accept
+    static constexpr std::chrono::milliseconds AcceptBackoff{100};
+
+    TCP::Server _server;
+    std::vector<std::unique_ptr<Port>> _ports;
+    std::array<int, 256> _routes;
+    std::array<RequestPriority, 256> _readPriorities;
+
+    std::atomic<bool> _stopped{false};
+    std::mutex _sessionsMutex;
+    std::vector<std::shared_ptr<Session>> _sessions;
+    std::size_t _nextSessionId = 0;
+
+    ResponseCache _cache;
+    // Guards the reads in flight, together with the cache lookups and updates
+    std::mutex _inFlightMutex;
+    std::unordered_map<ResponseCache::Key, Readers, ResponseCache::KeyHash> _inFlight;
+
+    void serveSession(const std::shared_ptr<Session> &session);
+    void serveFrame(const std::shared_ptr<Session> &session,
+                    const std::vector<uint8_t> &frame);
+    void servePort(Port &port);
+    void enqueue(int port, Client client, std::vector<uint8_t> &&request);
+    void complete(const Job &job, const std::vector<uint8_t> &response);
+    void invalidate(const std::vector<uint8_t> &request);
+    std::vector<uint8_t> transact(Port &port, const std::vector<uint8_t> &request);
+    void reply(Session &session, uint16_t transactionId,
+               const std::vector<uint8_t> &response);
+    void reapSessions();
+
+  public:
+    /**
+     * @brief Creates gateway listening on the given TCP port.
+     * @param port - TCP port, 0 lets the system choose a free one (see port()).
+     * @throws std::runtime_error - if server socket cannot be created.
+     */
+    explicit Gateway(int port);
+    ~Gateway();
+
+    Gateway(const Gateway &)            = delete;
+    Gateway &operator=(const Gateway &) = delete;
+
+    //! TCP port the gateway listens on
+    [[nodiscard]] int port() const { return _server.port(); }
+
+    /**
+     * @brief Adds serial port serving given unit ids.
+     * @param connection - Configured and connected serial connection, its timeout
+     * decides when the slave is considered as not responding.
+     * @param unitIds - Unit ids of the slaves connected to this port.
+     * @param baudRate - Baud rate of the connection, used for the bus timing.
+     * @note Ports have to be added before calling run().
+     */
+    void addPort(Serial::Connection &&connection, const std::vector<uint8_t> &unitIds,
+                 unsigned int baudRate);
+
+    /**
+     * @brief Sets silence after broadcasts on the port.
+     * @param port - Index of the port, in order of addPort() calls.
+     * @note Has to be called before calling run().
+     */
+    void setTurnaround(std::size_t port, std::chrono::microseconds turnaround) {
+        _ports.at(port)->schedule.setTurnaround(turnaround);
+    }
+
+    /**
+     * @brief Enables caching of read responses from all units.
+     * @param ttl - How long response stays valid, 0 disables the cache.
+     */
+    void setCacheTtl(std::chrono::milliseconds ttl) { _cache.setTtl(ttl); }
+
+    //! Overrides cache time to live for the given unit, 0 disables the cache
+    void setCacheTtl(uint8_t unitId, std::chrono::milliseconds ttl) {
+        _cache.setTtl(unitId, ttl);
+    }
+
+    /**
+     * @brief Sets priority class of reads from the given unit (Normal by default).
+     * @note Has to be called before calling run().
+     */
+    void setReadPriority(uint8_t unitId, RequestPriority priority) {
+        _readPriorities[unitId] = priority;
+    }
+
+    /**
+     * @brief Queueing statistics of the serial port.
+     * @param port - Index of the port, in order of addPort() calls.
+     * @param priority - Priority class.
+     */
+    [[nodiscard]] RequestQueueStats queueStats(std::size_t port,
+                                               RequestPriority priority) const;
+
+    //! Accepts clients and forwards their requests, blocks until stop() is called
+    void run();
+
+    //! Stops the gateway, can be called from any thread
+    void stop();
+};
+} // namespace MB::Gateway
@@ -0,0 +1,156 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "MB/mbap.hpp"
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/spscQueue.hpp"
+
+namespace MB::Loopback {
+//! Impairments of a single direction of the link
+struct Profile {
+    //! Delay of every frame
+    std::chrono::microseconds latency{0};
+    //! Uniformly distributed extra delay, order of bytes is always kept
+    std::chrono::microseconds jitter{0};
+    //! Frames are split into random segments of 1..maxSegment bytes, 0 disables it
+    std::size_t maxSegment = 0;
+    //! Probability (0 to 1) that a whole frame is lost
+    double loss = 0;
+    //! Seed of the random generator, so that runs are repeatable
+    uint32_t seed = 1;
+};
+
+/**
+ * @brief In process connection with the same interface as TCP::Connection.
+ *
+ * Both ends of a pair exchange Modbus TCP (MBAP) frames through two lock free
+ * single producer / single consumer queues, so every end may be used by one
+ * sending and one receiving thread at a time (usually the same one). Frames
+ * may be delayed, split and lost according to the profile of the direction.
+ *
+ * As with TCP::Connection, requests may be pipelined and stale responses (e.g.
+ * to requests that timed out) are skipped while waiting for the response.
+ */
+class Connection {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static const unsigned int DefaultTimeout = 500;
+
+  private:
+    struct Segment {
+        Clock::time_point deliverAt;
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Direction {
+        SpscQueue<Segment> queue;
+        Profile profile;
+        // Used by the sending end only
+        std::mt19937 random;
+        Clock::time_point lastDelivery;
+
+        Direction(std::size_t capacity, const Profile &impairments)
+            : queue(capacity), profile(impairments), random(impairments.seed) {}
+    };
+
+    std::shared_ptr<Direction> _out;
+    std::shared_ptr<Direction> _in;
+    MBAP::Deframer _deframer;
+    // Id of the last sent (or received) request
+    uint16_t _messageID = 0;
+    // Id of the next sent request
+    uint16_t _nextID = 0;
+    int _timeout     = Connection::DefaultTimeout;
+    // Transaction ids of the requests waiting for their responses
+    std::set<uint16_t> _outstanding;
+    // Responses that arrived before they were awaited
+    std::map<uint16_t, std::vector<uint8_t>> _early;
+
+    void write(const std::vector<uint8_t> &frame);
+    // Returns whole frame (with MBAP header), throws Timeout after the deadline
+    std::vector<uint8_t> read(Clock::time_point deadline);
+
+  public:
+    Connection() = default;
+
+    Connection(const Connection &)            = delete;
+    Connection &operator=(const Connection &) = delete;
+    Connection(Connection &&)                 = default;
+    Connection &operator=(Connection &&)      = default;
+
+    /**
+     * @brief Creates connected pair of ends.
+     * @param clientToServer - Impairments of frames sent by the first end.
+     * @param serverToClient - Impairments of frames sent by the second end.
+     * @param capacity - Segments buffered per direction, power of two.
+     */
+    static std::pair<Connection, Connection> pair(const Profile &clientToServer = {},
+                                                  const Profile &serverToClient = {},
+                                                  std::size_t capacity = 4096);
+
+    std::vector<uint8_t> sendRequest(const MB::ModbusRequest &req);
+    std::vector<uint8_t> sendResponse(const MB::ModbusResponse &res);
+    std::vector<uint8_t> sendException(const MB::ModbusException &ex);
+
+    /**
+     * @brief Waits for next frame.
+     * @return Whole frame, including MBAP header.
+     * @throws ModbusException - Timeout if nothing arrived in time.
+     */
+    [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
+
+    /**
+     * @brief Waits for the request, its transaction id is used by following
+     * responses.
+     * @throws ModbusException - Timeout or parsing error.
+     */
+    [[nodiscard]] MB::ModbusRequest awaitRequest();
+
+    /**
+     * @brief Waits for the response to the last sent request.
+     * @throws ModbusException - Timeout, parsing error or exception response.
+     */
+    [[nodiscard]] MB::ModbusResponse awaitResponse() { return awaitResponse(_messageID); }
+
+    /**
+     * @brief Waits for the response with the given transaction id, responses to
+     * other requests in flight are kept until they are awaited.
+     * @throws ModbusException - Timeout, parsing error or exception response.
+     */
+    [[nodiscard]] MB::ModbusResponse awaitResponse(uint16_t transactionId);
+
+    //! Response to the request will not be awaited, it is dropped when it arrives
+    void forgetResponse(uint16_t transactionId);
+
+    //! Transaction id of the last sent (or received) request
+    [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
+
+    //! Next request is sent with this id, following ones count up from it.
+    //! Until next request arrives, responses are sent with it too.
+    void setMessageId(uint16_t messageId) {
+        _messageID = messageId;
+        _nextID    = messageId;
+    }
+
+    //! Timeout of await methods in milliseconds
+    void setTimeout(int timeout) { _timeout = timeout; }
+
+    [[nodiscard]] int getTimeout() const { return _timeout; }
+};
+} // namespace MB::Loopback
@@ -0,0 +1,85 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <variant>
+#include <vector>
+
+#include "MB/Serial/connection.hpp"
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/rtuBus.hpp"
+
+namespace MB::Serial {
+/**
+ * @brief Master of a multi-drop (RS-485) bus with many slaves.
+ *
+ * Owns the serial connection and runs one transaction at a time, from any
+ * number of threads. Before every request the bus is kept silent for the
+ * inter-frame gap (t3.5 by default), after every broadcast for the turnaround
+ * delay. Leftovers of previous transactions are dropped before each request.
+ */
+class BusMaster {
+  public:
+    using Clock = std::chrono::steady_clock;
+    //! Result of a single transaction, monostate for broadcasts
+    using Result = std::variant<std::monostate, ModbusResponse, ModbusException>;
+
+  private:
+    Connection _connection;
+    RTU::BusSchedule _schedule;
+    mutable std::mutex _mutex;
+
+    // Has to be called with the mutex locked
+    void waitForBus();
+
+  public:
+    /**
+     * @brief Takes configured and connected connection.
+     * @param baudRate - Baud rate of the connection, it is used for the timing
+     * and for the framer of the connection.
+     */
+    BusMaster(Connection &&connection, unsigned int baudRate);
+
+    /**
+     * @brief Sends request and waits for the response.
+     * @throws ModbusException - Exception response, timeout or invalid response
+     * (including response from other unit).
+     * @throws std::invalid_argument - if the request is a broadcast.
+     */
+    ModbusResponse transact(const ModbusRequest &request);
+
+    /**
+     * @brief Sends request to all slaves (unit id 0), without waiting for a
+     * response.
+     * @throws std::invalid_argument - if the request is not a write to unit 0.
+     */
+    void broadcast(const ModbusRequest &request);
+
+    /**
+     * @brief Runs transactions one after another, e.g. polling cycle of all
+     * slaves on the bus. Broadcasts are sent with broadcast().
+     * @return Result of every request, in the same order.
+     */
+    std::vector<Result> transactAll(const std::vector<ModbusRequest> &requests);
+
+    //! Silence before every request, at least t3.5
+    void setInterFrameGap(std::chrono::microseconds gap);
+
+    //! Silence after every broadcast, so that slaves process it
+    void setTurnaround(std::chrono::microseconds turnaround);
+
+    //! Bus usage, e.g. to decide how many devices a segment can handle
+    [[nodiscard]] RTU::BusStats stats() const;
+
+    void resetStats();
+
+    //! Underlying connection, e.g. to set its timeout or metrics
+    Connection &connection() { return _connection; }
+};
+} // namespace MB::Serial
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -16,31 +19,102 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "MB/circuitBreaker.hpp"
+#include "MB/metrics.hpp"
 #include "MB/modbusException.hpp"
 #include "MB/modbusRequest.hpp"
 #include "MB/modbusResponse.hpp"
 #include "MB/modbusUtils.hpp"
+#include "MB/pcap.hpp"
+#include "MB/rtuFramer.hpp"
+#include "MB/rttEstimator.hpp"
+#include "MB/trace.hpp"
 
 namespace MB::Serial {
+//! RS-485 transceiver direction control, done by the kernel driver
+struct RS485Options {
+    //! RTS level while sending
+    bool rtsOnSend = true;
+    //! RTS level after sending
+    bool rtsAfterSend = false;
+    //! Delay between RTS change and the first bit
+    std::chrono::milliseconds delayBeforeSend{0};
+    //! Delay between the last bit and RTS change
+    std::chrono::milliseconds delayAfterSend{0};
+    //! Receive own frames while sending, e.g. for collision detection
+    bool receiveDuringSend = false;
+};
+
 class Connection {
   public:
     // Pretty high timeout
     static const unsigned int DefaultSerialTimeout = 100;
+    //! Silence that ends frame received over TCP, network delays are longer than
+    //! gaps of the serial line
+    static constexpr std::chrono::milliseconds DefaultTcpFrameGap{50};
+    //! Shortest silence ending frame received from serial port, as USB adapters
+    //! deliver bytes in packets, after their latency timer
+    static constexpr std::chrono::milliseconds DefaultMinimumFrameGap{5};
 
   private:
     struct termios _termios;
     int _fd;
+    // Socket to a serial to Ethernet converter, instead of a serial port
+    bool _socket = false;
 
     int _timeout = Connection::DefaultSerialTimeout;
+    // Set by connect() through termios2, 0 if standard rate is used
+    unsigned int _customBaudRate = 0;
+    RTU::Framer _framer;
+
+    std::shared_ptr<RttEstimator> _rtt;
+    std::shared_ptr<CircuitBreaker> _breaker;
+    std::shared_ptr<Metrics> _metrics;
+    std::shared_ptr<PcapWriter> _capture;
+    uint8_t _requestUnit = 0;
+    // Size of the response to the last request, 0 if not known
+    std::size_t _expectedSize = 0;
+    std::chrono::steady_clock::time_point _requestSent;
+
+    // Waits for the next complete frame, either until deadline or until nothing
+    // comes for the timeout
+    std::vector<uint8_t> awaitFrame(
+        std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+    // Passes outcome of the transaction to estimator, breaker and metrics
+    void reportOutcome(std::optional<utils::MBErrorCode> error);
+    // Writes frame to the capture, if there is one
+    void capture(const std::vector<uint8_t> &frame);
+    // Adds CRC and writes the frame, without counting it
+    std::vector<uint8_t> sendFrame(std::vector<uint8_t> data);
+    // Rate without B* constant, throws if platform does not support it
+    void setCustomBaudRate(unsigned int baudRate);
 
   public:
-    constexpr explicit Connection() : _termios(), _fd(-1) {}
+    explicit Connection() : _termios(), _fd(-1) {}
     explicit Connection(const std::string &path);
     explicit Connection(const Connection &) = delete;
     explicit Connection(Connection &&) noexcept;
     Connection &operator=(Connection &&);
     ~Connection();
 
+    /**
+     * @brief Connects to a transparent serial to Ethernet converter, which
+     * forwards RTU frames (with CRC) over TCP, without MBAP header.
+     *
+     * Framing, timeouts, expected response sizes and everything else work as
+     * with a serial port, only frames end after DefaultTcpFrameGap of silence
+     * (see getFramer()). Line settings and connect() have no effect.
+     * @param address - IPv4 address of the converter.
+     * @throws std::runtime_error - if connection cannot be established.
+     */
+    static Connection withTcp(const std::string &address, int port);
+
+    //! Takes connected socket carrying RTU frames, e.g. accepted from a converter
+    static Connection fromSocket(int sockfd);
+
+    //! Connection is a socket, not a serial port
+    [[nodiscard]] bool isSocket() const { return _socket; }
+
     void connect();
 
     std::vector<uint8_t> sendRequest(const MB::ModbusRequest &request);
@@ -48,7 +122,25 @@ class Connection {
     std::vector<uint8_t> sendException(const MB::ModbusException &exception);
 
     /**
-     * @brief Sends data through the serial
+     * @brief Sends request that is not known to the library (e.g. with user
+     * defined function code), as sendRequest() does, but the size of its
+     * response is not known.
+     * @param data - Unit id and PDU, without CRC.
+     * @throws ModbusException - CircuitOpen if circuit breaker of the unit is open
+     * @throws std::invalid_argument - if there is no function code.
+     */
+    std::vector<uint8_t> sendRawRequest(std::vector<uint8_t> data);
+
+    /**
+     * @brief Sends response (or exception) produced elsewhere, e.g. by
+     * RequestDispatcher, as sendResponse() does.
+     * @param data - Unit id and PDU, without CRC.
+     * @throws std::invalid_argument - if there is no unit id.
+     */
+    std::vector<uint8_t> sendRawResponse(std::vector<uint8_t> data);
+
+    /**
+     * @brief Sends data through the serial, as it is (with CRC added)
      * @param data - Vectorized data
      */
     std::vector<uint8_t> send(std::vector<uint8_t> data);
@@ -58,6 +150,34 @@ class Connection {
     [[nodiscard]] std::tuple<MB::ModbusResponse, std::vector<uint8_t>> awaitResponse();
     [[nodiscard]] std::tuple<MB::ModbusRequest, std::vector<uint8_t>> awaitRequest();
 
+    /**
+     * @brief Reads available bytes into the framer, for event driven use.
+     * @param timeout - How long to wait for the bytes in ms, 0 does not wait.
+     * @return False if nothing came in time.
+     * @throws ModbusException - SlaveDeviceFailure if port cannot be read.
+     */
+    bool receive(int timeout);
+
+    //! Next complete frame (with CRC) received by receive(), nullopt if none yet
+    [[nodiscard]] std::optional<std::vector<uint8_t>> nextFrame();
+
+    /**
+     * @brief Ends the last sent request, when its response is awaited through
+     * nextFrame() instead of awaitResponse().
+     *
+     * Outcome is passed to the estimator, breaker and metrics, same as by
+     * awaitResponse().
+     * @param error - Error of the transaction, nullopt if response arrived.
+     */
+    void completeRequest(std::optional<utils::MBErrorCode> error) {
+        reportOutcome(error);
+    }
+
+    /**
+     * @brief Waits for the next complete frame.
+     * @return Frame with CRC.
+     * @throws ModbusException - Timeout if no frame came in time.
+     */
     [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
 
     void enableParity(const bool parity) {
@@ -89,7 +209,15 @@ class Connection {
     case s:                                                                              \
         speed = B##s;                                                                    \
         break;
+    /**
+     * @brief Sets baud rate, applied by connect().
+     *
+     * Rates other than standard ones up to 230400 (e.g. 460800, 921600 or
+     * vendor specific ones) are supported only on Linux.
+     * @throws std::runtime_error - if the rate is not supported.
+     */
     void setBaudRate(speed_t speed) {
+        const auto baudRate = speed;
         switch (speed) {
             setBaud(0);
             setBaud(50);
@@ -111,17 +239,88 @@ class Connection {
             setBaud(115200);
             setBaud(230400);
         default:
-            throw std::runtime_error("Invalid baud rate");
+            setCustomBaudRate(baudRate);
+            return;
         }
+        _customBaudRate = 0;
         cfsetospeed(&_termios, speed);
         cfsetispeed(&_termios, speed);
+
+        // Timing of the socket depends on the network, not on the baud rate
+        if (baudRate > 0 && !_socket)
+            _framer.setTiming(RTU::Timing::forBaudRate(baudRate));
     }
 #undef setBaud
 
+    /**
+     * @brief Enables (or with nullopt disables) RS-485 mode of the driver, which
+     * switches transceiver direction with RTS. Applied immediately.
+     * @throws std::runtime_error - if driver does not support it.
+     */
+    void setRS485(const std::optional<RS485Options> &options);
+
+    /**
+     * @brief Sets ASYNC_LOW_LATENCY flag of the driver, so that received bytes
+     * are passed on without buffering delay. Applied immediately.
+     * @throws std::runtime_error - if driver does not support it.
+     */
+    void setLowLatency(bool lowLatency);
+
     termios &getTTY() { return _termios; }
 
+    [[nodiscard]] int getFd() const { return _fd; }
+
+    //! Framer of the received bytes, timing is set by setBaudRate
+    RTU::Framer &getFramer() { return _framer; }
+
     int getTimeout() const { return _timeout; }
 
     void setTimeout(int timeout) { _timeout = timeout; }
+
+    /**
+     * @brief Makes response timeout adapt to the measured response times.
+     *
+     * Every response updates estimate of the unit it came from, every timeout
+     * backs off its timeout. With estimator the timeout covers whole response,
+     * instead of every single read. Passing nullptr restores fixed timeout.
+     */
+    void setRttEstimator(std::shared_ptr<RttEstimator> estimator) {
+        _rtt = std::move(estimator);
+    }
+
+    [[nodiscard]] const std::shared_ptr<RttEstimator> &getRttEstimator() const {
+        return _rtt;
+    }
+
+    /**
+     * @brief Stops sending requests to units that do not respond.
+     *
+     * Outcome of every awaitResponse() is reported to the breaker and request to
+     * the unit with open breaker throws CircuitOpen instead of using the bus.
+     * Passing nullptr disables the breaker.
+     */
+    void setCircuitBreaker(std::shared_ptr<CircuitBreaker> breaker) {
+        _breaker = std::move(breaker);
+    }
+
+    [[nodiscard]] const std::shared_ptr<CircuitBreaker> &getCircuitBreaker() const {
+        return _breaker;
+    }
+
+    //! Collects traffic counters and response times, nullptr disables it
+    void setMetrics(std::shared_ptr<Metrics> metrics) { _metrics = std::move(metrics); }
+
+    [[nodiscard]] const std::shared_ptr<Metrics> &getMetrics() const { return _metrics; }
+
+    /**
+     * @brief Records every sent frame and every received frame, nullptr stops
+     * recording.
+     * @throws std::invalid_argument - if capture does not have user link type.
+     */
+    void setCapture(std::shared_ptr<PcapWriter> capture);
+
+    [[nodiscard]] const std::shared_ptr<PcapWriter> &getCapture() const {
+        return _capture;
+    }
 };
 } // namespace MB::Serial
@@ -0,0 +1,142 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "MB/Serial/busMaster.hpp"
+#include "MB/Serial/connection.hpp"
+#include "MB/rtuBus.hpp"
+#include "MB/timerWheel.hpp"
+
+namespace MB::Serial {
+/**
+ * @brief Drives transactions on many serial ports from a single thread.
+ *
+ * Every port is a bus with its own queue of requests, which are sent one at a
+ * time, in the order they were submitted, with the same timing as BusMaster
+ * (inter-frame gap before each request, turnaround after broadcasts). All
+ * ports are waited for with one epoll instance (poll on other systems), and
+ * all their timeouts (response timeouts, end of frame silences, bus gaps) are
+ * kept in one timer wheel, so a gateway with many ports needs one thread
+ * instead of a thread per port.
+ *
+ * Requests are submitted from any thread; callbacks are called by the thread
+ * running run(), one at a time, so they must not block. They may submit next
+ * requests.
+ */
+class Multiplexer {
+  public:
+    using Clock  = std::chrono::steady_clock;
+    using Result = BusMaster::Result;
+    //! Called with the response, exception (including timeout) or monostate for
+    //! broadcasts
+    using Callback = std::function<void(const Result &)>;
+    using PortId   = std::size_t;
+
+  private:
+    struct Pending {
+        ModbusRequest request;
+        Callback callback;
+    };
+
+    struct Port {
+        Connection connection;
+        RTU::BusSchedule schedule;
+        std::deque<Pending> queue;
+        // Transaction waiting for the response
+        std::optional<Pending> current;
+        Clock::time_point deadline;
+        std::optional<TimerWheel::TimerId> timer;
+        // Port cannot be read anymore (e.g. device was unplugged)
+        bool failed = false;
+
+        Port(Connection &&connection, unsigned int baudRate)
+            : connection(std::move(connection)), schedule(baudRate) {}
+    };
+
+    std::vector<std::unique_ptr<Port>> _ports;
+    TimerWheel _timers;
+    // Guards the ports and the timers, released while waiting and in callbacks
+    mutable std::mutex _mutex;
+
+    int _poll = -1;
+    // Pipe that wakes up run() on submit() and stop()
+    int _wake[2] = {-1, -1};
+    std::atomic<bool> _stopped{false};
+
+    // Finished transactions, their callbacks are called without the lock
+    std::vector<std::pair<Callback, Result>> _completed;
+
+    void closeAll();
+    void wake();
+    void wait(int timeout, std::vector<PortId> &readable);
+
+    // Have to be called with the mutex locked
+    Port &at(PortId id) const;
+    void arm(PortId id, Clock::time_point at);
+    void pump(PortId id, Clock::time_point now);
+    void onReadable(PortId id, Clock::time_point now);
+    void checkResponse(PortId id, Clock::time_point now);
+    void finish(PortId id, Result result, std::size_t responseSize,
+                Clock::time_point now);
+    void fail(PortId id);
+
+  public:
+    /**
+     * @brief Creates multiplexer without ports.
+     * @param tick - Resolution of the timeouts.
+     * @throws std::runtime_error - if epoll instance or pipe cannot be created.
+     */
+    explicit Multiplexer(Clock::duration tick = std::chrono::milliseconds(1));
+    ~Multiplexer();
+
+    Multiplexer(const Multiplexer &)            = delete;
+    Multiplexer &operator=(const Multiplexer &) = delete;
+
+    /**
+     * @brief Adds port, connection has to be configured and connected.
+     * @param baudRate - Baud rate of the connection, used for the bus timing.
+     * Response timeout is the timeout of the connection.
+     * @return Id of the port, used to submit requests.
+     */
+    PortId addPort(Connection &&connection, unsigned int baudRate);
+
+    /**
+     * @brief Queues request on the port, can be called from any thread.
+     *
+     * Requests to unit 0 are broadcasts, which have no response.
+     * @throws std::invalid_argument - if port does not exist or the request is a
+     * broadcast read.
+     */
+    void submit(PortId port, const ModbusRequest &request, Callback callback);
+
+    /**
+     * @brief Serves all ports, blocks until stop() is called.
+     * @throws std::runtime_error - if waiting for the ports fails.
+     */
+    void run();
+
+    //! Stops run(), can be called from any thread
+    void stop();
+
+    //! Number of requests queued on the port, including the one in progress
+    [[nodiscard]] std::size_t pending(PortId port) const;
+
+    //! Usage statistics of the port bus
+    [[nodiscard]] RTU::BusStats stats(PortId port) const;
+
+    //! Sets silence after broadcasts on the port
+    void setTurnaround(PortId port, std::chrono::microseconds turnaround);
+};
+} // namespace MB::Serial
@@ -0,0 +1,100 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "MB/Serial/connection.hpp"
+#include "MB/requestDispatcher.hpp"
+
+namespace MB::Serial {
+/**
+ * @brief Modbus RTU slave answering for several unit ids on one serial port.
+ *
+ * Every unit id has its own dispatcher (e.g. serving its own register bank).
+ * run() is a single threaded event loop, which waits for the bytes or for the
+ * silence that ends the frame and answers every request as soon as it is
+ * complete, so the response time is the handler time.
+ *
+ * Frames for other unit ids (including responses of other slaves on the bus)
+ * are ignored. Broadcasts (unit id 0) are passed to every dispatcher once and
+ * never answered, broadcast reads are ignored.
+ */
+class Server {
+  public:
+    //! Counters of served frames
+    struct Stats {
+        //! Answered requests, including exception responses
+        uint64_t requests = 0;
+        //! Requests answered with an exception
+        uint64_t exceptions = 0;
+        //! Executed broadcasts
+        uint64_t broadcasts = 0;
+        //! Frames for other unit ids and broadcast reads
+        uint64_t ignored = 0;
+    };
+
+  private:
+    Connection _connection;
+    std::array<std::shared_ptr<const RequestDispatcher>, 256> _units;
+    // Pipe that wakes up run() when stop() is called
+    int _wake[2] = {-1, -1};
+    std::atomic<bool> _stopped{false};
+
+    std::atomic<uint64_t> _requests{0};
+    std::atomic<uint64_t> _exceptions{0};
+    std::atomic<uint64_t> _broadcasts{0};
+    std::atomic<uint64_t> _ignored{0};
+
+    void serveFrame(const std::vector<uint8_t> &frame);
+
+  public:
+    /**
+     * @brief Takes configured and connected connection.
+     * @throws std::runtime_error - if wake up pipe cannot be created.
+     */
+    explicit Server(Connection &&connection);
+    ~Server();
+
+    Server(const Server &)            = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief Answers requests for the unit id with the dispatcher.
+     * @note Units have to be added before calling run().
+     * @throws std::invalid_argument - if unit id is not in 1 - 247 range.
+     */
+    void addUnit(uint8_t unitId, std::shared_ptr<const RequestDispatcher> dispatcher);
+
+    /**
+     * @brief Answers requests for the unit id from the bank.
+     * @param bank - Object with `handle(const ModbusRequest &)` method, like
+     * RegisterBank. It must outlive the server.
+     */
+    template <typename Bank> void addUnit(uint8_t unitId, Bank &bank) {
+        auto dispatcher = std::make_shared<RequestDispatcher>();
+        dispatcher->serve(bank);
+        addUnit(unitId, std::move(dispatcher));
+    }
+
+    /**
+     * @brief Serves requests, blocks until stop() is called.
+     * @throws ModbusException - SlaveDeviceFailure if port cannot be read.
+     */
+    void run();
+
+    //! Stops the server, can be called from any thread
+    void stop();
+
+    [[nodiscard]] Stats stats() const;
+
+    //! Underlying connection, e.g. to set its metrics or capture
+    Connection &connection() { return _connection; }
+};
+} // namespace MB::Serial
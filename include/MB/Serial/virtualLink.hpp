@@ -0,0 +1,71 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MB::Serial {
+/**
+ * @brief Virtual serial line made of two pseudo terminals, for tests and
+ * benchmarks without hardware.
+ *
+ * Both ends are paths of pseudo terminals (e.g. /dev/pts/3), which can be
+ * opened with Connection. Bytes written to one end are relayed to the other
+ * one by a background thread, after the time they would take on a real line
+ * with the given baud rate (11 bits per character). Like RS-485, the line is
+ * half duplex: transmissions in both directions share the time.
+ */
+class VirtualLink {
+  private:
+    unsigned int _baudRate;
+    // Master sides of the pseudo terminals
+    std::array<int, 2> _masters = {-1, -1};
+    // Slave sides are kept open, so that masters never see a hang up
+    std::array<int, 2> _slaves = {-1, -1};
+    std::array<std::string, 2> _paths;
+    int _wake[2] = {-1, -1};
+
+    std::atomic<uint64_t> _relayed{0};
+    std::thread _relay;
+
+    void relay();
+    void close();
+
+  public:
+    /**
+     * @brief Creates the line and starts relaying.
+     * @param baudRate - Simulated baud rate, 0 relays bytes without delay.
+     * @throws std::runtime_error - if pseudo terminals cannot be created.
+     */
+    explicit VirtualLink(unsigned int baudRate = 0);
+    ~VirtualLink();
+
+    VirtualLink(const VirtualLink &)            = delete;
+    VirtualLink &operator=(const VirtualLink &) = delete;
+
+    //! Path of the first end
+    [[nodiscard]] const std::string &first() const { return _paths[0]; }
+
+    //! Path of the second end
+    [[nodiscard]] const std::string &second() const { return _paths[1]; }
+
+    /**
+     * @brief Puts bytes on the line, both ends receive them right away, e.g.
+     * to simulate noise.
+     */
+    void inject(const std::vector<uint8_t> &bytes);
+
+    //! Number of bytes relayed between the ends
+    [[nodiscard]] uint64_t relayed() const { return _relayed; }
+
+    [[nodiscard]] unsigned int baudRate() const { return _baudRate; }
+};
+} // namespace MB::Serial
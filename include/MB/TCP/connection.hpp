@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <chrono>
+#include <map>
 #include <memory>
+#include <optional>
 #include <type_traits>
 
 #include <cerrno>
@@ -13,19 +16,60 @@
 #include <poll.h>
 #include <sys/socket.h>
 
+#include "MB/mbap.hpp"
+#include "MB/metrics.hpp"
 #include "MB/modbusException.hpp"
 #include "MB/modbusRequest.hpp"
 #include "MB/modbusResponse.hpp"
+#include "MB/pcap.hpp"
+#include "MB/rttEstimator.hpp"
+#include "MB/trace.hpp"
 
 namespace MB::TCP {
 class Connection {
   public:
     static const unsigned int DefaultTCPTimeout = 500;
+    // Waiting for a request longer than that means the connection has died
+    static const unsigned int DefaultIdleTimeout = 60 * 1000;
 
   private:
-    int _sockfd         = -1;
+    // Request waiting for its response
+    struct Outstanding {
+        uint8_t unit;
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    int _sockfd = -1;
+    // Id of the last sent (or received) request
     uint16_t _messageID = 0;
-    int _timeout        = Connection::DefaultTCPTimeout;
+    // Id of the next sent request
+    uint16_t _nextID = 0;
+    int _timeout     = Connection::DefaultTCPTimeout;
+    int _idleTimeout = Connection::DefaultIdleTimeout;
+
+    std::shared_ptr<RttEstimator> _rtt;
+    std::shared_ptr<Metrics> _metrics;
+    std::shared_ptr<PcapWriter> _capture;
+    PcapEndpoint _local;
+    PcapEndpoint _peer;
+
+    // Received bytes, that do not form a whole frame yet
+    MBAP::Deframer _deframer;
+    // Keyed by transaction id
+    std::map<uint16_t, Outstanding> _outstanding;
+    // Responses that arrived before they were awaited
+    std::map<uint16_t, std::vector<uint8_t>> _early;
+
+    // Writes frame to the capture, if there is one
+    void capture(bool sent, const std::vector<uint8_t> &frame);
+
+    // Returns whole frame (with MBAP header), nullopt if it did not arrive in time
+    std::optional<std::vector<uint8_t>>
+    receiveFrame(std::chrono::steady_clock::time_point deadline);
+
+    // Passes outcome of the transaction to estimator and metrics
+    void reportOutcome(const Outstanding &request,
+                       std::optional<utils::MBErrorCode> error);
 
   public:
     explicit Connection() noexcept : _sockfd(-1), _messageID(0) {};
@@ -41,6 +85,17 @@ class Connection {
 
         _sockfd       = other._sockfd;
         _messageID    = other._messageID;
+        _nextID       = other._nextID;
+        _timeout      = other._timeout;
+        _idleTimeout  = other._idleTimeout;
+        _rtt          = std::move(other._rtt);
+        _metrics      = std::move(other._metrics);
+        _capture      = std::move(other._capture);
+        _local        = other._local;
+        _peer         = other._peer;
+        _deframer     = std::move(other._deframer);
+        _outstanding  = std::move(other._outstanding);
+        _early        = std::move(other._early);
         other._sockfd = -1;
 
         return *this;
@@ -52,17 +107,95 @@ class Connection {
 
     ~Connection();
 
+    /**
+     * @brief Sends request with the next transaction id (see setMessageId()),
+     * which is then returned by getMessageId().
+     *
+     * Request does not have to be answered before the next one is sent, up to
+     * the number of requests that the server accepts at once.
+     */
     std::vector<uint8_t> sendRequest(const MB::ModbusRequest &req);
+    //! Sends response with the transaction id of the last request
     std::vector<uint8_t> sendResponse(const MB::ModbusResponse &res);
+    //! Sends exception with the transaction id of the last request
     std::vector<uint8_t> sendException(const MB::ModbusException &ex);
 
     [[nodiscard]] MB::ModbusRequest awaitRequest();
-    [[nodiscard]] MB::ModbusResponse awaitResponse();
 
+    /**
+     * @brief Waits for the response to the last sent request.
+     * @throws ModbusException - Timeout, parsing error or exception response.
+     */
+    [[nodiscard]] MB::ModbusResponse awaitResponse() { return awaitResponse(_messageID); }
+
+    /**
+     * @brief Waits for the response with the given transaction id.
+     *
+     * Responses to other requests in flight, that arrive in the meantime, are
+     * kept until they are awaited. Responses to requests that are not awaited
+     * anymore (e.g. timed out) are dropped.
+     * @throws ModbusException - Timeout, parsing error or exception response.
+     */
+    [[nodiscard]] MB::ModbusResponse awaitResponse(uint16_t transactionId);
+
+    //! Response to the request will not be awaited, it is dropped when it arrives
+    void forgetResponse(uint16_t transactionId);
+
+    /**
+     * @brief Reads whatever arrives, without splitting it into frames.
+     *
+     * Bytes already received by awaitRequest() or awaitResponse(), that are
+     * not a whole frame yet, are returned first.
+     */
     [[nodiscard]] std::vector<uint8_t> awaitRawMessage();
 
+    //! Transaction id of the last sent (or received) request
     [[nodiscard]] uint16_t getMessageId() const { return _messageID; }
 
-    void setMessageId(uint16_t messageId) { _messageID = messageId; }
+    //! Next request is sent with this id, following ones count up from it.
+    //! Until next request arrives, responses are sent with it too.
+    void setMessageId(uint16_t messageId) {
+        _messageID = messageId;
+        _nextID    = messageId;
+    }
+
+    //! Response timeout in milliseconds, used if there is no RTT estimator
+    [[nodiscard]] int getTimeout() const { return _timeout; }
+    void setTimeout(int timeout) { _timeout = timeout; }
+
+    //! How long (in milliseconds) to wait for a request or raw message
+    [[nodiscard]] int getIdleTimeout() const { return _idleTimeout; }
+    void setIdleTimeout(int timeout) { _idleTimeout = timeout; }
+
+    /**
+     * @brief Makes response timeout adapt to the measured response times.
+     *
+     * Every response updates estimate of the unit it came from, every timeout
+     * backs off its timeout. With estimator the timeout runs from sending of
+     * the request. Estimator may be shared with other connections and is used
+     * for monitoring. Passing nullptr restores fixed timeout.
+     */
+    void setRttEstimator(std::shared_ptr<RttEstimator> estimator) {
+        _rtt = std::move(estimator);
+    }
+
+    [[nodiscard]] const std::shared_ptr<RttEstimator> &getRttEstimator() const {
+        return _rtt;
+    }
+
+    //! Collects traffic counters and response times, nullptr disables it
+    void setMetrics(std::shared_ptr<Metrics> metrics) { _metrics = std::move(metrics); }
+
+    [[nodiscard]] const std::shared_ptr<Metrics> &getMetrics() const { return _metrics; }
+
+    /**
+     * @brief Records every sent and received frame, nullptr stops recording.
+     * @throws std::invalid_argument - if capture does not have raw link type.
+     */
+    void setCapture(std::shared_ptr<PcapWriter> capture);
+
+    [[nodiscard]] const std::shared_ptr<PcapWriter> &getCapture() const {
+        return _capture;
+    }
 };
 } // namespace MB::TCP
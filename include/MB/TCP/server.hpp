@@ -22,6 +22,11 @@ class Server {
     sockaddr_in _server;
 
   public:
+    /**
+     * @brief Listens on the given port of all interfaces.
+     * @param port - TCP port, 0 lets the system choose a free one (see port()).
+     * @throws std::runtime_error - if socket cannot be created or bound.
+     */
     explicit Server(int port);
     ~Server();
 
@@ -43,6 +48,14 @@ class Server {
 
     [[nodiscard]] int nativeHandle() { return _serverfd; }
 
+    //! Port the server listens on
+    [[nodiscard]] int port() const { return _port; }
+
+    /**
+     * @brief Waits for the new client.
+     * @return Connection with the client or nullopt if accept failed (for
+     * example because server socket was shut down).
+     */
     std::optional<Connection> awaitConnection();
 };
 } // namespace MB::TCP
@@ -0,0 +1,80 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <optional>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+#include "transport.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Forwards requests between any two transports, e.g. Modbus TCP slave
+ * connection and Modbus RTU line, without virtual calls.
+ *
+ * Requests received from the upstream (server transport) are sent to the
+ * downstream (client transport) and the responses are sent back. Exception
+ * responses of the target are forwarded as they are, other downstream errors
+ * (timeout, corrupted response) are answered with
+ * GatewayTargetDeviceFailedToRespond. Broadcasts (unit id 0) are forwarded and
+ * not answered.
+ *
+ * Bridge serves one request at a time, for many clients and queueing see
+ * Gateway::Gateway.
+ *
+ * @note Transports are not owned and have to outlive the bridge.
+ */
+template <typename Upstream, typename Downstream> class Bridge {
+    static_assert(isServerTransport<Upstream>,
+                  "Bridge upstream has to meet MB::ServerTransport");
+    static_assert(isClientTransport<Downstream>,
+                  "Bridge downstream has to meet MB::ClientTransport");
+
+    Upstream &_upstream;
+    Downstream &_downstream;
+
+  public:
+    Bridge(Upstream &upstream, Downstream &downstream)
+        : _upstream(upstream), _downstream(downstream) {}
+
+    /**
+     * @brief Waits for a single request and forwards it.
+     * @throws ModbusException - Upstream errors, e.g. timeout of awaiting the
+     * request or closed connection.
+     */
+    void forwardOne() {
+        const auto request = TransportTraits<Upstream>::awaitRequest(_upstream);
+        if (request.slaveID() == 0) {
+            (void)_downstream.sendRequest(request);
+            return;
+        }
+
+        std::optional<ModbusResponse> response;
+        std::optional<ModbusException> exception;
+        try {
+            response = TransportTraits<Downstream>::transact(_downstream, request);
+        } catch (const ModbusException &ex) {
+            if (utils::isStandardErrorCode(ex.getErrorCode()) &&
+                ex.slaveID() == request.slaveID())
+                exception = ex;
+            else
+                exception = ModbusException(utils::GatewayTargetDeviceFailedToRespond,
+                                            request.slaveID(), request.functionCode());
+        }
+
+        // Outside of the try, upstream errors are not answered
+        if (response)
+            (void)_upstream.sendResponse(*response);
+        else
+            (void)_upstream.sendException(*exception);
+    }
+};
+} // namespace MB
@@ -0,0 +1,105 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "modbusException.hpp"
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Stops sending requests to devices that do not respond.
+ *
+ * Every unit id has its own breaker:
+ * - Closed - requests are sent, consecutive Timeout / SlaveDeviceFailure outcomes
+ *   are counted and after reaching the threshold the breaker opens.
+ * - Open - requests fail immediately with CircuitOpen error, so that a dead
+ *   device does not take bus time from the healthy ones.
+ * - HalfOpen - after the open time single probe request is let through.
+ *   If it succeeds breaker closes, otherwise it opens again.
+ *
+ * Any response (also exception response) counts as success. Breaker is thread
+ * safe, so it may be shared between connections and read for monitoring.
+ */
+class CircuitBreaker {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { Closed, Open, HalfOpen };
+
+  private:
+    struct Unit {
+        State state          = State::Closed;
+        std::size_t failures = 0;
+        Clock::time_point openedAt;
+    };
+
+    mutable std::mutex _mutex;
+    std::array<Unit, 256> _units;
+    std::size_t _failureThreshold;
+    Clock::duration _openTime;
+
+    void open(Unit &unit, Clock::time_point now);
+
+  public:
+    /**
+     * @brief Creates breaker.
+     * @param failureThreshold - Number of consecutive failures opening the breaker.
+     * @param openTime - Time after which the probe is sent to the open device.
+     * @throws std::invalid_argument - if failure threshold is 0.
+     */
+    explicit CircuitBreaker(std::size_t failureThreshold = 3,
+                            Clock::duration openTime   = std::chrono::seconds(5));
+
+    /**
+     * @brief Checks if request to the unit may be sent now.
+     *
+     * When open time passes, first call switches breaker to HalfOpen and
+     * returns true - caller has to send the probe and report its outcome.
+     * Broadcasts (unit id 0) are always allowed.
+     */
+    bool allow(uint8_t unitId, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Same as allow(), but throws if request may not be sent.
+     * @throws ModbusException - CircuitOpen.
+     */
+    void check(uint8_t unitId, utils::MBFunctionCode functionCode,
+               Clock::time_point now = Clock::now());
+
+    //! Reports that unit has responded
+    void success(uint8_t unitId);
+
+    //! Reports that unit has not responded or has failed
+    void failure(uint8_t unitId, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Reports outcome of the transaction.
+     * @param error - Error of the transaction or nullopt if it succeeded.
+     * Exception responses mean that device works, except of SlaveDeviceFailure.
+     * Other errors (timeout, corrupted or unexpected response) are failures and
+     * CircuitOpen, raised by the breaker itself, is ignored.
+     */
+    void report(uint8_t unitId, std::optional<utils::MBErrorCode> error,
+                Clock::time_point now = Clock::now());
+
+    [[nodiscard]] State state(uint8_t unitId) const;
+
+    //! Number of consecutive failures of the unit
+    [[nodiscard]] std::size_t failures(uint8_t unitId) const;
+
+    //! Closes the breaker of the unit
+    void reset(uint8_t unitId);
+};
+} // namespace MB
@@ -0,0 +1,207 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+#include "registerBank.hpp"
+#include "transport.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Master side helper, that works with any client transport.
+ *
+ * Transport is a template parameter, so the same code works over TCP, serial
+ * line or loopback without virtual calls, see transport.hpp.
+ *
+ * Example:
+ * ```
+ * TCP::Connection connection = TCP::Connection::with("127.0.0.1", 502);
+ * Client client(connection);
+ * const auto values = client.read(1, utils::ReadAnalogOutputHoldingRegisters, 0, 10);
+ * ```
+ *
+ * @note Transport is not owned and has to outlive the client.
+ */
+template <typename Transport> class Client {
+    static_assert(isClientTransport<Transport>,
+                  "Client requires transport meeting MB::ClientTransport");
+
+    Transport &_transport;
+    std::size_t _pipelineDepth = DefaultPipelineDepth;
+
+    static utils::MBFunctionCode readFunction(utils::MBFunctionRegisters table) {
+        switch (table) {
+        case utils::OutputCoils:
+            return utils::ReadDiscreteOutputCoils;
+        case utils::InputContacts:
+            return utils::ReadDiscreteInputContacts;
+        case utils::HoldingRegisters:
+            return utils::ReadAnalogOutputHoldingRegisters;
+        case utils::InputRegisters:
+            return utils::ReadAnalogInputRegisters;
+        }
+        throw std::invalid_argument("Unknown table");
+    }
+
+    // Appends values of the response, which has to cover the whole request
+    static void append(std::vector<ModbusCell> &values, const ModbusRequest &request,
+                       const ModbusResponse &response) {
+        const auto &cells = response.registerValues();
+        if (cells.size() < request.numberOfRegisters())
+            throw ModbusException(utils::NumberOfValuesInvalid, request.slaveID(),
+                                  request.functionCode());
+
+        values.insert(values.end(), cells.begin(),
+                      cells.begin() + request.numberOfRegisters());
+    }
+
+  public:
+    //! Requests in flight at once, many servers do not queue more of them
+    static constexpr std::size_t DefaultPipelineDepth = 4;
+
+    explicit Client(Transport &transport) : _transport(transport) {}
+
+    [[nodiscard]] Transport &transport() { return _transport; }
+
+    /**
+     * @brief Sets number of requests that readRange() keeps in flight, used only
+     * with pipelined transports.
+     * @throws std::invalid_argument - if depth is 0.
+     */
+    void setPipelineDepth(std::size_t depth) {
+        if (depth == 0)
+            throw std::invalid_argument("Pipeline depth has to be positive");
+        _pipelineDepth = depth;
+    }
+
+    [[nodiscard]] std::size_t getPipelineDepth() const { return _pipelineDepth; }
+
+    /**
+     * @brief Sends request and waits for its response.
+     * @throws ModbusException - Exception response, timeout or other error.
+     */
+    ModbusResponse transact(const ModbusRequest &request) {
+        return TransportTraits<Transport>::transact(_transport, request);
+    }
+
+    /**
+     * @brief Reads count values starting at address.
+     * @throws std::invalid_argument - if function code is not a read.
+     * @throws ModbusException - Exception response, timeout or other error,
+     * NumberOfValuesInvalid if slave returned too little values.
+     */
+    std::vector<ModbusCell> read(uint8_t unitId, utils::MBFunctionCode functionCode,
+                                 uint16_t address, uint16_t count) {
+        if (utils::functionType(functionCode) != utils::Read)
+            throw std::invalid_argument("Function code is not a read");
+
+        const auto response =
+            transact(ModbusRequest(unitId, functionCode, address, count));
+        auto values = response.registerValues();
+        if (values.size() < count)
+            throw ModbusException(utils::NumberOfValuesInvalid, unitId, functionCode);
+
+        // Coils are padded to whole bytes
+        values.resize(count);
+        return values;
+    }
+
+    /**
+     * @brief Reads range of any size, split into requests of at most
+     * MaxReadRegisters registers or MaxReadBits coils / discrete inputs.
+     *
+     * Pipelined transports (e.g. TCP::Connection) keep up to getPipelineDepth()
+     * requests in flight, so the range is read in about one round trip per
+     * depth requests. Other transports (e.g. serial line) perform requests one
+     * after another.
+     * @return Values of the whole range, in address order.
+     * @throws std::invalid_argument - if range runs past the end of address space.
+     * @throws ModbusException - Error of the first failed request, responses to
+     * the requests still in flight are dropped.
+     */
+    std::vector<ModbusCell> readRange(uint8_t unitId, utils::MBFunctionRegisters table,
+                                      uint16_t address, std::size_t count) {
+        if (address + count > 0x10000)
+            throw std::invalid_argument("Range runs past the end of address space");
+
+        const auto functionCode = readFunction(table);
+        // Coils and discrete inputs are packed, so more of them fit in a response
+        const bool bits = table == utils::OutputCoils || table == utils::InputContacts;
+
+        const std::size_t limit = bits ? MaxReadBits : MaxReadRegisters;
+
+        std::vector<ModbusRequest> requests;
+        for (std::size_t offset = 0; offset < count; offset += limit) {
+            const auto size = std::min(limit, count - offset);
+            requests.emplace_back(unitId, functionCode,
+                                  static_cast<uint16_t>(address + offset),
+                                  static_cast<uint16_t>(size));
+        }
+
+        std::vector<ModbusCell> values;
+        values.reserve(count);
+
+        if constexpr (isPipelinedTransport<Transport>) {
+            // Transaction ids, responses are awaited in order of the requests
+            std::deque<uint16_t> inFlight;
+            std::size_t sent = 0;
+            try {
+                for (const auto &request : requests) {
+                    while (sent < requests.size() && inFlight.size() < _pipelineDepth) {
+                        (void)_transport.sendRequest(requests[sent++]);
+                        inFlight.push_back(_transport.getMessageId());
+                    }
+
+                    const auto id = inFlight.front();
+                    inFlight.pop_front();
+                    append(values, request,
+                           TransportTraits<Transport>::awaitResponse(_transport, id));
+                }
+            } catch (...) {
+                for (const auto id : inFlight)
+                    _transport.forgetResponse(id);
+                throw;
+            }
+        } else {
+            for (const auto &request : requests)
+                append(values, request, transact(request));
+        }
+
+        return values;
+    }
+
+    /**
+     * @brief Writes values starting at address.
+     * @throws std::invalid_argument - if function code is not a write or single
+     * write gets other number of values than one.
+     * @throws ModbusException - Exception response, timeout or other error.
+     */
+    void write(uint8_t unitId, utils::MBFunctionCode functionCode, uint16_t address,
+               const std::vector<ModbusCell> &values) {
+        const auto type = utils::functionType(functionCode);
+        if (type == utils::Read)
+            throw std::invalid_argument("Function code is not a write");
+        if (type == utils::WriteSingle && values.size() != 1)
+            throw std::invalid_argument("Single write needs exactly one value");
+
+        (void)transact(ModbusRequest(unitId, functionCode, address,
+                                     static_cast<uint16_t>(values.size()), values));
+    }
+};
+} // namespace MB
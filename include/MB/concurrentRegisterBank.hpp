@@ -0,0 +1,134 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <variant>
+#include <vector>
+
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+#include "registerBank.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Thread safe variant of the RegisterBank for servers.
+ *
+ * Every table is divided into regions guarded by sequence locks. Readers never
+ * take a lock - they copy the values and retry if any region they touched was
+ * modified in the meantime, so every read (also one spanning several regions)
+ * is a consistent snapshot and multi-register values are never torn.
+ * Writers are serialized between each other, but are never blocked by readers.
+ */
+class ConcurrentRegisterBank {
+  public:
+    //! Default number of values guarded by a single sequence lock
+    static constexpr std::size_t DefaultRegionSize = 64;
+
+  private:
+    // Sequence lock, on its own cache line so that regions do not interfere
+    struct alignas(64) Region {
+        std::atomic<uint32_t> sequence{0};
+    };
+
+    class Table {
+      private:
+        std::size_t _size;
+        std::size_t _regionSize;
+        std::unique_ptr<std::atomic<uint16_t>[]> _values;
+        std::unique_ptr<Region[]> _regions;
+
+      public:
+        Table(std::size_t size, std::size_t regionSize);
+
+        [[nodiscard]] std::size_t size() const { return _size; }
+
+        void read(std::size_t address, std::size_t count, uint16_t *out) const;
+        void write(std::size_t address, std::size_t count, const uint16_t *in);
+    };
+
+    std::array<Table, 4> _tables;
+    std::mutex _writeMutex;
+
+    [[nodiscard]] const Table &tableOf(utils::MBFunctionRegisters table) const;
+    [[nodiscard]] Table &tableOf(utils::MBFunctionRegisters table);
+    void checkRange(utils::MBFunctionRegisters table, uint16_t address,
+                    std::size_t count) const;
+
+  public:
+    /**
+     * @brief Constructs bank with all values set to 0.
+     * @param coils - Number of coils.
+     * @param discreteInputs - Number of discrete inputs.
+     * @param holdingRegisters - Number of holding registers.
+     * @param inputRegisters - Number of input registers.
+     * @param regionSize - Number of values guarded by a single sequence lock.
+     */
+    explicit ConcurrentRegisterBank(std::size_t coils = 0, std::size_t discreteInputs = 0,
+                                    std::size_t holdingRegisters = 0,
+                                    std::size_t inputRegisters   = 0,
+                                    std::size_t regionSize       = DefaultRegionSize);
+
+    ConcurrentRegisterBank(const ConcurrentRegisterBank &)            = delete;
+    ConcurrentRegisterBank &operator=(const ConcurrentRegisterBank &) = delete;
+
+    /**
+     * @brief Serves request from the bank, see serveRequest for details.
+     * @note Thread safe.
+     */
+    [[nodiscard]] std::variant<ModbusResponse, ModbusException>
+    handle(const ModbusRequest &request);
+
+    /**
+     * @brief Copies consistent snapshot of values into `out`.
+     * @note Coils and discrete inputs are represented as 0 / 1.
+     * @throws ModbusException - IllegalDataAddress if range does not fit in table
+     */
+    void read(utils::MBFunctionRegisters table, uint16_t address, std::size_t count,
+              uint16_t *out) const;
+
+    //! Returns consistent snapshot of values, see read()
+    [[nodiscard]] std::vector<uint16_t> read(utils::MBFunctionRegisters table,
+                                             uint16_t address, std::size_t count) const;
+
+    /**
+     * @brief Atomically (for readers) stores values in the table.
+     * @throws ModbusException - IllegalDataAddress if range does not fit in table
+     */
+    void write(utils::MBFunctionRegisters table, uint16_t address, const uint16_t *in,
+               std::size_t count);
+
+    //! Atomically (for readers) stores values in the table, see write()
+    void write(utils::MBFunctionRegisters table, uint16_t address,
+               const std::vector<uint16_t> &values) {
+        write(table, address, values.data(), values.size());
+    }
+
+    //! Returns number of values in the table
+    [[nodiscard]] std::size_t tableSize(utils::MBFunctionRegisters table) const {
+        return tableOf(table).size();
+    }
+
+    //! Reads values from the table as cells, used by serveRequest
+    [[nodiscard]] std::vector<ModbusCell> readCells(utils::MBFunctionRegisters table,
+                                                    uint16_t address,
+                                                    uint16_t count) const;
+
+    //! Writes cells to the table, used by serveRequest
+    void writeCells(utils::MBFunctionRegisters table, uint16_t address,
+                    const std::vector<ModbusCell> &values);
+};
+} // namespace MB
@@ -1,9 +1,21 @@
+#pragma once
+
 #include <cstdint>
 #include <optional>
 #include <vector>
 
 //! This namespace contains functions used for CRC calculation
 namespace MB::CRC {
+//! Initial value of the CRC
+constexpr uint16_t Initial = 0xFFFF;
+
+/**
+ * @brief Adds single byte to the CRC, for incremental calculation.
+ *
+ * CRC of the frame followed by its own CRC (low byte first) is always 0.
+ */
+uint16_t update(uint16_t crc, uint8_t byte);
+
 //! Calculates CRC based on the input buffer - C style
 uint16_t calculateCRC(const uint8_t *buff, std::size_t len);
 
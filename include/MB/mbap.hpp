@@ -0,0 +1,114 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+// This header contains utilities for MBAP header used by Modbus TCP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "modbusException.hpp"
+#include "modbusUtils.hpp"
+
+/*!
+ * Namespace that contains utilities for Modbus Application Protocol header,
+ * which precedes every Modbus TCP frame.
+ */
+namespace MB::MBAP {
+//! Size of the header, including unit id
+constexpr std::size_t HeaderSize = 7;
+//! Maximal value of length field (unit id + 253 bytes of PDU)
+constexpr uint16_t MaxLength = 254;
+
+//! Decoded MBAP header
+struct Header {
+    uint16_t transactionId;
+    uint16_t protocolId;
+    //! Number of bytes following length field (unit id + PDU)
+    uint16_t length;
+    uint8_t unitId;
+};
+
+//! Decodes header, `data` needs to contain at least HeaderSize bytes
+inline Header parseHeader(const uint8_t *data) {
+    return Header{utils::bigEndianConv(&data[0]), utils::bigEndianConv(&data[2]),
+                  utils::bigEndianConv(&data[4]), data[6]};
+}
+
+/**
+ * @brief Wraps frame with MBAP header.
+ * @param transactionId - Transaction id to be put into header.
+ * @param frame - Unit id and PDU, as returned by toRaw() methods.
+ * @return MBAP frame ready to be sent over TCP.
+ */
+inline std::vector<uint8_t> wrap(uint16_t transactionId,
+                                 const std::vector<uint8_t> &frame) {
+    std::vector<uint8_t> result;
+    result.reserve(frame.size() + 6);
+
+    utils::pushUint16(result, transactionId);
+    utils::pushUint16(result, 0x0000);
+    utils::pushUint16(result, static_cast<uint16_t>(frame.size()));
+    result.insert(result.end(), frame.begin(), frame.end());
+
+    return result;
+}
+
+/**
+ * @brief Splits TCP byte stream into MBAP frames.
+ *
+ * TCP does not preserve message boundaries, so single read may contain part
+ * of the frame or several frames. Deframer buffers data until whole frame,
+ * as described by the length field, is available.
+ */
+class Deframer {
+  private:
+    std::vector<uint8_t> _buffer;
+
+  public:
+    //! Appends bytes received from the stream
+    void append(const uint8_t *data, std::size_t size) {
+        _buffer.insert(_buffer.end(), data, data + size);
+    }
+
+    //! Appends bytes received from the stream
+    void append(const std::vector<uint8_t> &data) { append(data.data(), data.size()); }
+
+    /**
+     * @brief Extracts first complete frame (with header) from the buffer.
+     * @return Frame or nullopt if more data is needed.
+     * @throws ModbusException - ProtocolError if length field is invalid, in
+     * which case stream cannot be synchronized anymore.
+     */
+    std::optional<std::vector<uint8_t>> next() {
+        if (_buffer.size() < 6)
+            return std::nullopt;
+
+        const auto length = utils::bigEndianConv(&_buffer[4]);
+        if (length < 2 || length > MaxLength)
+            throw ModbusException(utils::ProtocolError);
+
+        const std::size_t frameSize = 6 + length;
+        if (_buffer.size() < frameSize)
+            return std::nullopt;
+
+        std::vector<uint8_t> frame(_buffer.begin(), _buffer.begin() + frameSize);
+        _buffer.erase(_buffer.begin(), _buffer.begin() + frameSize);
+        return frame;
+    }
+
+    //! Number of buffered bytes, not yet returned as frames
+    [[nodiscard]] std::size_t buffered() const { return _buffer.size(); }
+
+    //! Removes and returns all buffered bytes
+    std::vector<uint8_t> take() {
+        std::vector<uint8_t> bytes;
+        bytes.swap(_buffer);
+        return bytes;
+    }
+};
+} // namespace MB::MBAP
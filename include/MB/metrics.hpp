@@ -0,0 +1,197 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Lock free latency histogram with logarithmic buckets (HDR style).
+ *
+ * Values are kept in microseconds. Every power of two is divided into 16
+ * linear sub buckets, so relative error of percentiles is below 6.25 %, from
+ * 1 us up to about 38 hours, using fixed amount of memory.
+ */
+class LatencyHistogram {
+  public:
+    using Duration = std::chrono::microseconds;
+
+    //! Linear sub buckets per power of two
+    static constexpr std::size_t SubBuckets = 16;
+    //! Highest power of two that is tracked, larger values are clamped
+    static constexpr std::size_t MaxExponent = 36;
+    static constexpr std::size_t BucketCount = (MaxExponent - 3 + 1) * SubBuckets;
+
+    //! Copy of the histogram at some point in time
+    struct Snapshot {
+        std::array<uint64_t, BucketCount> counts{};
+        uint64_t count = 0;
+        //! Sum of all recorded values
+        Duration sum{0};
+        Duration min{0};
+        Duration max{0};
+
+        /**
+         * @brief Value below which given fraction of recorded values are.
+         * @param quantile - Fraction from 0 to 1, e.g. 0.99 for p99.
+         * @return Highest value of the bucket (clamped to max), 0 if empty.
+         */
+        [[nodiscard]] Duration percentile(double quantile) const;
+
+        [[nodiscard]] Duration mean() const {
+            return count == 0 ? Duration(0) : Duration(sum.count() / count);
+        }
+    };
+
+  private:
+    std::array<std::atomic<uint64_t>, BucketCount> _counts{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _sum{0};
+    std::atomic<uint64_t> _min{UINT64_MAX};
+    std::atomic<uint64_t> _max{0};
+
+  public:
+    static std::size_t bucketOf(uint64_t value);
+    //! Lowest value, that falls into the bucket
+    static uint64_t bucketLowest(std::size_t bucket);
+    //! Highest value, that falls into the bucket
+    static uint64_t bucketHighest(std::size_t bucket);
+
+    //! Records single value, lock free
+    void record(Duration value);
+
+    //! Copies current state, values recorded concurrently may be partially visible
+    [[nodiscard]] Snapshot snapshot() const;
+};
+
+/**
+ * @brief Low overhead counters and latency histograms of a connection.
+ *
+ * Tracks bytes and frames in both directions and, per unit id, number of
+ * requests and responses (sent and received), request to response latency and
+ * errors (timeouts, CRC errors, invalid message ids and exception responses by
+ * code). All updates are lock free (relaxed atomics), per unit data is
+ * allocated on first use.
+ *
+ * Connections (TCP and Serial) update it when set with `setMetrics()`, single
+ * instance may be shared by several connections.
+ */
+class Metrics {
+  public:
+    using Duration = LatencyHistogram::Duration;
+
+    //! Number of tracked exception codes, higher ones go to otherErrors
+    static constexpr std::size_t ExceptionCodes = 16;
+
+    struct UnitSnapshot {
+        uint8_t unitId;
+        uint64_t requests;
+        uint64_t responses;
+        uint64_t timeouts;
+        uint64_t crcErrors;
+        uint64_t invalidMessageIds;
+        uint64_t otherErrors;
+        //! Exception responses, indexed by exception code
+        std::array<uint64_t, ExceptionCodes> exceptions;
+        LatencyHistogram::Snapshot latency;
+        //! Responses (including exceptions) sent on behalf of the unit
+        uint64_t responsesSent;
+        //! Requests received by the slave serving the unit
+        uint64_t requestsReceived;
+    };
+
+    struct Snapshot {
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+        uint64_t framesIn;
+        uint64_t framesOut;
+        //! Only units that were used, sorted by unit id
+        std::vector<UnitSnapshot> units;
+    };
+
+  private:
+    struct Unit {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> responses{0};
+        std::atomic<uint64_t> timeouts{0};
+        std::atomic<uint64_t> crcErrors{0};
+        std::atomic<uint64_t> invalidMessageIds{0};
+        std::atomic<uint64_t> otherErrors{0};
+        std::array<std::atomic<uint64_t>, ExceptionCodes> exceptions{};
+        LatencyHistogram latency;
+        std::atomic<uint64_t> responsesSent{0};
+        std::atomic<uint64_t> requestsReceived{0};
+    };
+
+    std::atomic<uint64_t> _bytesIn{0};
+    std::atomic<uint64_t> _bytesOut{0};
+    std::atomic<uint64_t> _framesIn{0};
+    std::atomic<uint64_t> _framesOut{0};
+    std::array<std::atomic<Unit *>, 256> _units{};
+
+    Unit &unit(uint8_t unitId);
+
+  public:
+    Metrics() = default;
+    ~Metrics();
+
+    Metrics(const Metrics &)            = delete;
+    Metrics &operator=(const Metrics &) = delete;
+
+    //! Notes request frame sent to the unit
+    void requestSent(uint8_t unitId, std::size_t bytes);
+
+    //! Notes response (normal or exception) sent by the slave as the unit
+    void responseSent(uint8_t unitId, std::size_t bytes);
+
+    //! Notes frame sent, which is neither request nor response of the library
+    void frameSent(std::size_t bytes);
+
+    //! Notes bytes received, frames are counted separately
+    void bytesReceived(std::size_t bytes) {
+        _bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    //! Notes response (normal or exception) received from the unit
+    void responseReceived(uint8_t unitId, Duration latency);
+
+    //! Notes request received by the slave serving the unit, bytes are counted
+    //! by bytesReceived()
+    void requestReceived(uint8_t unitId);
+
+    /**
+     * @brief Notes failed transaction.
+     *
+     * Standard codes are counted as exception responses (see also
+     * responseReceived()), Timeout, CRC errors and InvalidMessageID have their own
+     * counters, everything else goes to otherErrors.
+     */
+    void error(uint8_t unitId, utils::MBErrorCode code);
+
+    [[nodiscard]] Snapshot snapshot() const;
+};
+
+/**
+ * @brief Renders snapshots in Prometheus text exposition format.
+ * @param connections - Pairs of connection label value and its snapshot.
+ * @param prefix - Prefix of every metric name.
+ */
+std::string
+toPrometheus(const std::vector<std::pair<std::string, Metrics::Snapshot>> &connections,
+             const std::string &prefix = "modbus");
+} // namespace MB
@@ -47,6 +47,8 @@ enum MBErrorCode : uint8_t {
     // See issue: https://github.com/Mazurel/Modbus/issues/3
     NumberOfRegistersInvalid = 0b01111000,
     NumberOfValuesInvalid    = 0b01110111,
+    // Request was not sent, because device is considered dead (see CircuitBreaker)
+    CircuitOpen = 0b01110110,
 };
 
 //! Checks if error code is modbus standard error code
@@ -71,6 +73,7 @@ inline bool isStandardErrorCode(MBErrorCode code) {
     case ConnectionClosed:
     case Timeout:
     case NumberOfRegistersInvalid:
+    case CircuitOpen:
     default:
         return false;
     }
@@ -117,6 +120,8 @@ inline std::string mbErrorCodeToStr(MBErrorCode code) noexcept {
         return "Number of registers in response is too big - cannot be serialized";
     case NumberOfValuesInvalid:
         return "Number of values is not valid";
+    case CircuitOpen:
+        return "Device is not responding, request was not sent (circuit open)";
     }
 
     return "Unknown";
@@ -142,6 +147,23 @@ enum MBFunctionCode : uint8_t {
     Undefined = 0x00
 };
 
+//! Checks if function code is one of the standard codes supported by the library
+inline bool isStandardFunctionCode(const uint8_t code) noexcept {
+    switch (code) {
+    case ReadDiscreteOutputCoils:
+    case ReadDiscreteInputContacts:
+    case ReadAnalogOutputHoldingRegisters:
+    case ReadAnalogInputRegisters:
+    case WriteSingleDiscreteOutputCoil:
+    case WriteSingleAnalogOutputRegister:
+    case WriteMultipleDiscreteOutputCoils:
+    case WriteMultipleAnalogOutputHoldingRegisters:
+        return true;
+    default:
+        return false;
+    }
+}
+
 //! Simplified function types
 enum MBFunctionType { Read, WriteSingle, WriteMultiple };
 
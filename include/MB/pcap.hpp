@@ -0,0 +1,153 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+//! Link types of the capture files
+enum class PcapLinkType : uint32_t {
+    //! LINKTYPE_RAW, Modbus TCP wrapped in synthesized IPv4 and TCP headers
+    Raw = 101,
+    /**
+     * DLT_USER0, Modbus RTU frames as they are on the wire. In Wireshark set
+     * "mbrtu" as payload protocol of User 0 in the DLT_USER preferences.
+     */
+    User0 = 147,
+};
+
+//! IPv4 address and port, both in host byte order
+struct PcapEndpoint {
+    uint32_t address = 0;
+    uint16_t port    = 0;
+
+    bool operator<(const PcapEndpoint &other) const {
+        return std::tie(address, port) < std::tie(other.address, other.port);
+    }
+    bool operator==(const PcapEndpoint &other) const {
+        return address == other.address && port == other.port;
+    }
+};
+
+/**
+ * @brief Writes frames to a pcap file (nanosecond timestamps), readable by
+ * Wireshark and tcpdump.
+ *
+ * Modbus TCP frames get synthesized IPv4 and TCP headers with per direction
+ * sequence numbers, so that Wireshark can follow the streams. Writer is thread
+ * safe, so a single capture may be shared by several connections.
+ */
+class PcapWriter {
+  public:
+    using Clock = std::chrono::system_clock;
+
+  private:
+    std::mutex _mutex;
+    std::ofstream _file;
+    PcapLinkType _linkType;
+    std::size_t _packets = 0;
+    uint16_t _ipId       = 0;
+    // Next sequence number of every direction
+    std::map<std::pair<PcapEndpoint, PcapEndpoint>, uint32_t> _sequences;
+
+    void writeRecord(Clock::time_point timestamp, const std::vector<uint8_t> &packet);
+
+  public:
+    /**
+     * @brief Creates (truncates) capture file.
+     * @throws std::runtime_error - if file cannot be opened.
+     */
+    PcapWriter(const std::string &path, PcapLinkType linkType);
+
+    PcapWriter(const PcapWriter &)            = delete;
+    PcapWriter &operator=(const PcapWriter &) = delete;
+
+    /**
+     * @brief Writes Modbus TCP frame (with MBAP header) sent from one endpoint
+     * to the other.
+     * @throws std::logic_error - if capture has other link type than Raw.
+     */
+    void writeTcp(const PcapEndpoint &from, const PcapEndpoint &to,
+                  const std::vector<uint8_t> &frame,
+                  Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Writes Modbus RTU frame (with CRC).
+     * @throws std::logic_error - if capture has other link type than User0.
+     */
+    void writeRtu(const std::vector<uint8_t> &frame,
+                  Clock::time_point now = Clock::now());
+
+    //! Flushes buffered packets to the file
+    void flush();
+
+    [[nodiscard]] PcapLinkType linkType() const { return _linkType; }
+
+    [[nodiscard]] std::size_t packets() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _packets;
+    }
+};
+
+//! Single packet of the capture
+struct PcapPacket {
+    PcapWriter::Clock::time_point timestamp;
+    std::vector<uint8_t> data;
+};
+
+//! TCP payload of a packet, see PcapReader::tcpPayload()
+struct PcapTcpSegment {
+    PcapEndpoint from;
+    PcapEndpoint to;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * @brief Reads pcap files with micro or nanosecond timestamps, in either byte
+ * order.
+ */
+class PcapReader {
+  private:
+    std::ifstream _file;
+    PcapLinkType _linkType;
+    bool _swapped     = false;
+    bool _nanoseconds = false;
+    uint32_t _snapLength = 0;
+
+    [[nodiscard]] uint32_t field(const uint8_t *data) const;
+
+  public:
+    /**
+     * @brief Opens capture file.
+     * @throws std::runtime_error - if file cannot be opened or is not a pcap file.
+     */
+    explicit PcapReader(const std::string &path);
+
+    [[nodiscard]] PcapLinkType linkType() const { return _linkType; }
+
+    /**
+     * @brief Reads next packet.
+     * @return Packet or nullopt at the end of the file.
+     * @throws std::runtime_error - if record is longer than the snapshot length
+     * of the capture (corrupted file).
+     */
+    std::optional<PcapPacket> next();
+
+    //! Extracts TCP segment from raw IPv4 packet, nullopt if it is not one
+    static std::optional<PcapTcpSegment> tcpPayload(const std::vector<uint8_t> &packet);
+};
+} // namespace MB
@@ -0,0 +1,133 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Runs periodic jobs (e.g. polls) in deadline order.
+ *
+ * Deadlines are kept in a binary heap, so the scheduler scales to hundreds of
+ * thousands of jobs with periods from milliseconds to hours. Every next deadline
+ * is computed from the previous deadline, not from the time the job was run, so
+ * the jobs do not drift. Jobs with the same period are spread over the period
+ * (instead of all starting at once) to avoid bursts on the bus.
+ *
+ * When a job is so late that a whole period was missed, missed runs are skipped
+ * and the overrun is reported to the handler, see setOverrunHandler().
+ *
+ * Tasks are run by the thread calling run() or runDue(), outside of the internal
+ * lock, so they may add or remove jobs. Usually there is a scheduler per bus and
+ * the tasks perform the transaction (or push it to the bus queue).
+ */
+class PollScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using JobId = std::size_t;
+    using Task  = std::function<void()>;
+
+    //! Describes job that has missed at least one whole period
+    struct Overrun {
+        JobId job;
+        //! Number of skipped runs
+        std::size_t missed;
+        //! How late the job was, when it was finally run
+        Clock::duration lateness;
+    };
+
+    using OverrunHandler = std::function<void(const Overrun &)>;
+
+  private:
+    struct Job {
+        Clock::duration period;
+        Clock::time_point deadline;
+        // Shared, so that it can be run outside of the lock without copying
+        std::shared_ptr<const Task> task;
+        std::size_t overruns;
+    };
+
+    struct Entry {
+        Clock::time_point deadline;
+        JobId job;
+
+        // Inverted, so that std::priority_queue keeps the earliest deadline on top
+        bool operator<(const Entry &other) const {
+            return deadline != other.deadline ? deadline > other.deadline
+                                              : job > other.job;
+        }
+    };
+
+    mutable std::mutex _mutex;
+    std::condition_variable _changed;
+
+    std::unordered_map<JobId, Job> _jobs;
+    // May contain stale entries of removed jobs, they are dropped lazily
+    mutable std::priority_queue<Entry> _deadlines;
+    std::unordered_map<Clock::duration::rep, std::size_t> _periodCounts;
+    JobId _nextJobId = 0;
+
+    OverrunHandler _overrunHandler;
+    std::size_t _overruns = 0;
+    bool _stopped         = false;
+
+    Clock::duration phaseOf(Clock::duration period);
+    void dropStaleEntries() const;
+
+  public:
+    /**
+     * @brief Adds periodic job.
+     * @param period - Interval between runs, has to be positive.
+     * @param task - Function to be run.
+     * @param now - Current time, first run is spread over the first period.
+     * @return Id of the job.
+     * @throws std::invalid_argument - if period is not positive or task is empty.
+     */
+    JobId add(Clock::duration period, Task task, Clock::time_point now = Clock::now());
+
+    //! Removes the job, returns false if there was no such job
+    bool remove(JobId job);
+
+    //! Number of scheduled jobs
+    [[nodiscard]] std::size_t size() const;
+
+    //! Deadline of the most urgent job or nullopt if there are no jobs
+    [[nodiscard]] std::optional<Clock::time_point> nextDeadline() const;
+
+    //! Number of overruns of the given job
+    [[nodiscard]] std::size_t overruns(JobId job) const;
+
+    //! Number of overruns of all jobs, including removed ones
+    [[nodiscard]] std::size_t overruns() const;
+
+    //! Sets handler called (from the running thread) for every overrun
+    void setOverrunHandler(OverrunHandler handler);
+
+    /**
+     * @brief Runs all jobs with deadline not later than now, in deadline order.
+     * @return Number of run tasks.
+     */
+    std::size_t runDue(Clock::time_point now = Clock::now());
+
+    //! Runs jobs as their deadlines come, blocks until stop() is called
+    void run();
+
+    //! Makes run() return, can be called from any thread
+    void stop();
+};
+} // namespace MB
@@ -0,0 +1,118 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "readPlanner.hpp"
+#include "transport.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Reads set of tags in as few requests as possible, over any client
+ * transport.
+ *
+ * Tags are merged by ReadPlanner, every poll() performs the planned reads and
+ * passes values of each tag to its handler. Usually poll() is a task of the
+ * PollScheduler:
+ * ```
+ * Poller poller(connection, 4);
+ * poller.add(1, utils::ReadAnalogInputRegisters, 100, 2, onSpeed);
+ * scheduler.add(100ms, [&]() { poller.poll(); });
+ * ```
+ *
+ * @note Transport is not owned and has to outlive the poller.
+ */
+template <typename Transport> class Poller {
+    static_assert(isClientTransport<Transport>,
+                  "Poller requires transport meeting MB::ClientTransport");
+
+  public:
+    using Handler = std::function<void(const std::vector<ModbusCell> &)>;
+    //! Called with the failed request and the error
+    using ErrorHandler =
+        std::function<void(const ModbusRequest &, const ModbusException &)>;
+
+  private:
+    Transport &_transport;
+    ReadPlanner _planner;
+    // Indexed by tag id
+    std::vector<Handler> _handlers;
+    ErrorHandler _onError;
+
+    std::vector<ReadPlanner::Read> _plan;
+    bool _planned = false;
+
+  public:
+    /**
+     * @brief Creates poller without tags.
+     * @param maxRegisterGap, maxBitGap - Merging limits, see ReadPlanner.
+     */
+    explicit Poller(Transport &transport, uint16_t maxRegisterGap = 0,
+                    uint16_t maxBitGap = 0)
+        : _transport(transport), _planner(maxRegisterGap, maxBitGap) {}
+
+    /**
+     * @brief Adds tag, its values are passed to the handler after every poll.
+     * @return Tag id.
+     * @throws ModbusException - same as ReadPlanner::add().
+     */
+    std::size_t add(uint8_t unitId, utils::MBFunctionCode functionCode, uint16_t address,
+                    uint16_t count, Handler handler) {
+        const auto tag = _planner.add(unitId, functionCode, address, count);
+        _handlers.push_back(std::move(handler));
+        _planned = false;
+        return tag;
+    }
+
+    //! Sets handler of failed reads, which are skipped otherwise
+    void onError(ErrorHandler handler) { _onError = std::move(handler); }
+
+    /**
+     * @brief Performs all planned reads, one after another.
+     *
+     * Failed read does not stop the poll, handlers of its tags are not called.
+     * @return Number of failed reads.
+     */
+    std::size_t poll() {
+        std::size_t failed = 0;
+        for (const auto &read : plan()) {
+            try {
+                const auto response =
+                    TransportTraits<Transport>::transact(_transport, read.request);
+                for (const auto &[tag, values] : ReadPlanner::split(read, response)) {
+                    if (_handlers[tag])
+                        _handlers[tag](values);
+                }
+            } catch (const ModbusException &ex) {
+                failed++;
+                if (_onError)
+                    _onError(read.request, ex);
+            }
+        }
+        return failed;
+    }
+
+    //! Planned reads, recomputed only after tags change
+    const std::vector<ReadPlanner::Read> &plan() {
+        if (!_planned) {
+            _plan    = _planner.plan();
+            _planned = true;
+        }
+        return _plan;
+    }
+
+    //! Number of requests performed by every poll
+    [[nodiscard]] std::size_t requestsPerCycle() { return plan().size(); }
+};
+} // namespace MB
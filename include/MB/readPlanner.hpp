@@ -0,0 +1,113 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Merges many small reads (tags) into few protocol legal requests.
+ *
+ * Tags of the same unit and function code, that are close enough to each
+ * other, are read by a single request of at most MaxReadRegisters registers
+ * or MaxReadBits coils. Values between merged tags (gap) are read and
+ * discarded, which is usually much cheaper than another round trip.
+ *
+ * Example:
+ * ```
+ * ReadPlanner planner(4);
+ * const auto speed = planner.add(1, utils::ReadAnalogInputRegisters, 100, 2);
+ * const auto temp  = planner.add(1, utils::ReadAnalogInputRegisters, 105, 1);
+ * for (const auto &read : planner.plan()) {
+ *     const auto response = send(read.request);
+ *     for (const auto &[tag, values] : ReadPlanner::split(read, response)) { ... }
+ * }
+ * ```
+ */
+class ReadPlanner {
+  public:
+    //! Values of a single tag inside of the planned read
+    struct Slice {
+        //! Tag id, as returned by add()
+        std::size_t tag;
+        //! Offset of the first value of the tag in the response
+        uint16_t offset;
+        uint16_t count;
+    };
+
+    //! Single request, covering one or more tags
+    struct Read {
+        ModbusRequest request;
+        std::vector<Slice> slices;
+    };
+
+  private:
+    struct Tag {
+        uint8_t unitId;
+        utils::MBFunctionCode functionCode;
+        uint16_t address;
+        uint16_t count;
+    };
+
+    std::vector<Tag> _tags;
+    uint16_t _maxRegisterGap;
+    uint16_t _maxBitGap;
+
+  public:
+    /**
+     * @brief Creates planner.
+     * @param maxRegisterGap - Maximal number of unneeded registers read to merge
+     * two tags.
+     * @param maxBitGap - Maximal number of unneeded coils / discrete inputs read to
+     * merge two tags.
+     */
+    explicit ReadPlanner(uint16_t maxRegisterGap = 0, uint16_t maxBitGap = 0)
+        : _maxRegisterGap(maxRegisterGap), _maxBitGap(maxBitGap) {}
+
+    /**
+     * @brief Adds tag that needs to be read.
+     * @return Tag id, used by split() to identify values.
+     * @throws ModbusException - IllegalFunction for non read function codes,
+     * NumberOfRegistersInvalid if count is 0, above single request limit or
+     * runs past the end of address space.
+     */
+    std::size_t add(uint8_t unitId, utils::MBFunctionCode functionCode, uint16_t address,
+                    uint16_t count);
+
+    //! Removes all tags
+    void clear() { _tags.clear(); }
+
+    [[nodiscard]] std::size_t size() const { return _tags.size(); }
+
+    /**
+     * @brief Computes requests covering all tags.
+     *
+     * Requests are ordered by unit id, function code and address. Their number is
+     * minimal for the configured gaps and request size limits.
+     */
+    [[nodiscard]] std::vector<Read> plan() const;
+
+    /**
+     * @brief Splits response to the planned request back into tag values.
+     * @return Pairs of tag id and its values, in order of slices.
+     * @throws ModbusException - InvalidMessageID if response does not match
+     * the request, NumberOfValuesInvalid if it contains too little values.
+     */
+    static std::vector<std::pair<std::size_t, std::vector<ModbusCell>>>
+    split(const Read &read, const ModbusResponse &response);
+};
+} // namespace MB
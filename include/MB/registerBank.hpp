@@ -0,0 +1,175 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "modbusCell.hpp"
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+//! Maximal quantity of coils / discrete inputs in a single read request
+constexpr uint16_t MaxReadBits = 2000;
+//! Maximal quantity of registers in a single read request
+constexpr uint16_t MaxReadRegisters = 125;
+//! Maximal quantity of coils in a single write request
+constexpr uint16_t MaxWriteBits = 1968;
+//! Maximal quantity of registers in a single write request
+constexpr uint16_t MaxWriteRegisters = 123;
+
+/**
+ * @brief Serves request from the storage containing four Modbus tables.
+ *
+ * Storage needs to provide:
+ * - `std::size_t tableSize(utils::MBFunctionRegisters table) const`
+ * - `std::vector<ModbusCell> readCells(utils::MBFunctionRegisters table,
+ *    uint16_t address, uint16_t count) const`
+ * - `void writeCells(utils::MBFunctionRegisters table, uint16_t address,
+ *    const std::vector<ModbusCell> &values)`
+ *
+ * Storage is called only with ranges that fit inside of the table.
+ * Problems with the request are reported by returning (not throwing)
+ * ModbusException with standard error code, ready to be sent back to master:
+ * - IllegalFunction - function code is not supported,
+ * - IllegalDataValue - quantity of values is outside of the protocol limits,
+ * - IllegalDataAddress - requested range does not fit in the table.
+ *
+ * @param storage - Tables that are read / modified.
+ * @param request - Request to serve.
+ * @return Response or exception to be sent back to the master.
+ */
+template <typename Storage>
+std::variant<ModbusResponse, ModbusException> serveRequest(Storage &storage,
+                                                           const ModbusRequest &request) {
+    const auto slaveId  = request.slaveID();
+    const auto function = request.functionCode();
+    const auto address  = request.registerAddress();
+    const auto &values  = request.registerValues();
+
+    uint16_t count = request.numberOfRegisters();
+    uint16_t limit = 0;
+    bool isWrite   = false;
+
+    switch (function) {
+    case utils::ReadDiscreteOutputCoils:
+    case utils::ReadDiscreteInputContacts:
+        limit = MaxReadBits;
+        break;
+    case utils::ReadAnalogOutputHoldingRegisters:
+    case utils::ReadAnalogInputRegisters:
+        limit = MaxReadRegisters;
+        break;
+    case utils::WriteSingleDiscreteOutputCoil:
+    case utils::WriteSingleAnalogOutputRegister:
+        count   = 1;
+        limit   = 1;
+        isWrite = true;
+        break;
+    case utils::WriteMultipleDiscreteOutputCoils:
+        limit   = MaxWriteBits;
+        isWrite = true;
+        break;
+    case utils::WriteMultipleAnalogOutputHoldingRegisters:
+        limit   = MaxWriteRegisters;
+        isWrite = true;
+        break;
+    default:
+        return ModbusException(utils::IllegalFunction, slaveId, function);
+    }
+
+    if (count == 0 || count > limit || (isWrite && values.size() != count))
+        return ModbusException(utils::IllegalDataValue, slaveId, function);
+
+    const auto table = utils::functionRegister(function);
+    if (static_cast<std::size_t>(address) + count > storage.tableSize(table))
+        return ModbusException(utils::IllegalDataAddress, slaveId, function);
+
+    if (isWrite) {
+        storage.writeCells(table, address, values);
+        return ModbusResponse(slaveId, function, address, count, values);
+    }
+
+    return ModbusResponse(slaveId, function, address, count,
+                          storage.readCells(table, address, count));
+}
+
+/**
+ * @brief In-memory data model of a Modbus slave.
+ *
+ * Holds the four standard tables (coils, discrete inputs, holding registers and
+ * input registers) in contiguous arrays and serves requests directly from them.
+ * Tables are addressed from 0, so a table of size N accepts addresses 0..N-1.
+ *
+ * @note Class is not thread safe, see ConcurrentRegisterBank for that.
+ */
+class RegisterBank {
+  private:
+    // Coils are stored one per byte, so that they can be accessed without bit
+    // twiddling and are not subject to std::vector<bool> specialization
+    std::vector<uint8_t> _coils;
+    std::vector<uint8_t> _discreteInputs;
+    std::vector<uint16_t> _holdingRegisters;
+    std::vector<uint16_t> _inputRegisters;
+
+  public:
+    /**
+     * @brief Constructs bank with all values set to 0.
+     * @param coils - Number of coils.
+     * @param discreteInputs - Number of discrete inputs.
+     * @param holdingRegisters - Number of holding registers.
+     * @param inputRegisters - Number of input registers.
+     */
+    explicit RegisterBank(std::size_t coils = 0, std::size_t discreteInputs = 0,
+                          std::size_t holdingRegisters = 0,
+                          std::size_t inputRegisters = 0)
+        : _coils(coils), _discreteInputs(discreteInputs),
+          _holdingRegisters(holdingRegisters), _inputRegisters(inputRegisters) {}
+
+    /**
+     * @brief Serves request from the bank, see serveRequest for details.
+     * @param request - Request to serve.
+     * @return Response or exception to be sent back to the master.
+     */
+    [[nodiscard]] std::variant<ModbusResponse, ModbusException>
+    handle(const ModbusRequest &request);
+
+    //! Returns number of values in the table
+    [[nodiscard]] std::size_t tableSize(utils::MBFunctionRegisters table) const;
+
+    //! Reads values from the table, range has to be valid
+    [[nodiscard]] std::vector<ModbusCell> readCells(utils::MBFunctionRegisters table,
+                                                    uint16_t address,
+                                                    uint16_t count) const;
+
+    //! Writes values to the table, range has to be valid
+    void writeCells(utils::MBFunctionRegisters table, uint16_t address,
+                    const std::vector<ModbusCell> &values);
+
+    [[nodiscard]] std::vector<uint8_t> &coils() { return _coils; }
+    [[nodiscard]] std::vector<uint8_t> &discreteInputs() { return _discreteInputs; }
+    [[nodiscard]] std::vector<uint16_t> &holdingRegisters() { return _holdingRegisters; }
+    [[nodiscard]] std::vector<uint16_t> &inputRegisters() { return _inputRegisters; }
+
+    [[nodiscard]] const std::vector<uint8_t> &coils() const { return _coils; }
+    [[nodiscard]] const std::vector<uint8_t> &discreteInputs() const {
+        return _discreteInputs;
+    }
+    [[nodiscard]] const std::vector<uint16_t> &holdingRegisters() const {
+        return _holdingRegisters;
+    }
+    [[nodiscard]] const std::vector<uint16_t> &inputRegisters() const {
+        return _inputRegisters;
+    }
+};
+} // namespace MB
@@ -0,0 +1,118 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <variant>
+#include <vector>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+//! Result of serving a request - response or exception to be sent to the master
+using HandlerResult = std::variant<ModbusResponse, ModbusException>;
+
+/**
+ * @brief Maps function codes to user handlers.
+ *
+ * Handlers are kept in dense tables indexed directly by the function code byte,
+ * so dispatching is a single lookup without any switch over function codes.
+ * Requests with function codes without handler are answered with
+ * IllegalFunction exception, which is returned and never thrown.
+ */
+class RequestDispatcher {
+  public:
+    //! Handler of parsed request
+    using Handler = std::function<HandlerResult(const ModbusRequest &)>;
+
+    /**
+     * Handler of raw request, used for function codes that ModbusRequest cannot
+     * represent (e.g. vendor specific ones). It receives raw request (slave id,
+     * function code and data, without CRC) and returns raw response in the
+     * same form.
+     */
+    using RawHandler = std::function<std::vector<uint8_t>(const std::vector<uint8_t> &)>;
+
+  private:
+    std::array<Handler, 256> _handlers;
+    std::array<RawHandler, 256> _rawHandlers;
+
+  public:
+    //! Registers handler for the function code, replacing previous one
+    void on(utils::MBFunctionCode functionCode, Handler handler) {
+        _handlers[functionCode] = std::move(handler);
+    }
+
+    //! Registers raw handler for the function code, it takes precedence in dispatchRaw()
+    void onRaw(uint8_t functionCode, RawHandler handler) {
+        _rawHandlers[functionCode] = std::move(handler);
+    }
+
+    //! Removes all handlers of the function code
+    void remove(uint8_t functionCode) {
+        _handlers[functionCode]    = nullptr;
+        _rawHandlers[functionCode] = nullptr;
+    }
+
+    //! Checks if there is any handler for the function code
+    [[nodiscard]] bool has(uint8_t functionCode) const {
+        return _handlers[functionCode] || _rawHandlers[functionCode];
+    }
+
+    /**
+     * @brief Registers all standard function codes to be served by `bank`.
+     * @param bank - Object with `handle(const ModbusRequest &)` method, like
+     * RegisterBank. It must outlive the dispatcher.
+     */
+    template <typename Bank> void serve(Bank &bank) {
+        const auto handler = [&bank](const ModbusRequest &request) -> HandlerResult {
+            return bank.handle(request);
+        };
+
+        for (const auto code : {utils::ReadDiscreteOutputCoils,
+                                utils::ReadDiscreteInputContacts,
+                                utils::ReadAnalogOutputHoldingRegisters,
+                                utils::ReadAnalogInputRegisters,
+                                utils::WriteSingleDiscreteOutputCoil,
+                                utils::WriteSingleAnalogOutputRegister,
+                                utils::WriteMultipleDiscreteOutputCoils,
+                                utils::WriteMultipleAnalogOutputHoldingRegisters}) {
+            on(code, handler);
+        }
+    }
+
+    /**
+     * @brief Passes request to the handler registered for its function code.
+     * @return Result of the handler or IllegalFunction exception.
+     */
+    [[nodiscard]] HandlerResult dispatch(const ModbusRequest &request) const {
+        const auto &handler = _handlers[request.functionCode()];
+        if (!handler)
+            return ModbusException(utils::IllegalFunction, request.slaveID(),
+                                   request.functionCode());
+        return handler(request);
+    }
+
+    /**
+     * @brief Serves raw request (without CRC / MBAP header).
+     *
+     * Raw handler is used if one is registered for the function code, otherwise
+     * request is parsed and passed to dispatch(). Malformed requests are answered
+     * with IllegalDataValue exception.
+     *
+     * @return Raw response or exception, ready to be sent to the master.
+     */
+    [[nodiscard]] std::vector<uint8_t>
+    dispatchRaw(const std::vector<uint8_t> &request) const;
+};
+} // namespace MB
@@ -0,0 +1,214 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+//! Priority classes of requests waiting for a shared bus, most urgent first
+enum class RequestPriority : uint8_t {
+    //! E.g. alarms
+    Urgent = 0,
+    //! E.g. operator writes / setpoints
+    High = 1,
+    //! E.g. cyclic polling
+    Normal = 2,
+    //! E.g. bulk historian reads
+    Low = 3,
+};
+
+//! Number of RequestPriority classes
+constexpr std::size_t RequestPriorityCount = 4;
+
+//! Queueing statistics of a single priority class
+struct RequestQueueStats {
+    //! Number of items taken from the queue
+    std::size_t served = 0;
+    //! Sum of the time items spent in the queue
+    std::chrono::steady_clock::duration totalDelay{0};
+    //! Longest time an item spent in the queue
+    std::chrono::steady_clock::duration maxDelay{0};
+    //! Number of items waiting now
+    std::size_t waiting = 0;
+};
+
+/**
+ * @brief Thread safe queue of requests waiting for a shared bus.
+ *
+ * Items are served by priority class. Within a class, items are kept in FIFO
+ * order per source (e.g. TCP client), while sources are served in round robin,
+ * so that a single busy source cannot starve others.
+ *
+ * To prevent starvation of lower classes, items age: every aging interval spent
+ * in the queue raises the priority of the item by one class.
+ */
+template <typename T> class RequestQueue {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    //! Default time after which waiting item is promoted by one class
+    static constexpr std::chrono::milliseconds DefaultAging{1000};
+
+  private:
+    struct Entry {
+        T item;
+        Clock::time_point enqueued;
+    };
+
+    struct Class {
+        std::unordered_map<std::size_t, std::deque<Entry>> pending;
+        std::deque<std::size_t> order;
+        std::size_t size = 0;
+        RequestQueueStats stats;
+    };
+
+    mutable std::mutex _mutex;
+    std::condition_variable _available;
+
+    std::array<Class, RequestPriorityCount> _classes;
+    Clock::duration _aging = DefaultAging;
+    std::size_t _size      = 0;
+    bool _closed           = false;
+
+    // Has to be called with the mutex locked and non empty queue
+    std::size_t selectClass(Clock::time_point now) const {
+        std::size_t selected  = RequestPriorityCount;
+        long long bestRank    = 0;
+        const auto agingTicks = _aging.count();
+
+        for (std::size_t c = 0; c < RequestPriorityCount; c++) {
+            const auto &queue = _classes[c];
+            if (queue.size == 0)
+                continue;
+
+            // Next item of the class is the head of the first source in order
+            const auto &head = queue.pending.at(queue.order.front()).front();
+            const auto waited = (now - head.enqueued).count();
+            auto rank         = static_cast<long long>(c);
+            if (agingTicks > 0)
+                rank -= static_cast<long long>(waited / agingTicks);
+
+            // Ties go to the more urgent class
+            if (selected == RequestPriorityCount || rank < bestRank) {
+                selected = c;
+                bestRank = rank;
+            }
+        }
+
+        return selected;
+    }
+
+    // Has to be called with the mutex locked and non empty queue
+    T take(Clock::time_point now) {
+        auto &queue = _classes[selectClass(now)];
+
+        const auto source = queue.order.front();
+        queue.order.pop_front();
+
+        auto &items = queue.pending[source];
+        Entry entry = std::move(items.front());
+        items.pop_front();
+
+        if (items.empty())
+            queue.pending.erase(source);
+        else
+            queue.order.push_back(source);
+
+        const auto delay = now - entry.enqueued;
+        queue.stats.served++;
+        queue.stats.totalDelay += delay;
+        if (delay > queue.stats.maxDelay)
+            queue.stats.maxDelay = delay;
+
+        queue.size--;
+        _size--;
+        return std::move(entry.item);
+    }
+
+  public:
+    /**
+     * @brief Adds item to the back of the source queue.
+     * @return False if queue is closed and item was dropped.
+     */
+    bool push(std::size_t source, T item,
+              RequestPriority priority = RequestPriority::Normal,
+              Clock::time_point now    = Clock::now()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_closed)
+                return false;
+
+            auto &queue = _classes[static_cast<std::size_t>(priority)];
+            auto &items = queue.pending[source];
+            if (items.empty())
+                queue.order.push_back(source);
+            items.push_back(Entry{std::move(item), now});
+            queue.size++;
+            _size++;
+        }
+        _available.notify_one();
+        return true;
+    }
+
+    //! Waits for next item, returns nullopt when queue gets closed
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _available.wait(lock, [this]() { return _closed || _size > 0; });
+
+        if (_size == 0)
+            return std::nullopt;
+        return take(Clock::now());
+    }
+
+    //! Returns next item if there is any, never blocks
+    std::optional<T> tryPop(Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_size == 0)
+            return std::nullopt;
+        return take(now);
+    }
+
+    //! Wakes up all waiters, following pushes are rejected
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _available.notify_all();
+    }
+
+    //! Sets time after which waiting item is promoted by one class, 0 disables aging
+    void setAging(Clock::duration aging) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _aging = aging;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+
+    //! Queueing statistics of the priority class
+    [[nodiscard]] RequestQueueStats stats(RequestPriority priority) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto &queue = _classes[static_cast<std::size_t>(priority)];
+
+        auto stats    = queue.stats;
+        stats.waiting = queue.size;
+        return stats;
+    }
+};
+} // namespace MB
@@ -0,0 +1,124 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Short lived cache of read responses.
+ *
+ * Meant for gateways, where several masters poll the same registers of a slow
+ * device within milliseconds of each other. Only responses to read functions
+ * (FC01 - FC04) are cached, keyed by unit id, function code, address and count.
+ * Every unit has its own time to live, 0 (default) disables caching for it.
+ *
+ * Frames are passed as unit id followed by PDU, without CRC or MBAP header,
+ * which is what toRaw() methods return. The cache is thread safe.
+ */
+class ResponseCache {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    //! Identifies read request
+    struct Key {
+        uint8_t unitId;
+        utils::MBFunctionCode functionCode;
+        uint16_t address;
+        uint16_t count;
+
+        bool operator==(const Key &other) const {
+            return unitId == other.unitId && functionCode == other.functionCode &&
+                   address == other.address && count == other.count;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept {
+            return std::hash<uint64_t>()(
+                (static_cast<uint64_t>(key.unitId) << 40) |
+                (static_cast<uint64_t>(key.functionCode) << 32) |
+                (static_cast<uint64_t>(key.address) << 16) | key.count);
+        }
+    };
+
+    /**
+     * @brief Creates key for the read request.
+     * @return Key or nullopt if frame is not a well formed read request.
+     */
+    static std::optional<Key> keyOf(const std::vector<uint8_t> &request);
+
+    /**
+     * @brief Checks whether the request may change data read by the key.
+     *
+     * Writes affect reads of the same table, that overlap written range. Other
+     * non read functions (e.g. vendor specific) may change anything of the
+     * unit. Broadcasts affect all units.
+     */
+    static bool affects(const std::vector<uint8_t> &request, const Key &key);
+
+  private:
+    struct Entry {
+        std::vector<uint8_t> response;
+        Clock::time_point expires;
+    };
+
+    mutable std::mutex _mutex;
+    std::unordered_map<Key, Entry, KeyHash> _entries;
+    std::array<Clock::duration, 256> _ttl;
+    std::size_t _nextPurge = MinPurgeSize;
+
+    static constexpr std::size_t MinPurgeSize = 64;
+
+    void purge(Clock::time_point now);
+
+  public:
+    ResponseCache();
+
+    //! Sets time to live of responses from all units
+    void setTtl(Clock::duration ttl);
+    //! Sets time to live of responses from given unit, 0 disables caching
+    void setTtl(uint8_t unitId, Clock::duration ttl);
+    [[nodiscard]] Clock::duration ttl(uint8_t unitId) const;
+
+    /**
+     * @brief Finds fresh response for the request.
+     * @return Cached response or nullopt if there is none or it has expired.
+     */
+    std::optional<std::vector<uint8_t>> lookup(const Key &key,
+                                               Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Stores response for the request.
+     * @note Exception responses are never stored.
+     */
+    void store(const Key &key, const std::vector<uint8_t> &response,
+               Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Drops every entry that could be affected by the request (see
+     * affects()).
+     */
+    void invalidate(const std::vector<uint8_t> &request);
+
+    //! Drops all entries
+    void clear();
+
+    //! Number of entries, including expired ones that were not purged yet
+    [[nodiscard]] std::size_t size() const;
+};
+} // namespace MB
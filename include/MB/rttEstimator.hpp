@@ -0,0 +1,91 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Estimates response time of every unit and derives timeouts from it.
+ *
+ * Works like TCP retransmission timer (RFC 6298): smoothed round trip time
+ * (SRTT) and its variation (RTTVAR) are updated with every response and timeout
+ * is `SRTT + 4 * RTTVAR`, clamped to the configured range. Every timeout doubles
+ * the timeout of the unit (up to the maximum) until next response arrives, so
+ * that a busy device is not flooded with requests it cannot answer in time.
+ *
+ * Estimator is thread safe, so it may be shared by several connections to the
+ * same devices and read for monitoring.
+ */
+class RttEstimator {
+  public:
+    using Duration = std::chrono::microseconds;
+
+    //! Current estimate for a single unit
+    struct Estimate {
+        //! Smoothed round trip time
+        Duration srtt;
+        //! Round trip time variation
+        Duration rttvar;
+        //! Timeout that will be used for the next request
+        Duration timeout;
+        std::size_t samples;
+        //! Timeouts since last response
+        std::size_t timeouts;
+    };
+
+  private:
+    struct Unit {
+        Duration srtt{0};
+        Duration rttvar{0};
+        std::size_t samples  = 0;
+        std::size_t timeouts = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::array<Unit, 256> _units;
+    Duration _initialTimeout;
+    Duration _minTimeout;
+    Duration _maxTimeout;
+
+    [[nodiscard]] Duration timeoutOf(const Unit &unit) const;
+
+  public:
+    /**
+     * @brief Creates estimator.
+     * @param initialTimeout - Timeout used until first response of the unit.
+     * @param minTimeout - Lower bound of the timeout, should cover the scheduling
+     * jitter of the system.
+     * @param maxTimeout - Upper bound of the timeout, also for backoff.
+     * @throws std::invalid_argument - if bounds are not ordered.
+     */
+    explicit RttEstimator(Duration initialTimeout = std::chrono::milliseconds(500),
+                          Duration minTimeout     = std::chrono::milliseconds(10),
+                          Duration maxTimeout     = std::chrono::seconds(10));
+
+    //! Updates estimate of the unit with the response time
+    void sample(uint8_t unitId, Duration rtt);
+
+    //! Notes that unit did not respond in time, backs off its timeout
+    void timedOut(uint8_t unitId);
+
+    //! Timeout for the next request to the unit
+    [[nodiscard]] Duration timeout(uint8_t unitId) const;
+
+    //! Current estimate of the unit, nullopt if it has never responded
+    [[nodiscard]] std::optional<Estimate> estimate(uint8_t unitId) const;
+
+    //! Forgets everything about the unit
+    void reset(uint8_t unitId);
+};
+} // namespace MB
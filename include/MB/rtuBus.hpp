@@ -0,0 +1,122 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+//! Modbus RTU (serial line) framing
+namespace MB::RTU {
+//! Usage of the bus since the statistics were reset
+struct BusStats {
+    using Duration = std::chrono::steady_clock::duration;
+
+    //! Transactions with response expected, including failed ones
+    uint64_t transactions = 0;
+    //! Broadcasts, these are never answered
+    uint64_t broadcasts = 0;
+    //! Transactions that ended with exception response
+    uint64_t exceptions = 0;
+    //! Transactions without valid response (e.g. timeout)
+    uint64_t failures = 0;
+    uint64_t bytesSent     = 0;
+    uint64_t bytesReceived = 0;
+
+    //! Time the line carried frames
+    Duration wire{0};
+    //! Time the bus was reserved by transactions, including the gaps and waiting
+    //! for the slaves
+    Duration busy{0};
+    //! Time since the statistics were reset
+    Duration elapsed{0};
+
+    //! Fraction of time the line carried frames
+    [[nodiscard]] double utilization() const {
+        return elapsed.count() > 0 ? static_cast<double>(wire.count()) / elapsed.count()
+                                   : 0;
+    }
+
+    //! Fraction of time the bus was not available for other transactions
+    [[nodiscard]] double occupancy() const {
+        return elapsed.count() > 0 ? static_cast<double>(busy.count()) / elapsed.count()
+                                   : 0;
+    }
+};
+
+/**
+ * @brief Timing of the transactions on a multi-drop bus.
+ *
+ * Keeps the silent interval (at least t3.5) between the end of every frame
+ * and the next request, and turnaround delay after broadcasts, so that all
+ * slaves process the broadcast before they are addressed again.
+ *
+ * Frames are accounted with 11 bits per character, which gives the time the
+ * line carried data and its utilization.
+ *
+ * Not thread safe.
+ */
+class BusSchedule {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    //! Default delay after the broadcast
+    static constexpr std::chrono::milliseconds DefaultTurnaround{100};
+
+  private:
+    unsigned int _baudRate;
+    std::chrono::microseconds _gap;
+    std::chrono::microseconds _turnaround = DefaultTurnaround;
+
+    Clock::time_point _freeAt;
+    Clock::time_point _transactionStart;
+    // End of the request transmission
+    Clock::time_point _transmitted;
+    Clock::time_point _statsStart;
+    BusStats _stats;
+
+  public:
+    /**
+     * @brief Creates schedule of the bus with the given baud rate.
+     * @throws std::invalid_argument - if baud rate is 0.
+     */
+    explicit BusSchedule(unsigned int baudRate, Clock::time_point now = Clock::now());
+
+    //! Silence before every request, by default t3.5 of the baud rate
+    void setInterFrameGap(std::chrono::microseconds gap) { _gap = gap; }
+
+    [[nodiscard]] std::chrono::microseconds getInterFrameGap() const { return _gap; }
+
+    //! Silence after every broadcast
+    void setTurnaround(std::chrono::microseconds turnaround) { _turnaround = turnaround; }
+
+    [[nodiscard]] std::chrono::microseconds getTurnaround() const { return _turnaround; }
+
+    //! Time needed to transmit the bytes
+    [[nodiscard]] Clock::duration wireTime(std::size_t bytes) const;
+
+    //! Earliest time the next request may be sent
+    [[nodiscard]] Clock::time_point freeAt() const { return _freeAt; }
+
+    /**
+     * @brief Records request (with CRC) written to the line.
+     * @param broadcast - If set, no response is expected and transaction ends
+     * with the turnaround delay.
+     */
+    void sent(std::size_t size, bool broadcast, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Records end of the transaction.
+     * @param responseSize - Size of the received response, 0 if there was none.
+     * @param exception - Response was an exception response.
+     */
+    void finished(std::size_t responseSize, bool exception,
+                  Clock::time_point now = Clock::now());
+
+    [[nodiscard]] BusStats stats(Clock::time_point now = Clock::now()) const;
+
+    void resetStats(Clock::time_point now = Clock::now());
+};
+} // namespace MB::RTU
@@ -0,0 +1,189 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "MB/modbusRequest.hpp"
+
+//! Modbus RTU (serial line) framing
+namespace MB::RTU {
+//! Largest RTU frame, including unit id and CRC
+constexpr std::size_t MaxFrameSize = 256;
+//! Smallest RTU frame: unit id, function code and CRC
+constexpr std::size_t MinFrameSize = 4;
+//! Size of exception response: unit id, function code, exception code and CRC
+constexpr std::size_t ExceptionResponseSize = 5;
+
+/**
+ * @brief Exact size of the normal (not exception) response to the request,
+ * including unit id and CRC.
+ * @throws std::runtime_error - if function code is not supported.
+ */
+std::size_t expectedResponseSize(const ModbusRequest &request);
+
+//! Silent intervals of the serial line
+struct Timing {
+    //! Longest allowed gap between characters of the frame (t1.5)
+    std::chrono::microseconds interCharacter;
+    //! Shortest gap between frames (t3.5)
+    std::chrono::microseconds interFrame;
+
+    /**
+     * @brief Intervals for the baud rate, as defined by the specification.
+     *
+     * Character has 11 bits, above 19200 bauds fixed 750us and 1750us are
+     * used.
+     * @throws std::invalid_argument - if baud rate is 0.
+     */
+    static Timing forBaudRate(unsigned int baudRate);
+};
+
+/**
+ * @brief Splits stream of bytes received from the serial line into frames.
+ *
+ * Frame ends after silence of t3.5, or as soon as received bytes form a
+ * complete frame with valid CRC: expected response (see expect()) or request,
+ * whose length is known from its header (so that the caller does not wait for
+ * the silence in the common case). CRC is updated with every received byte, so
+ * nothing is parsed repeatedly.
+ *
+ * Unless strict, silence is measured between reads, not between bytes on the
+ * line, and USB adapters deliver bytes in packets. So the frame may be given
+ * longer minimum gap (see setMinimumGap()) and expected response is never
+ * ended by silence before it is complete - the caller's timeout ends it.
+ *
+ * Bytes are kept in fixed ring buffer, when no silence comes for more than
+ * MaxFrameSize bytes, only the newest bytes are kept. If bytes between two
+ * silences are not a single valid frame (noise, or frames sent back to back),
+ * they are searched for valid frames and everything else is discarded.
+ *
+ * Only frames with valid CRC are returned.
+ */
+class Framer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    std::array<uint8_t, MaxFrameSize> _ring{};
+    std::size_t _start = 0;
+    std::size_t _size  = 0;
+    // CRC of all bytes since last silence, invalid after the ring overflowed
+    uint16_t _crc    = 0xFFFF;
+    bool _overflowed = false;
+    // Gap longer than t1.5 (but shorter than t3.5) was seen in the frame
+    bool _late = false;
+    // Size of the expected normal response, 0 if unknown
+    std::size_t _expected = 0;
+    Clock::time_point _lastByte;
+
+    Timing _timing;
+    bool _strict = false;
+    Clock::duration _minimumGap{0};
+
+    std::deque<std::vector<uint8_t>> _frames;
+    uint64_t _discardedBytes = 0;
+    uint64_t _lateCharacters = 0;
+
+    [[nodiscard]] uint8_t at(std::size_t index) const {
+        return _ring[(_start + index) % MaxFrameSize];
+    }
+
+    // Size of the buffered request, known from its header, 0 if it is unknown
+    [[nodiscard]] std::size_t requestSize() const;
+    // Silence that ends the frame
+    [[nodiscard]] Clock::duration frameGap() const;
+    // Expected response is incomplete and silence does not end it
+    [[nodiscard]] bool holding() const { return !_strict && remaining() > 0; }
+    // Ends current frame, finds valid frames in it
+    void close();
+    void emit(std::size_t offset, std::size_t size);
+    void clear();
+
+  public:
+    explicit Framer(const Timing &timing = Timing::forBaudRate(19200));
+
+    void setTiming(const Timing &timing) { _timing = timing; }
+
+    [[nodiscard]] const Timing &getTiming() const { return _timing; }
+
+    /**
+     * @brief In strict mode frames with gap longer than t1.5 are discarded.
+     *
+     * Off by default, as timestamps of bytes buffered by the kernel or USB
+     * adapter are rarely precise enough for it.
+     */
+    void setStrict(bool strict) { _strict = strict; }
+
+    /**
+     * @brief Sets shortest silence that ends the frame, if it is longer than
+     * t3.5. Ignored in strict mode.
+     */
+    void setMinimumGap(Clock::duration gap) { _minimumGap = gap; }
+
+    [[nodiscard]] Clock::duration getMinimumGap() const { return _minimumGap; }
+
+    /**
+     * @brief Adds bytes received from the line.
+     * @param now - Time of reception, it should be taken right after the bytes
+     * became available.
+     */
+    void append(const uint8_t *data, std::size_t size,
+                Clock::time_point now = Clock::now());
+
+    //! Adds bytes received from the line
+    void append(const std::vector<uint8_t> &data, Clock::time_point now = Clock::now()) {
+        append(data.data(), data.size(), now);
+    }
+
+    /**
+     * @brief Extracts next complete frame.
+     * @return Frame with CRC, or nullopt if there is none yet.
+     */
+    std::optional<std::vector<uint8_t>> next(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Sets size of the expected response, 0 if it is not known.
+     *
+     * Response ends exactly after the expected number of bytes (or after
+     * ExceptionResponseSize bytes, for exception response) if its CRC is
+     * valid, so no prefix of it can be taken for a frame and bytes following
+     * it start the next frame. Silence does not end incomplete response, unless
+     * strict. Bytes after the complete response, that is not valid, are framed
+     * by silences, as usual.
+     */
+    void expect(std::size_t size) { _expected = size; }
+
+    /**
+     * @brief Number of bytes missing from the expected response, so that the
+     * caller does not read more than that, 0 if it is not known.
+     */
+    [[nodiscard]] std::size_t remaining() const;
+
+    /**
+     * @brief Time when buffered bytes end the frame (if no more come), nullopt
+     * if there are none, or if they are incomplete expected response.
+     */
+    [[nodiscard]] std::optional<Clock::time_point> completesAt() const;
+
+    //! Number of bytes, which are not a frame yet
+    [[nodiscard]] std::size_t bufferedBytes() const { return _size; }
+
+    //! Discards everything received so far
+    void reset();
+
+    //! Number of received bytes that were not part of any valid frame
+    [[nodiscard]] uint64_t discardedBytes() const { return _discardedBytes; }
+
+    //! Number of gaps longer than t1.5 inside frames
+    [[nodiscard]] uint64_t lateCharacters() const { return _lateCharacters; }
+};
+} // namespace MB::RTU
@@ -0,0 +1,97 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @brief Bounded lock free queue for exactly one producer and one consumer thread.
+ *
+ * Head and tail live on separate cache lines and every side caches the last
+ * seen position of the other one, so in the common case push and pop touch
+ * only their own cache line.
+ */
+template <typename T> class SpscQueue {
+  private:
+    std::unique_ptr<std::optional<T>[]> _slots;
+    std::size_t _mask;
+
+    alignas(64) std::atomic<std::size_t> _head{0}; // Next slot to write
+    std::size_t _cachedTail = 0;                    // Producer's view of _tail
+    alignas(64) std::atomic<std::size_t> _tail{0}; // Next slot to read
+    std::size_t _cachedHead = 0;                    // Consumer's view of _head
+
+  public:
+    /**
+     * @brief Creates queue.
+     * @param capacity - Maximal number of items, has to be a power of two.
+     * @throws std::invalid_argument - if capacity is not a power of two.
+     */
+    explicit SpscQueue(std::size_t capacity) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("Queue capacity has to be a power of two");
+
+        _slots = std::make_unique<std::optional<T>[]>(capacity);
+        _mask  = capacity - 1;
+    }
+
+    SpscQueue(const SpscQueue &)            = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    //! Adds item, returns false (item is left intact) if queue is full. Producer only.
+    template <typename U> bool tryPush(U &&item) {
+        const auto head = _head.load(std::memory_order_relaxed);
+        if (head - _cachedTail > _mask) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head - _cachedTail > _mask)
+                return false;
+        }
+
+        _slots[head & _mask].emplace(std::forward<U>(item));
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! Oldest item or nullptr if queue is empty, item stays in the queue. Consumer only.
+    T *front() {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _cachedHead) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            if (tail == _cachedHead)
+                return nullptr;
+        }
+        return &*_slots[tail & _mask];
+    }
+
+    //! Removes oldest item, queue must not be empty. Consumer only.
+    void pop() {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        _slots[tail & _mask].reset();
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+
+    //! Takes oldest item, if there is any. Consumer only.
+    std::optional<T> tryPop() {
+        auto *item = front();
+        if (item == nullptr)
+            return std::nullopt;
+
+        std::optional<T> result(std::move(*item));
+        pop();
+        return result;
+    }
+
+    [[nodiscard]] std::size_t capacity() const { return _mask + 1; }
+};
+} // namespace MB
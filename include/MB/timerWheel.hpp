@@ -0,0 +1,88 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace MB {
+/**
+ * @brief Hashed timer wheel for many short, often rearmed timeouts.
+ *
+ * Time is divided into ticks, every timer is put into the slot of its tick
+ * (modulo the number of slots), so scheduling and cancelling are O(1), unlike
+ * with a heap. It suits timeouts that are usually cancelled before they expire,
+ * like response timeouts and inter-frame silences of many ports.
+ *
+ * Timers never fire early, at most one tick late. Not thread safe, timers are
+ * fired by the thread calling advance().
+ */
+class TimerWheel {
+  public:
+    using Clock    = std::chrono::steady_clock;
+    using TimerId  = uint64_t;
+    using Callback = std::function<void()>;
+
+  private:
+    struct Timer {
+        uint64_t tick;
+        Callback callback;
+    };
+
+    Clock::duration _tick;
+    Clock::time_point _origin;
+    // Last processed tick
+    uint64_t _current = 0;
+    // Slots may contain ids of cancelled timers, they are dropped lazily
+    std::vector<std::vector<TimerId>> _slots;
+    std::unordered_map<TimerId, Timer> _timers;
+    TimerId _nextId = 0;
+
+    [[nodiscard]] uint64_t tickOf(Clock::time_point time) const;
+
+  public:
+    /**
+     * @brief Creates empty wheel.
+     * @param tick - Resolution of the timers.
+     * @param slots - Number of slots, timers further than one revolution stay
+     * in their slot for more revolutions.
+     * @throws std::invalid_argument - if tick is not positive or there are no
+     * slots.
+     */
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                        std::size_t slots = 256, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Schedules callback to be called at the given time.
+     * @return Id of the timer, which can be cancelled.
+     */
+    TimerId schedule(Clock::time_point at, Callback callback);
+
+    //! Cancels the timer, returns false if it has already fired or was cancelled
+    bool cancel(TimerId timer);
+
+    /**
+     * @brief Fires all timers due at the given time, in order of their ticks.
+     *
+     * Callbacks may schedule and cancel timers, timers scheduled for the past
+     * are fired by the next call.
+     * @return Number of fired timers.
+     */
+    std::size_t advance(Clock::time_point now = Clock::now());
+
+    //! Time of the earliest timer or nullopt if there are no timers
+    [[nodiscard]] std::optional<Clock::time_point> nextExpiry() const;
+
+    //! Number of pending timers
+    [[nodiscard]] std::size_t size() const { return _timers.size(); }
+
+    [[nodiscard]] Clock::duration tick() const { return _tick; }
+};
+} // namespace MB
@@ -0,0 +1,204 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "modbusUtils.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+//! What happened with the frame
+enum class TraceEvent : uint8_t {
+    FrameSent,
+    FrameReceived,
+    //! Frame was successfully parsed into a request / response
+    FrameParsed,
+    //! Error (timeout, parse error, exception response...), see TraceRecord::error
+    Error,
+    //! Server accepted new client
+    ConnectionAccepted,
+};
+
+//! Part of the library that emitted the event
+enum class TraceSource : uint8_t {
+    TCP,
+    Serial,
+    Server,
+    RequestParser,
+    ResponseParser,
+};
+
+/**
+ * @brief Single traced event, fixed size so that tracing never allocates.
+ *
+ * Only the beginning of the frame is captured (`MaxBytes`), `size` is the size
+ * of the whole frame.
+ */
+struct TraceRecord {
+    static constexpr std::size_t MaxBytes = 32;
+
+    //! Steady clock time of the event in nanoseconds
+    uint64_t timestamp = 0;
+    //! Native handle of the connection (socket / serial fd), -1 for parsers
+    int32_t channel    = -1;
+    TraceEvent event   = TraceEvent::Error;
+    TraceSource source = TraceSource::TCP;
+    //! Error code for TraceEvent::Error, 0 otherwise
+    uint8_t error      = 0;
+    uint16_t size      = 0;
+    std::array<uint8_t, MaxBytes> bytes{};
+
+    //! Current steady clock time in nanoseconds
+    static uint64_t now() {
+        const auto since = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+    }
+
+    //! Number of captured bytes
+    [[nodiscard]] std::size_t captured() const {
+        return std::min<std::size_t>(size, MaxBytes);
+    }
+};
+
+/**
+ * @brief Bounded lock free multi producer / multi consumer ring of trace records.
+ *
+ * Producers never block nor allocate: when the ring is full, record is dropped
+ * and counted, so that a slow consumer cannot slow down the traced code.
+ */
+class TraceRing {
+  private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        TraceRecord record;
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    std::size_t _mask;
+    alignas(64) std::atomic<std::size_t> _head{0};
+    alignas(64) std::atomic<std::size_t> _tail{0};
+    alignas(64) std::atomic<uint64_t> _dropped{0};
+
+  public:
+    /**
+     * @brief Creates ring.
+     * @param capacity - Number of records, has to be a power of two.
+     * @throws std::invalid_argument - if capacity is not a power of two.
+     */
+    explicit TraceRing(std::size_t capacity = 4096);
+
+    TraceRing(const TraceRing &)            = delete;
+    TraceRing &operator=(const TraceRing &) = delete;
+
+    //! Adds record, returns false (and counts the drop) if ring is full
+    bool tryPush(const TraceRecord &record);
+
+    //! Takes the oldest record, if there is any
+    std::optional<TraceRecord> tryPop();
+
+    //! Passes all currently available records to the function, returns their count
+    template <typename Function> std::size_t drain(Function &&function) {
+        std::size_t count = 0;
+        while (auto record = tryPop()) {
+            function(*record);
+            count++;
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::size_t capacity() const { return _mask + 1; }
+
+    //! Number of records dropped because ring was full
+    [[nodiscard]] uint64_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+};
+
+//! Tracing policy that compiles to no code
+struct NoTracing {
+    static constexpr bool Enabled = false;
+
+    static void record(const TraceRecord &) {}
+};
+
+/**
+ * @brief Tracing policy that pushes records to the installed ring.
+ *
+ * Without installed ring, cost of an event is a single atomic load.
+ */
+struct RingTracing {
+    static constexpr bool Enabled = true;
+
+    //! Sets ring that receives records, nullptr stops tracing
+    static void install(TraceRing *ring) { _ring.store(ring, std::memory_order_release); }
+
+    [[nodiscard]] static TraceRing *installed() {
+        return _ring.load(std::memory_order_acquire);
+    }
+
+    static void record(const TraceRecord &record) {
+        if (auto *ring = installed())
+            ring->tryPush(record);
+    }
+
+  private:
+    static std::atomic<TraceRing *> _ring;
+};
+
+//! Policy used by the library, tracing is compiled in with MODBUS_TRACING option
+#ifdef MODBUS_TRACING
+using DefaultTracing = RingTracing;
+#else
+using DefaultTracing = NoTracing;
+#endif
+
+//! Emits frame event, frame data is only touched when tracing is enabled
+template <typename Policy = DefaultTracing>
+inline void trace(TraceEvent event, TraceSource source, int channel,
+                  const uint8_t *data, std::size_t size) {
+    if constexpr (Policy::Enabled) {
+        TraceRecord record;
+        record.timestamp = TraceRecord::now();
+        record.channel   = channel;
+        record.event     = event;
+        record.source    = source;
+        record.size      = static_cast<uint16_t>(std::min<std::size_t>(size, UINT16_MAX));
+        std::copy(data, data + record.captured(), record.bytes.begin());
+        Policy::record(record);
+    }
+}
+
+template <typename Policy = DefaultTracing>
+inline void trace(TraceEvent event, TraceSource source, int channel,
+                  const std::vector<uint8_t> &frame) {
+    trace<Policy>(event, source, channel, frame.data(), frame.size());
+}
+
+//! Emits TraceEvent::Error event
+template <typename Policy = DefaultTracing>
+inline void traceError(TraceSource source, int channel, utils::MBErrorCode error) {
+    if constexpr (Policy::Enabled) {
+        TraceRecord record;
+        record.timestamp = TraceRecord::now();
+        record.channel   = channel;
+        record.event     = TraceEvent::Error;
+        record.source    = source;
+        record.error     = error;
+        Policy::record(record);
+    }
+}
+} // namespace MB
@@ -0,0 +1,166 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "modbusException.hpp"
+#include "modbusRequest.hpp"
+#include "modbusResponse.hpp"
+
+/**
+ * Namespace that contains whole project
+ */
+namespace MB {
+/**
+ * @file
+ * @brief Requirements on transports, so that code can be written once for all
+ * of them (TCP::Connection, Serial::Connection, Loopback::Connection or user
+ * ones) and instantiated without virtual calls.
+ *
+ * Client transport `t` (master side) has:
+ *  - `t.sendRequest(const ModbusRequest &)` - sends the request,
+ *  - `t.awaitResponse()` - waits for the response to the last request and
+ *    returns `ModbusResponse` or `std::tuple<ModbusResponse, std::vector<uint8_t>>`
+ *    (response with its raw frame). Exception responses, timeouts and other
+ *    errors are thrown as ModbusException,
+ *  - `t.setTimeout(int)` and `t.getTimeout()` - response timeout in
+ *    milliseconds.
+ *
+ * Server transport `t` (slave side) has:
+ *  - `t.awaitRequest()` - waits for the request and returns `ModbusRequest` or
+ *    `std::tuple<ModbusRequest, std::vector<uint8_t>>`, errors are thrown as
+ *    ModbusException,
+ *  - `t.sendResponse(const ModbusResponse &)` and
+ *    `t.sendException(const ModbusException &)` - answer the last request.
+ *
+ * Pipelined client transport `t` (e.g. TCP::Connection) can have many requests
+ * in flight, it is a client transport that also has:
+ *  - `t.getMessageId()` - transaction id of the last sent request,
+ *  - `t.awaitResponse(uint16_t)` - waits for the response with the given
+ *    transaction id, responses to other requests are kept until awaited,
+ *  - `t.forgetResponse(uint16_t)` - response will not be awaited.
+ *
+ * Checks are available as C++17 traits (isClientTransport, isServerTransport,
+ * isPipelinedTransport) and, when compiled as C++20, as concepts
+ * (ClientTransport, ServerTransport, PipelinedTransport).
+ * TransportTraits hides the differences of the return types.
+ */
+
+namespace detail {
+// Message itself or tuple with the message as the first element
+template <typename Message, typename Result> struct IsMessageResult : std::false_type {};
+
+template <typename Message>
+struct IsMessageResult<Message, Message> : std::true_type {};
+
+template <typename Message>
+struct IsMessageResult<Message, std::tuple<Message, std::vector<uint8_t>>>
+    : std::true_type {};
+
+template <typename Message, typename Result> Message messageOf(Result &&result) {
+    if constexpr (std::is_same_v<std::decay_t<Result>, Message>)
+        return std::forward<Result>(result);
+    else
+        return std::get<0>(std::forward<Result>(result));
+}
+
+// Result of awaiting the response by transaction id
+template <typename T>
+using ResponseById = decltype(std::declval<T &>().awaitResponse(uint16_t()));
+} // namespace detail
+
+//! Checks if T meets client transport requirements
+template <typename T, typename = void> struct IsClientTransport : std::false_type {};
+
+template <typename T>
+struct IsClientTransport<
+    T, std::void_t<decltype(std::declval<T &>().sendRequest(
+                       std::declval<const ModbusRequest &>())),
+                   decltype(std::declval<T &>().awaitResponse()),
+                   decltype(std::declval<T &>().setTimeout(0)),
+                   decltype(std::declval<const T &>().getTimeout())>>
+    : detail::IsMessageResult<ModbusResponse,
+                              decltype(std::declval<T &>().awaitResponse())> {};
+
+//! Checks if T meets server transport requirements
+template <typename T, typename = void> struct IsServerTransport : std::false_type {};
+
+template <typename T>
+struct IsServerTransport<
+    T, std::void_t<decltype(std::declval<T &>().awaitRequest()),
+                   decltype(std::declval<T &>().sendResponse(
+                       std::declval<const ModbusResponse &>())),
+                   decltype(std::declval<T &>().sendException(
+                       std::declval<const ModbusException &>()))>>
+    : detail::IsMessageResult<ModbusRequest,
+                              decltype(std::declval<T &>().awaitRequest())> {};
+
+//! Checks if T meets pipelined client transport requirements
+template <typename T, typename = void> struct IsPipelinedTransport : std::false_type {};
+
+template <typename T>
+struct IsPipelinedTransport<
+    T, std::void_t<decltype(std::declval<const T &>().getMessageId()),
+                   decltype(std::declval<T &>().awaitResponse(uint16_t())),
+                   decltype(std::declval<T &>().forgetResponse(uint16_t()))>>
+    : std::bool_constant<
+          IsClientTransport<T>::value &&
+          detail::IsMessageResult<ModbusResponse, detail::ResponseById<T>>::value> {};
+
+template <typename T>
+inline constexpr bool isClientTransport = IsClientTransport<T>::value;
+
+template <typename T>
+inline constexpr bool isServerTransport = IsServerTransport<T>::value;
+
+template <typename T>
+inline constexpr bool isPipelinedTransport = IsPipelinedTransport<T>::value;
+
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+template <typename T>
+concept ClientTransport = isClientTransport<T>;
+
+template <typename T>
+concept ServerTransport = isServerTransport<T>;
+
+template <typename T>
+concept PipelinedTransport = isPipelinedTransport<T>;
+#endif
+
+//! Uniform access to the transport, whatever its methods return
+template <typename T> struct TransportTraits {
+    //! Response to the last request, without raw frame
+    static ModbusResponse awaitResponse(T &transport) {
+        static_assert(isClientTransport<T>, "T is not a client transport");
+        return detail::messageOf<ModbusResponse>(transport.awaitResponse());
+    }
+
+    //! Next request, without raw frame
+    static ModbusRequest awaitRequest(T &transport) {
+        static_assert(isServerTransport<T>, "T is not a server transport");
+        return detail::messageOf<ModbusRequest>(transport.awaitRequest());
+    }
+
+    //! Response with the given transaction id, without raw frame
+    static ModbusResponse awaitResponse(T &transport, uint16_t transactionId) {
+        static_assert(isPipelinedTransport<T>, "T is not a pipelined transport");
+        return detail::messageOf<ModbusResponse>(transport.awaitResponse(transactionId));
+    }
+
+    /**
+     * @brief Sends request and waits for its response.
+     * @throws ModbusException - Exception response, timeout or other error.
+     */
+    static ModbusResponse transact(T &transport, const ModbusRequest &request) {
+        (void)transport.sendRequest(request);
+        return awaitResponse(transport);
+    }
+};
+} // namespace MB
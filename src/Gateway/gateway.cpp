@@ -0,0 +1,333 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Gateway/gateway.hpp"
+#include "mbap.hpp"
+
+#include <sys/socket.h>
+
+using namespace MB::Gateway;
+
+Gateway::Gateway(int port) : _server(port) {
+    _routes.fill(NoPort);
+    _readPriorities.fill(RequestPriority::Normal);
+}
+
+Gateway::~Gateway() { stop(); }
+
+void Gateway::addPort(Serial::Connection &&connection,
+                      const std::vector<uint8_t> &unitIds, unsigned int baudRate) {
+    auto port = std::make_unique<Port>(std::move(connection), baudRate);
+    if (!port->connection.isSocket())
+        port->connection.getFramer().setTiming(RTU::Timing::forBaudRate(baudRate));
+    _ports.push_back(std::move(port));
+
+    for (const auto unitId : unitIds) {
+        _routes[unitId] = static_cast<int>(_ports.size() - 1);
+    }
+}
+
+MB::RequestQueueStats Gateway::queueStats(std::size_t port,
+                                          RequestPriority priority) const {
+    return _ports.at(port)->queue.stats(priority);
+}
+
+void Gateway::run() {
+    for (auto &port : _ports) {
+        port->worker = std::thread(&Gateway::servePort, this, std::ref(*port));
+    }
+
+    while (!_stopped) {
+        auto connection = _server.awaitConnection();
+        if (!connection.has_value()) {
+            // Failed accept (e.g. out of descriptors) would fail again right away
+            if (!_stopped)
+                std::this_thread::sleep_for(AcceptBackoff);
+            continue;
+        }
+
+        reapSessions();
+
+        std::lock_guard<std::mutex> lock(_sessionsMutex);
+        auto session =
+            std::make_shared<Session>(std::move(*connection), _nextSessionId++);
+        session->reader = std::thread(&Gateway::serveSession, this, session);
+        _sessions.push_back(session);
+    }
+
+    for (auto &port : _ports) {
+        port->queue.close();
+    }
+
+    std::vector<std::shared_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(_sessionsMutex);
+        sessions.swap(_sessions);
+    }
+    for (auto &session : sessions) {
+        session->closed = true;
+        ::shutdown(session->connection.getSockfd(), SHUT_RDWR);
+        session->reader.join();
+    }
+
+    for (auto &port : _ports) {
+        port->worker.join();
+    }
+}
+
+void Gateway::stop() {
+    _stopped = true;
+    ::shutdown(_server.nativeHandle(), SHUT_RDWR);
+}
+
+void Gateway::reapSessions() {
+    std::lock_guard<std::mutex> lock(_sessionsMutex);
+
+    for (auto it = _sessions.begin(); it != _sessions.end();) {
+        if ((*it)->closed) {
+            (*it)->reader.join();
+            it = _sessions.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void Gateway::serveSession(const std::shared_ptr<Session> &session) {
+    MB::MBAP::Deframer deframer;
+    std::vector<uint8_t> buffer(1024);
+    const auto fd = session->connection.getSockfd();
+
+    while (!session->closed) {
+        const auto size = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (size <= 0)
+            break;
+
+        deframer.append(buffer.data(), static_cast<std::size_t>(size));
+
+        try {
+            while (auto frame = deframer.next()) {
+                serveFrame(session, *frame);
+            }
+        } catch (const MB::ModbusException &) {
+            // Invalid length field, stream cannot be synchronized anymore
+            break;
+        }
+    }
+
+    session->closed = true;
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+void Gateway::serveFrame(const std::shared_ptr<Session> &session,
+                         const std::vector<uint8_t> &frame) {
+    const auto header = MB::MBAP::parseHeader(frame.data());
+    if (header.protocolId != 0)
+        return;
+
+    // Unit id and PDU, which is exactly the RTU frame without CRC
+    std::vector<uint8_t> request(frame.begin() + 6, frame.end());
+
+    Client client{session, header.transactionId};
+
+    if (header.unitId == 0) {
+        invalidate(request);
+        for (auto &port : _ports) {
+            port->queue.push(session->id, Job{client, request, std::nullopt, nullptr},
+                             RequestPriority::High);
+        }
+        return;
+    }
+
+    const auto port = _routes[header.unitId];
+    if (port == NoPort) {
+        const auto functionCode = static_cast<utils::MBFunctionCode>(request[1]);
+        reply(*session, header.transactionId,
+              ModbusException(utils::GatewayPathUnavailable, header.unitId, functionCode)
+                  .toRaw());
+        return;
+    }
+
+    enqueue(port, std::move(client), std::move(request));
+}
+
+void Gateway::enqueue(int port, Client client, std::vector<uint8_t> &&request) {
+    const auto source = client.session->id;
+    const auto key    = ResponseCache::keyOf(request);
+
+    if (!key.has_value()) {
+        invalidate(request);
+        Job job{std::move(client), std::move(request), std::nullopt, nullptr};
+        // Writes (and anything else that may change the device) go first
+        _ports[port]->queue.push(source, std::move(job), RequestPriority::High);
+        return;
+    }
+
+    std::optional<std::vector<uint8_t>> cached;
+    Readers readers;
+    {
+        // Response is either cached or still in flight, complete() moves it from
+        // one to the other under the same lock
+        std::lock_guard<std::mutex> lock(_inFlightMutex);
+        cached = _cache.lookup(*key);
+        if (!cached.has_value()) {
+            auto &inFlight = _inFlight[*key];
+            // Only the first client asking for the data puts the read on the bus
+            const bool joined = inFlight != nullptr;
+            if (!joined)
+                inFlight = std::make_shared<std::vector<Client>>();
+            inFlight->push_back(client);
+            if (joined)
+                return;
+            readers = inFlight;
+        }
+    }
+
+    if (cached.has_value()) {
+        reply(*client.session, client.transactionId, *cached);
+        return;
+    }
+
+    const auto priority = _readPriorities[key->unitId];
+    Job job{std::move(client), std::move(request), key, std::move(readers)};
+    _ports[port]->queue.push(source, std::move(job), priority);
+}
+
+void Gateway::invalidate(const std::vector<uint8_t> &request) {
+    std::lock_guard<std::mutex> lock(_inFlightMutex);
+    _cache.invalidate(request);
+
+    // Reads queued before the write would return old data, so later reads must
+    // not join them, they still answer their own clients
+    for (auto it = _inFlight.begin(); it != _inFlight.end();) {
+        if (ResponseCache::affects(request, it->first))
+            it = _inFlight.erase(it);
+        else
+            it++;
+    }
+}
+
+void Gateway::servePort(Port &port) {
+    while (auto job = port.queue.pop()) {
+        // Reads may be shared with other clients, which are still waiting
+        if (!job->key.has_value() && job->client.session->closed)
+            continue;
+
+        complete(*job, transact(port, job->request));
+    }
+}
+
+void Gateway::complete(const Job &job, const std::vector<uint8_t> &response) {
+    if (!job.key.has_value()) {
+        // Reads might have been cached while the write was waiting in the queue
+        _cache.invalidate(job.request);
+        if (!response.empty())
+            reply(*job.client.session, job.client.transactionId, response);
+        return;
+    }
+
+    std::vector<Client> clients;
+    {
+        std::lock_guard<std::mutex> lock(_inFlightMutex);
+        clients.swap(*job.readers);
+
+        // Read detached by a write may return old data, it is not cached
+        const auto it = _inFlight.find(*job.key);
+        if (it != _inFlight.end() && it->second == job.readers) {
+            _cache.store(*job.key, response);
+            _inFlight.erase(it);
+        }
+    }
+
+    for (const auto &client : clients) {
+        reply(*client.session, client.transactionId, response);
+    }
+}
+
+std::vector<uint8_t> Gateway::transact(Port &port, const std::vector<uint8_t> &request) {
+    const auto unitId       = request[0];
+    const auto functionCode = static_cast<utils::MBFunctionCode>(request[1]);
+
+    // Requests known to the library are sent as such, so that the connection
+    // knows the size of the response, others are forwarded as they are
+    std::optional<ModbusRequest> known;
+    if (utils::isStandardFunctionCode(functionCode)) {
+        try {
+            known = ModbusRequest::fromRaw(request);
+        } catch (const ModbusException &) {
+            // Malformed, the slave decides how to answer it
+        }
+    }
+
+    // Gap after the previous frame, or turnaround after the broadcast
+    std::this_thread::sleep_until(port.schedule.freeAt());
+    bool sent = false;
+
+    try {
+        // Drop leftovers of previous (e.g. timed out) transactions
+        port.connection.clearInput();
+        const auto frame = known ? port.connection.sendRequest(*known)
+                                 : port.connection.sendRawRequest(request);
+        port.schedule.sent(frame.size(), unitId == 0);
+        sent = true;
+
+        // Broadcasts are never answered
+        if (unitId == 0)
+            return {};
+
+        std::vector<uint8_t> raw;
+        if (known) {
+            raw = std::get<1>(port.connection.awaitResponse());
+        } else {
+            try {
+                raw = port.connection.awaitRawMessage();
+            } catch (const ModbusException &ex) {
+                port.connection.completeRequest(ex.getErrorCode());
+                throw;
+            }
+            port.connection.completeRequest(std::nullopt);
+        }
+
+        if (raw.size() < 4 || raw[0] != unitId)
+            throw ModbusException(utils::InvalidMessageID);
+
+        port.schedule.finished(raw.size(), (raw[1] & 0x80) != 0);
+        raw.resize(raw.size() - 2); // CRC
+        return raw;
+    } catch (const ModbusException &ex) {
+        // Slave answered with an exception, forward it to the client
+        if (utils::isStandardErrorCode(ex.getErrorCode()) && ex.slaveID() == unitId) {
+            port.schedule.finished(RTU::ExceptionResponseSize, true);
+            return ex.toRaw();
+        }
+
+        // Request that did not reach the bus (e.g. open breaker) does not use it
+        if (sent)
+            port.schedule.finished(0, false);
+
+        return ModbusException(utils::GatewayTargetDeviceFailedToRespond, unitId,
+                               functionCode)
+            .toRaw();
+    }
+}
+
+void Gateway::reply(Session &session, uint16_t transactionId,
+                    const std::vector<uint8_t> &response) {
+    const auto frame = MB::MBAP::wrap(transactionId, response);
+    const auto fd    = session.connection.getSockfd();
+
+    std::lock_guard<std::mutex> lock(session.writeMutex);
+
+    std::size_t sent = 0;
+    while (sent < frame.size() && !session.closed) {
+        const auto result =
+            ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            session.closed = true;
+            ::shutdown(fd, SHUT_RDWR);
+            return;
+        }
+        sent += static_cast<std::size_t>(result);
+    }
+}
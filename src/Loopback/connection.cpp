@@ -0,0 +1,169 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Loopback/connection.hpp"
+#include "transport.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace MB::Loopback;
+
+static_assert(MB::isClientTransport<Connection> && MB::isServerTransport<Connection>,
+              "Connection has to be usable with generic clients and servers");
+
+std::pair<Connection, Connection> Connection::pair(const Profile &clientToServer,
+                                                   const Profile &serverToClient,
+                                                   std::size_t capacity) {
+    auto forward  = std::make_shared<Direction>(capacity, clientToServer);
+    auto backward = std::make_shared<Direction>(capacity, serverToClient);
+
+    std::pair<Connection, Connection> ends;
+    ends.first._out  = forward;
+    ends.first._in   = backward;
+    ends.second._out = backward;
+    ends.second._in  = forward;
+    return ends;
+}
+
+void Connection::write(const std::vector<uint8_t> &frame) {
+    auto &direction     = *_out;
+    const auto &profile = direction.profile;
+    auto &random        = direction.random;
+
+    if (profile.loss > 0 && std::uniform_real_distribution<>(0, 1)(random) < profile.loss)
+        return;
+
+    auto delay = profile.latency;
+    if (profile.jitter.count() > 0) {
+        std::uniform_int_distribution<long long> jitter(0, profile.jitter.count());
+        delay += std::chrono::microseconds(jitter(random));
+    }
+
+    // Bytes of the stream are never reordered, even with jitter
+    const auto deliverAt   = std::max(Clock::now() + delay, direction.lastDelivery);
+    direction.lastDelivery = deliverAt;
+
+    std::size_t offset = 0;
+    while (offset < frame.size()) {
+        auto size = frame.size() - offset;
+        if (profile.maxSegment > 0) {
+            std::uniform_int_distribution<std::size_t> split(1, profile.maxSegment);
+            size = std::min(size, split(random));
+        }
+
+        Segment segment{deliverAt, std::vector<uint8_t>(frame.begin() + offset,
+                                                         frame.begin() + offset + size)};
+        // Queue is full only if the other end does not read, wait for it
+        while (!direction.queue.tryPush(std::move(segment))) {
+            std::this_thread::yield();
+        }
+        offset += size;
+    }
+}
+
+std::vector<uint8_t> Connection::read(Clock::time_point deadline) {
+    std::size_t idle = 0;
+
+    while (true) {
+        if (auto frame = _deframer.next())
+            return std::move(*frame);
+
+        const auto now = Clock::now();
+        auto *segment  = _in->queue.front();
+
+        if (segment != nullptr && segment->deliverAt <= now) {
+            _deframer.append(segment->bytes);
+            _in->queue.pop();
+            idle = 0;
+            continue;
+        }
+
+        if (now >= deadline)
+            throw MB::ModbusException(MB::utils::Timeout);
+
+        if (segment != nullptr) {
+            std::this_thread::sleep_until(std::min(segment->deliverAt, deadline));
+        } else if (idle++ < 1000) {
+            // Spin for a while, so that fast exchanges do not pay for a sleep
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &req) {
+    _messageID = _nextID++;
+    auto frame = MBAP::wrap(_messageID, req.toRaw());
+    _outstanding.insert(_messageID);
+    // Id may be reused after wrap around
+    _early.erase(_messageID);
+    write(frame);
+    return frame;
+}
+
+std::vector<uint8_t> Connection::sendResponse(const MB::ModbusResponse &res) {
+    auto frame = MBAP::wrap(_messageID, res.toRaw());
+    write(frame);
+    return frame;
+}
+
+std::vector<uint8_t> Connection::sendException(const MB::ModbusException &ex) {
+    auto frame = MBAP::wrap(_messageID, ex.toRaw());
+    write(frame);
+    return frame;
+}
+
+std::vector<uint8_t> Connection::awaitRawMessage() {
+    return read(Clock::now() + std::chrono::milliseconds(_timeout));
+}
+
+MB::ModbusRequest Connection::awaitRequest() {
+    auto frame = awaitRawMessage();
+    _messageID = MBAP::parseHeader(frame.data()).transactionId;
+
+    frame.erase(frame.begin(), frame.begin() + 6);
+    return MB::ModbusRequest::fromRaw(frame);
+}
+
+MB::ModbusResponse Connection::awaitResponse(uint16_t transactionId) {
+    const auto deadline = Clock::now() + std::chrono::milliseconds(_timeout);
+
+    std::vector<uint8_t> frame;
+    while (true) {
+        const auto early = _early.find(transactionId);
+        if (early != _early.end()) {
+            frame = std::move(early->second);
+            _early.erase(early);
+            break;
+        }
+
+        try {
+            frame = read(deadline);
+        } catch (const MB::ModbusException &) {
+            _outstanding.erase(transactionId);
+            throw;
+        }
+
+        const auto id = MBAP::parseHeader(frame.data()).transactionId;
+        if (id == transactionId)
+            break;
+        // Response to other request in flight, late responses are dropped
+        if (_outstanding.count(id) > 0)
+            _early[id] = std::move(frame);
+    }
+    _outstanding.erase(transactionId);
+
+    frame.erase(frame.begin(), frame.begin() + 6);
+    if (MB::ModbusException::exist(frame))
+        throw MB::ModbusException(frame);
+
+    return MB::ModbusResponse::fromRaw(frame);
+}
+
+void Connection::forgetResponse(uint16_t transactionId) {
+    _outstanding.erase(transactionId);
+    _early.erase(transactionId);
+}
@@ -0,0 +1,109 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Serial/busMaster.hpp"
+#include "rtuFramer.hpp"
+
+#include <thread>
+
+using namespace MB::Serial;
+
+BusMaster::BusMaster(Connection &&connection, unsigned int baudRate)
+    : _connection(std::move(connection)), _schedule(baudRate) {
+    // Bus behind serial to Ethernet converter is timed by the schedule only
+    if (!_connection.isSocket())
+        _connection.getFramer().setTiming(RTU::Timing::forBaudRate(baudRate));
+}
+
+void BusMaster::waitForBus() {
+    std::this_thread::sleep_until(_schedule.freeAt());
+    // Drop leftovers of previous (e.g. timed out) transactions
+    _connection.clearInput();
+}
+
+MB::ModbusResponse BusMaster::transact(const ModbusRequest &request) {
+    if (request.slaveID() == 0)
+        throw std::invalid_argument("Broadcast has no response, use broadcast()");
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    waitForBus();
+
+    const auto frame = _connection.sendRequest(request);
+    _schedule.sent(frame.size(), false);
+
+    ModbusResponse response(0, utils::ReadAnalogInputRegisters);
+    std::size_t size = 0;
+    try {
+        auto [received, raw] = _connection.awaitResponse();
+        response             = std::move(received);
+        size                 = raw.size();
+    } catch (const ModbusException &ex) {
+        if (utils::isStandardErrorCode(ex.getErrorCode()))
+            _schedule.finished(RTU::ExceptionResponseSize, true);
+        else
+            _schedule.finished(0, false);
+        throw;
+    }
+
+    // Late response of other slave
+    if (response.slaveID() != request.slaveID()) {
+        _schedule.finished(0, false);
+        throw ModbusException(utils::InvalidMessageID, response.slaveID());
+    }
+
+    _schedule.finished(size, false);
+    return response;
+}
+
+void BusMaster::broadcast(const ModbusRequest &request) {
+    if (request.slaveID() != 0 || request.functionType() == utils::Read)
+        throw std::invalid_argument("Only writes can be broadcast to unit 0");
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    waitForBus();
+
+    const auto frame = _connection.sendRequest(request);
+    _schedule.sent(frame.size(), true);
+}
+
+std::vector<BusMaster::Result>
+BusMaster::transactAll(const std::vector<ModbusRequest> &requests) {
+    std::vector<Result> results;
+    results.reserve(requests.size());
+
+    for (const auto &request : requests) {
+        try {
+            if (request.slaveID() == 0) {
+                broadcast(request);
+                results.emplace_back(std::monostate());
+            } else {
+                results.emplace_back(transact(request));
+            }
+        } catch (const ModbusException &ex) {
+            results.emplace_back(ex);
+        }
+    }
+
+    return results;
+}
+
+void BusMaster::setInterFrameGap(std::chrono::microseconds gap) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _schedule.setInterFrameGap(gap);
+}
+
+void BusMaster::setTurnaround(std::chrono::microseconds turnaround) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _schedule.setTurnaround(turnaround);
+}
+
+MB::RTU::BusStats BusMaster::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _schedule.stats();
+}
+
+void BusMaster::resetStats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _schedule.resetStats();
+}
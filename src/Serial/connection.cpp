@@ -3,11 +3,26 @@
 // Licensed under: MIT License <http://opensource.org/licenses/MIT>
 
 #include "Serial/connection.hpp"
+#include "transport.hpp"
 #include "modbusUtils.hpp"
+#include "termios2.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/poll.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
 
 using namespace MB::Serial;
 
+static_assert(MB::isClientTransport<Connection> && MB::isServerTransport<Connection>,
+              "Connection has to be usable with generic clients and servers");
+
 Connection::Connection(const std::string &path) {
     _fd = open(path.c_str(), O_RDWR | O_SYNC);
 
@@ -23,14 +38,113 @@ Connection::Connection(const std::string &path) {
 
     _termios.c_iflag &= ~(PARMRK | INPCK);
     _termios.c_iflag |= IGNPAR;
+
+    _framer.setMinimumGap(DefaultMinimumFrameGap);
+}
+
+Connection Connection::withTcp(const std::string &address, int port) {
+    auto sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1)
+        throw std::runtime_error("Cannot open socket, errno = " + std::to_string(errno));
+
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port   = htons(static_cast<uint16_t>(port));
+    server.sin_addr   = {inet_addr(address.c_str())};
+
+    if (::connect(sock, reinterpret_cast<sockaddr *>(&server), sizeof(server)) < 0) {
+        ::close(sock);
+        throw std::runtime_error("Cannot connect, errno = " + std::to_string(errno));
+    }
+
+    return fromSocket(sock);
+}
+
+Connection Connection::fromSocket(int sockfd) {
+    Connection connection;
+    connection._fd     = sockfd;
+    connection._socket = true;
+
+    // Frames are small, do not wait to coalesce them
+    const int noDelay = 1;
+    ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    // Segments of one frame may come with network delays between them
+    connection._framer.setTiming(RTU::Timing{DefaultTcpFrameGap, DefaultTcpFrameGap});
+
+    return Connection(std::move(connection));
 }
 
 void Connection::connect() {
+    // Sockets have no line settings
+    if (_socket)
+        return;
+
     tcflush(_fd, TCIFLUSH);
     if (tcsetattr(_fd, TCSAFLUSH, &_termios) != 0) {
         throw std::runtime_error("Error {" + std::to_string(_fd) + "} at tcsetattr - " +
                                  std::to_string(errno));
     }
+
+    if (_customBaudRate != 0)
+        detail::setCustomBaudRate(_fd, _customBaudRate);
+}
+
+void Connection::setCustomBaudRate(unsigned int baudRate) {
+#ifdef __linux__
+    // Placeholder for tcsetattr, actual rate is set by connect()
+    cfsetospeed(&_termios, B38400);
+    cfsetispeed(&_termios, B38400);
+    _customBaudRate = baudRate;
+    if (!_socket)
+        _framer.setTiming(RTU::Timing::forBaudRate(baudRate));
+#else
+    (void)baudRate;
+    throw std::runtime_error("Invalid baud rate");
+#endif
+}
+
+void Connection::setRS485(const std::optional<RS485Options> &options) {
+#ifdef __linux__
+    serial_rs485 config{};
+    if (options.has_value()) {
+        config.flags = SER_RS485_ENABLED;
+        if (options->rtsOnSend)
+            config.flags |= SER_RS485_RTS_ON_SEND;
+        if (options->rtsAfterSend)
+            config.flags |= SER_RS485_RTS_AFTER_SEND;
+        if (options->receiveDuringSend)
+            config.flags |= SER_RS485_RX_DURING_TX;
+        config.delay_rts_before_send =
+            static_cast<uint32_t>(options->delayBeforeSend.count());
+        config.delay_rts_after_send =
+            static_cast<uint32_t>(options->delayAfterSend.count());
+    }
+
+    if (ioctl(_fd, TIOCSRS485, &config) != 0)
+        throw std::runtime_error("Error at TIOCSRS485 - " + std::to_string(errno));
+#else
+    (void)options;
+    throw std::runtime_error("RS-485 mode is not supported on this platform");
+#endif
+}
+
+void Connection::setLowLatency(bool lowLatency) {
+#ifdef __linux__
+    serial_struct serial{};
+    if (ioctl(_fd, TIOCGSERIAL, &serial) != 0)
+        throw std::runtime_error("Error at TIOCGSERIAL - " + std::to_string(errno));
+
+    if (lowLatency)
+        serial.flags |= ASYNC_LOW_LATENCY;
+    else
+        serial.flags &= ~ASYNC_LOW_LATENCY;
+
+    if (ioctl(_fd, TIOCSSERIAL, &serial) != 0)
+        throw std::runtime_error("Error at TIOCSSERIAL - " + std::to_string(errno));
+#else
+    (void)lowLatency;
+    throw std::runtime_error("Low latency mode is not supported on this platform");
+#endif
 }
 
 Connection::~Connection() {
@@ -39,96 +153,231 @@ Connection::~Connection() {
     _fd = -1;
 }
 
+void Connection::clearInput() {
+    if (_socket) {
+        // Sockets cannot be flushed, drop what has already arrived
+        uint8_t buffer[RTU::MaxFrameSize];
+        while (::recv(_fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    } else {
+        tcflush(_fd, TCIFLUSH);
+    }
+    _framer.reset();
+}
+
 std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &request) {
-    return send(request.toRaw());
+    auto frame = sendRawRequest(request.toRaw());
+    // Nobody responds to the broadcast
+    if (request.slaveID() != 0)
+        _expectedSize = RTU::expectedResponseSize(request);
+    return frame;
+}
+
+std::vector<uint8_t> Connection::sendRawRequest(std::vector<uint8_t> data) {
+    if (data.size() < 2)
+        throw std::invalid_argument("Request has to contain unit id and function code");
+
+    const auto unitId = data[0];
+    if (_breaker)
+        _breaker->check(unitId, static_cast<utils::MBFunctionCode>(data[1]));
+
+    _requestUnit = unitId;
+    _requestSent = std::chrono::steady_clock::now();
+    auto frame   = sendFrame(std::move(data));
+    if (_metrics)
+        _metrics->requestSent(unitId, frame.size());
+    return frame;
 }
 
 std::vector<uint8_t> Connection::sendResponse(const MB::ModbusResponse &response) {
-    return send(response.toRaw());
+    return sendRawResponse(response.toRaw());
 }
 
 std::vector<uint8_t> Connection::sendException(const MB::ModbusException &exception) {
-    return send(exception.toRaw());
+    return sendRawResponse(exception.toRaw());
+}
+
+std::vector<uint8_t> Connection::sendRawResponse(std::vector<uint8_t> data) {
+    if (data.empty())
+        throw std::invalid_argument("Response has to contain unit id");
+
+    const auto unitId = data[0];
+    auto frame        = sendFrame(std::move(data));
+    if (_metrics)
+        _metrics->responseSent(unitId, frame.size());
+    return frame;
 }
 
 std::vector<uint8_t> Connection::awaitRawMessage() {
-    std::vector<uint8_t> data(1024);
+    auto frame = awaitFrame();
+    capture(frame);
+    return frame;
+}
 
+std::optional<std::vector<uint8_t>> Connection::nextFrame() {
+    auto frame = _framer.next();
+    if (frame)
+        capture(*frame);
+    return frame;
+}
+
+bool Connection::receive(int timeout) {
     pollfd waitingFD;
     waitingFD.fd      = this->_fd;
     waitingFD.events  = POLLIN;
-    waitingFD.revents = POLLIN;
+    waitingFD.revents = 0;
 
-    if (::poll(&waitingFD, 1, _timeout) <= 0) {
-        throw MB::ModbusException(MB::utils::Timeout);
-    }
+    if (timeout < 0 || ::poll(&waitingFD, 1, timeout) <= 0)
+        return false;
 
-    auto size = ::read(_fd, data.begin().base(), 1024);
+    // Bytes are timestamped as soon as they are available
+    const auto now = std::chrono::steady_clock::now();
+    // Never read past the expected response
+    uint8_t buffer[RTU::MaxFrameSize];
+    const auto missing = _framer.remaining();
+    const auto size    = ::read(_fd, buffer, missing > 0 ? missing : sizeof(buffer));
 
-    if (size < 0) {
+    if (size <= 0) {
         throw MB::ModbusException(MB::utils::SlaveDeviceFailure);
     }
 
-    data.resize(size);
-    data.shrink_to_fit();
+    trace(TraceEvent::FrameReceived, TraceSource::Serial, _fd, buffer,
+          static_cast<std::size_t>(size));
+    if (_metrics)
+        _metrics->bytesReceived(static_cast<std::size_t>(size));
 
-    return data;
+    _framer.append(buffer, static_cast<std::size_t>(size), now);
+    return true;
+}
+
+std::vector<uint8_t>
+Connection::awaitFrame(std::optional<std::chrono::steady_clock::time_point> deadline) {
+    using Clock = std::chrono::steady_clock;
+    auto idle   = Clock::now() + std::chrono::milliseconds(_timeout);
+
+    while (true) {
+        if (auto frame = _framer.next())
+            return std::move(*frame);
+
+        const auto now   = Clock::now();
+        const auto until = deadline.value_or(idle);
+        if (now >= until)
+            throw MB::ModbusException(MB::utils::Timeout);
+
+        // Wake up when the silence ends the frame
+        auto wake = until;
+        if (const auto completes = _framer.completesAt())
+            wake = std::min(wake, *completes);
+
+        const auto left =
+            std::chrono::duration_cast<std::chrono::microseconds>(wake - now).count();
+        if (receive(static_cast<int>((left + 999) / 1000))) // Round up
+            idle = Clock::now() + std::chrono::milliseconds(_timeout);
+    }
 }
 
-// TODO: Figure out how to return raw data when exception is being thrown
 std::tuple<MB::ModbusResponse, std::vector<uint8_t>> Connection::awaitResponse() {
-    std::vector<uint8_t> data;
-    data.reserve(8);
+    using Clock = std::chrono::steady_clock;
+    std::optional<Clock::time_point> deadline;
+    if (_rtt)
+        deadline = _requestSent + _rtt->timeout(_requestUnit);
 
-    MB::ModbusResponse response(0, MB::utils::ReadAnalogInputRegisters);
+    const auto discarded = _framer.discardedBytes();
+    std::vector<uint8_t> data;
+    _framer.expect(_expectedSize);
+    try {
+        data = awaitFrame(deadline);
+        _framer.expect(0);
+    } catch (const MB::ModbusException &ex) {
+        _framer.expect(0);
+        // Something has arrived, but it was never a valid frame (or it is
+        // still an incomplete response)
+        const bool corrupted =
+            ex.getErrorCode() == MB::utils::Timeout &&
+            (_framer.discardedBytes() != discarded || _framer.bufferedBytes() > 0);
+        reportOutcome(corrupted ? MB::utils::InvalidCRC : ex.getErrorCode());
+        throw;
+    }
+    capture(data);
+
+    try {
+        if (MB::ModbusException::exist(data))
+            throw MB::ModbusException(data, true);
+
+        auto response = MB::ModbusResponse::fromRawCRC(data);
+        reportOutcome(std::nullopt);
+        return std::make_tuple(std::move(response), std::move(data));
+    } catch (const MB::ModbusException &ex) {
+        reportOutcome(ex.getErrorCode());
+        throw;
+    }
+}
 
-    while (true) {
-        try {
-            auto tmpResponse = awaitRawMessage();
-            data.insert(data.end(), tmpResponse.begin(), tmpResponse.end());
+void Connection::reportOutcome(std::optional<utils::MBErrorCode> error) {
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - _requestSent);
+    // Exception response is still a response
+    const bool responded = !error.has_value() || utils::isStandardErrorCode(*error);
+
+    if (_rtt) {
+        if (responded)
+            _rtt->sample(_requestUnit, latency);
+        else if (*error == utils::Timeout)
+            _rtt->timedOut(_requestUnit);
+    }
 
-            if (MB::ModbusException::exist(data))
-                throw MB::ModbusException(data);
+    if (_breaker)
+        _breaker->report(_requestUnit, error);
 
-            response = MB::ModbusResponse::fromRawCRC(data);
-            break;
-        } catch (const MB::ModbusException &ex) {
-            if (MB::utils::isStandardErrorCode(ex.getErrorCode()) ||
-                ex.getErrorCode() == MB::utils::Timeout ||
-                ex.getErrorCode() == MB::utils::SlaveDeviceFailure)
-                throw ex;
-            continue;
-        }
+    if (_metrics) {
+        if (responded)
+            _metrics->responseReceived(_requestUnit, latency);
+        if (error.has_value())
+            _metrics->error(_requestUnit, *error);
     }
 
-    return std::tie(response, data);
+    if (error.has_value())
+        traceError(TraceSource::Serial, _fd, *error);
 }
 
-std::tuple<MB::ModbusRequest, std::vector<uint8_t>> Connection::awaitRequest() {
-    std::vector<uint8_t> data;
-    data.reserve(8);
+void Connection::setCapture(std::shared_ptr<PcapWriter> capture) {
+    if (capture && capture->linkType() != PcapLinkType::User0)
+        throw std::invalid_argument("Serial capture requires user link type");
+
+    _capture = std::move(capture);
+}
 
-    MB::ModbusRequest request(0, MB::utils::ReadAnalogInputRegisters);
+void Connection::capture(const std::vector<uint8_t> &frame) {
+    if (_capture && !frame.empty())
+        _capture->writeRtu(frame);
+}
 
+std::tuple<MB::ModbusRequest, std::vector<uint8_t>> Connection::awaitRequest() {
     while (true) {
+        auto data = awaitRawMessage();
         try {
-            auto tmpResponse = awaitRawMessage();
-            data.insert(data.end(), tmpResponse.begin(), tmpResponse.end());
-
-            request = MB::ModbusRequest::fromRawCRC(data);
-            break;
+            auto request = MB::ModbusRequest::fromRawCRC(data);
+            if (_metrics)
+                _metrics->requestReceived(request.slaveID());
+            return std::make_tuple(std::move(request), std::move(data));
         } catch (const MB::ModbusException &ex) {
-            if (ex.getErrorCode() == MB::utils::Timeout ||
-                ex.getErrorCode() == MB::utils::SlaveDeviceFailure)
-                throw ex;
+            // Frame is valid, but it is not a supported request
+            if (ex.getErrorCode() == MB::utils::SlaveDeviceFailure)
+                throw;
             continue;
         }
     }
-
-    return std::tie(request, data);
 }
 
 std::vector<uint8_t> Connection::send(std::vector<uint8_t> data) {
+    auto frame = sendFrame(std::move(data));
+    if (_metrics)
+        _metrics->frameSent(frame.size());
+    return frame;
+}
+
+std::vector<uint8_t> Connection::sendFrame(std::vector<uint8_t> data) {
+    _expectedSize = 0;
     data.reserve(data.size() + 2);
     const auto crc = utils::calculateCRC(data.begin().base(), data.size());
 
@@ -138,9 +387,17 @@ std::vector<uint8_t> Connection::send(std::vector<uint8_t> data) {
     // Ensure that nothing will intervene in our communication
     // WARNING: It may conflict with something (although it may also help in
     // most cases)
-    tcflush(_fd, TCOFLUSH);
+    if (!_socket)
+        tcflush(_fd, TCOFLUSH);
     // Write
-    utils::ignore_result(write(_fd, data.begin().base(), data.size()));
+    if (_socket) {
+        // Converter closing the connection must not raise SIGPIPE
+        utils::ignore_result(::send(_fd, data.data(), data.size(), MSG_NOSIGNAL));
+    } else {
+        utils::ignore_result(write(_fd, data.begin().base(), data.size()));
+    }
+    trace(TraceEvent::FrameSent, TraceSource::Serial, _fd, data);
+    capture(data);
     // It may be a good idea to use tcdrain, although it has tendency to not
     // work as expected tcdrain(_fd);
 
@@ -148,17 +405,39 @@ std::vector<uint8_t> Connection::send(std::vector<uint8_t> data) {
 }
 
 Connection::Connection(Connection &&moved) noexcept {
-    _fd       = moved._fd;
-    _termios  = moved._termios;
-    moved._fd = -1;
+    _fd             = moved._fd;
+    _socket         = moved._socket;
+    _termios        = moved._termios;
+    _timeout        = moved._timeout;
+    _customBaudRate = moved._customBaudRate;
+    _framer         = std::move(moved._framer);
+    _rtt            = std::move(moved._rtt);
+    _breaker        = std::move(moved._breaker);
+    _metrics        = std::move(moved._metrics);
+    _capture        = std::move(moved._capture);
+    _requestUnit    = moved._requestUnit;
+    _expectedSize   = moved._expectedSize;
+    _requestSent    = moved._requestSent;
+    moved._fd       = -1;
 }
 
 Connection &Connection::operator=(Connection &&moved) {
     if (this == &moved)
         return *this;
 
-    _fd = moved._fd;
+    _fd     = moved._fd;
+    _socket = moved._socket;
     memcpy(&_termios, &(moved._termios), sizeof(moved._termios));
-    moved._fd = -1;
+    _timeout        = moved._timeout;
+    _customBaudRate = moved._customBaudRate;
+    _framer         = std::move(moved._framer);
+    _rtt            = std::move(moved._rtt);
+    _breaker        = std::move(moved._breaker);
+    _metrics        = std::move(moved._metrics);
+    _capture        = std::move(moved._capture);
+    _requestUnit    = moved._requestUnit;
+    _expectedSize   = moved._expectedSize;
+    _requestSent    = moved._requestSent;
+    moved._fd       = -1;
     return *this;
 }
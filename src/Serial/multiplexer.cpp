@@ -0,0 +1,355 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Serial/multiplexer.hpp"
+#include "modbusUtils.hpp"
+#include "rtuFramer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+using namespace MB::Serial;
+
+namespace {
+// Event data of the wake up pipe, other events carry port ids
+constexpr uint64_t WakeEvent = std::numeric_limits<uint64_t>::max();
+} // namespace
+
+Multiplexer::Multiplexer(Clock::duration tick) : _timers(tick) {
+    if (::pipe(_wake) != 0)
+        throw std::runtime_error("Cannot create pipe - " + std::to_string(errno));
+    // Any number of submits must not block
+    for (const auto fd : _wake) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+#ifdef __linux__
+    _poll = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events   = EPOLLIN;
+    event.data.u64 = WakeEvent;
+    if (_poll < 0 || ::epoll_ctl(_poll, EPOLL_CTL_ADD, _wake[0], &event) != 0) {
+        const auto error = errno;
+        closeAll();
+        throw std::runtime_error("Cannot create epoll instance - " +
+                                 std::to_string(error));
+    }
+#endif
+}
+
+Multiplexer::~Multiplexer() { closeAll(); }
+
+void Multiplexer::closeAll() {
+    for (auto *fd : {&_poll, &_wake[0], &_wake[1]}) {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+}
+
+Multiplexer::PortId Multiplexer::addPort(Connection &&connection,
+                                         unsigned int baudRate) {
+    auto port = std::make_unique<Port>(std::move(connection), baudRate);
+    if (!port->connection.isSocket())
+        port->connection.getFramer().setTiming(RTU::Timing::forBaudRate(baudRate));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto id = _ports.size();
+#ifdef __linux__
+    epoll_event event{};
+    event.events   = EPOLLIN;
+    event.data.u64 = id;
+    if (::epoll_ctl(_poll, EPOLL_CTL_ADD, port->connection.getFd(), &event) != 0)
+        throw std::runtime_error("Cannot watch serial port - " + std::to_string(errno));
+#endif
+    _ports.push_back(std::move(port));
+    return id;
+}
+
+Multiplexer::Port &Multiplexer::at(PortId id) const {
+    if (id >= _ports.size())
+        throw std::invalid_argument("No such port: " + std::to_string(id));
+    return *_ports[id];
+}
+
+void Multiplexer::submit(PortId port, const ModbusRequest &request, Callback callback) {
+    if (request.slaveID() == 0 && request.functionType() == utils::Read)
+        throw std::invalid_argument("Only writes can be broadcast to unit 0");
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        at(port).queue.push_back(Pending{request, std::move(callback)});
+    }
+    // Requests are sent by the running thread
+    wake();
+}
+
+void Multiplexer::wake() {
+    const uint8_t wake = 1;
+    utils::ignore_result(::write(_wake[1], &wake, 1));
+}
+
+void Multiplexer::stop() {
+    _stopped = true;
+    wake();
+}
+
+void Multiplexer::wait(int timeout, std::vector<PortId> &readable) {
+    readable.clear();
+    bool woken = false;
+
+#ifdef __linux__
+    epoll_event events[64];
+    const auto count = ::epoll_wait(_poll, events, 64, timeout);
+    if (count < 0 && errno != EINTR)
+        throw std::runtime_error("Error at epoll_wait - " + std::to_string(errno));
+
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.u64 == WakeEvent)
+            woken = true;
+        else
+            readable.push_back(static_cast<PortId>(events[i].data.u64));
+    }
+#else
+    std::vector<pollfd> fds = {{_wake[0], POLLIN, 0}};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &port : _ports) {
+            // Negative descriptors are ignored by poll
+            fds.push_back({port->failed ? -1 : port->connection.getFd(), POLLIN, 0});
+        }
+    }
+
+    if (::poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+        throw std::runtime_error("Error at poll - " + std::to_string(errno));
+
+    woken = fds[0].revents != 0;
+    for (std::size_t i = 1; i < fds.size(); i++) {
+        if (fds[i].revents != 0)
+            readable.push_back(i - 1);
+    }
+#endif
+
+    if (woken) {
+        uint8_t buffer[64];
+        while (::read(_wake[0], buffer, sizeof(buffer)) > 0) {
+        }
+    }
+}
+
+void Multiplexer::run() {
+    std::vector<PortId> readable;
+    std::vector<std::pair<Callback, Result>> completed;
+
+    while (!_stopped) {
+        int timeout = -1;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (const auto expiry = _timers.nextExpiry()) {
+                const auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+                    *expiry - Clock::now());
+                // Rounded up, waking up early would only spin
+                const auto millis = std::max<long long>((left.count() + 999) / 1000, 0);
+                timeout           = static_cast<int>(millis);
+            }
+        }
+
+        wait(timeout, readable);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto now = Clock::now();
+            for (const auto id : readable) {
+                onReadable(id, now);
+            }
+            _timers.advance(now);
+            // Newly submitted requests
+            for (PortId id = 0; id < _ports.size(); id++) {
+                pump(id, now);
+            }
+            completed.swap(_completed);
+        }
+
+        for (auto &[callback, result] : completed) {
+            if (callback)
+                callback(result);
+        }
+        completed.clear();
+    }
+}
+
+void Multiplexer::arm(PortId id, Clock::time_point time) {
+    auto &port = at(id);
+    if (port.timer)
+        _timers.cancel(*port.timer);
+
+    port.timer = _timers.schedule(time, [this, id]() {
+        auto &port = at(id);
+        port.timer.reset();
+        if (port.current)
+            checkResponse(id, Clock::now());
+        else
+            pump(id, Clock::now());
+    });
+}
+
+void Multiplexer::pump(PortId id, Clock::time_point now) {
+    auto &port = at(id);
+
+    while (!port.current && !port.queue.empty()) {
+        if (port.failed) {
+            _completed.emplace_back(std::move(port.queue.front().callback),
+                                    ModbusException(utils::SlaveDeviceFailure));
+            port.queue.pop_front();
+            continue;
+        }
+
+        // Waiting for the bus, unless the timer is already armed for it
+        if (port.schedule.freeAt() > now) {
+            if (!port.timer)
+                arm(id, port.schedule.freeAt());
+            return;
+        }
+
+        auto pending = std::move(port.queue.front());
+        port.queue.pop_front();
+        const bool broadcast = pending.request.slaveID() == 0;
+
+        std::vector<uint8_t> frame;
+        try {
+            // Drop leftovers of previous (e.g. timed out) transactions
+            port.connection.clearInput();
+            frame = port.connection.sendRequest(pending.request);
+        } catch (const ModbusException &ex) {
+            _completed.emplace_back(std::move(pending.callback), ex);
+            continue;
+        }
+
+        port.schedule.sent(frame.size(), broadcast, now);
+        if (broadcast) {
+            _completed.emplace_back(std::move(pending.callback), std::monostate());
+            continue;
+        }
+
+        port.connection.getFramer().expect(RTU::expectedResponseSize(pending.request));
+        port.deadline = now + port.schedule.wireTime(frame.size()) +
+                        std::chrono::milliseconds(port.connection.getTimeout());
+        port.current  = std::move(pending);
+        arm(id, port.deadline);
+    }
+}
+
+void Multiplexer::onReadable(PortId id, Clock::time_point now) {
+    auto &port = at(id);
+    try {
+        port.connection.receive(0);
+    } catch (const ModbusException &) {
+        fail(id);
+        return;
+    }
+
+    if (port.current) {
+        checkResponse(id, now);
+    } else {
+        // Nobody is waiting, e.g. response after the timeout
+        while (port.connection.nextFrame()) {
+        }
+    }
+}
+
+void Multiplexer::checkResponse(PortId id, Clock::time_point now) {
+    auto &port = at(id);
+    auto frame = port.connection.nextFrame();
+
+    if (!frame) {
+        if (now >= port.deadline) {
+            finish(id, ModbusException(utils::Timeout), 0, now);
+            return;
+        }
+
+        // Wake up when the silence ends the frame
+        auto wake = port.deadline;
+        if (const auto completes = port.connection.getFramer().completesAt())
+            wake = std::min(wake, *completes);
+        arm(id, wake);
+        return;
+    }
+
+    try {
+        if (ModbusException::exist(*frame))
+            throw ModbusException(*frame, true);
+
+        auto response = ModbusResponse::fromRawCRC(*frame);
+        // Late response of other slave
+        if (response.slaveID() != port.current->request.slaveID())
+            throw ModbusException(utils::InvalidMessageID, response.slaveID());
+
+        finish(id, std::move(response), frame->size(), now);
+    } catch (const ModbusException &ex) {
+        finish(id, ex, 0, now);
+    }
+}
+
+void Multiplexer::finish(PortId id, Result result, std::size_t responseSize,
+                         Clock::time_point now) {
+    auto &port = at(id);
+    if (port.timer) {
+        _timers.cancel(*port.timer);
+        port.timer.reset();
+    }
+    port.connection.getFramer().expect(0);
+
+    const auto *exception = std::get_if<ModbusException>(&result);
+    if (exception)
+        port.connection.completeRequest(exception->getErrorCode());
+    else
+        port.connection.completeRequest(std::nullopt);
+
+    if (exception && utils::isStandardErrorCode(exception->getErrorCode()))
+        port.schedule.finished(RTU::ExceptionResponseSize, true, now);
+    else
+        port.schedule.finished(exception ? 0 : responseSize, false, now);
+
+    _completed.emplace_back(std::move(port.current->callback), std::move(result));
+    port.current.reset();
+    pump(id, now);
+}
+
+void Multiplexer::fail(PortId id) {
+    auto &port = at(id);
+    port.failed = true;
+#ifdef __linux__
+    // Hang up would be reported over and over again
+    ::epoll_ctl(_poll, EPOLL_CTL_DEL, port.connection.getFd(), nullptr);
+#endif
+
+    if (port.current)
+        finish(id, ModbusException(utils::SlaveDeviceFailure), 0, Clock::now());
+}
+
+std::size_t Multiplexer::pending(PortId port) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto &state = at(port);
+    return state.queue.size() + (state.current ? 1 : 0);
+}
+
+MB::RTU::BusStats Multiplexer::stats(PortId port) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return at(port).schedule.stats();
+}
+
+void Multiplexer::setTurnaround(PortId port, std::chrono::microseconds turnaround) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    at(port).schedule.setTurnaround(turnaround);
+}
@@ -0,0 +1,122 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Serial/server.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace MB::Serial;
+
+Server::Server(Connection &&connection) : _connection(std::move(connection)) {
+    if (::pipe(_wake) != 0)
+        throw std::runtime_error("Cannot create pipe - " + std::to_string(errno));
+}
+
+Server::~Server() {
+    for (const auto fd : _wake) {
+        if (fd >= 0)
+            ::close(fd);
+    }
+}
+
+void Server::addUnit(uint8_t unitId,
+                     std::shared_ptr<const RequestDispatcher> dispatcher) {
+    if (unitId == 0 || unitId > 247)
+        throw std::invalid_argument("Unit id has to be in 1 - 247 range");
+
+    _units[unitId] = std::move(dispatcher);
+}
+
+void Server::run() {
+    auto &framer = _connection.getFramer();
+
+    while (!_stopped) {
+        // Wake up when the silence ends the frame, if bytes are waiting
+        int timeout = -1;
+        if (const auto completes = framer.completesAt()) {
+            const auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+                *completes - std::chrono::steady_clock::now());
+            const auto millis = std::max<long long>((left.count() + 999) / 1000, 0);
+            timeout           = static_cast<int>(millis);
+        }
+
+        pollfd fds[2] = {{_connection.getFd(), POLLIN, 0}, {_wake[0], POLLIN, 0}};
+        if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+            throw MB::ModbusException(MB::utils::SlaveDeviceFailure);
+
+        if (fds[1].revents != 0)
+            break;
+
+        if (fds[0].revents != 0)
+            _connection.receive(0);
+
+        while (auto frame = _connection.nextFrame()) {
+            serveFrame(*frame);
+        }
+    }
+}
+
+void Server::serveFrame(const std::vector<uint8_t> &frame) {
+    const auto unitId = frame[0];
+    const auto code   = frame[1];
+    // Handlers get the request without CRC
+    const std::vector<uint8_t> request(frame.begin(), frame.end() - 2);
+
+    if (unitId == 0) {
+        const bool read =
+            utils::isStandardFunctionCode(code) &&
+            utils::functionType(static_cast<utils::MBFunctionCode>(code)) == utils::Read;
+        if (read) {
+            _ignored++;
+            return;
+        }
+
+        // Units may share the dispatcher, execute the broadcast only once for it
+        std::vector<const RequestDispatcher *> executed;
+        for (const auto &dispatcher : _units) {
+            if (!dispatcher || std::find(executed.begin(), executed.end(),
+                                         dispatcher.get()) != executed.end())
+                continue;
+
+            (void)dispatcher->dispatchRaw(request);
+            executed.push_back(dispatcher.get());
+        }
+        if (const auto &metrics = _connection.getMetrics())
+            metrics->requestReceived(0);
+        _broadcasts++;
+        return;
+    }
+
+    const auto &dispatcher = _units[unitId];
+    if (!dispatcher) {
+        _ignored++;
+        return;
+    }
+
+    if (const auto &metrics = _connection.getMetrics())
+        metrics->requestReceived(unitId);
+
+    auto response = dispatcher->dispatchRaw(request);
+    if (response.size() >= 2 && (response[1] & 0x80) != 0)
+        _exceptions++;
+    _requests++;
+
+    _connection.sendRawResponse(std::move(response));
+}
+
+void Server::stop() {
+    _stopped           = true;
+    const uint8_t wake = 1;
+    utils::ignore_result(::write(_wake[1], &wake, 1));
+}
+
+Server::Stats Server::stats() const {
+    Stats stats;
+    stats.requests   = _requests;
+    stats.exceptions = _exceptions;
+    stats.broadcasts = _broadcasts;
+    stats.ignored    = _ignored;
+    return stats;
+}
@@ -0,0 +1,35 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "termios2.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#endif
+
+void MB::Serial::detail::setCustomBaudRate(int fd, unsigned int baudRate) {
+#ifdef __linux__
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) != 0)
+        throw std::runtime_error("Error at TCGETS2 - " + std::to_string(errno));
+
+    // Both output and input speed are taken from c_ospeed / c_ispeed
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ospeed = baudRate;
+    tio.c_ispeed = baudRate;
+
+    if (ioctl(fd, TCSETS2, &tio) != 0)
+        throw std::runtime_error("Error at TCSETS2 - " + std::to_string(errno));
+#else
+    (void)fd;
+    (void)baudRate;
+    throw std::runtime_error("Custom baud rates are not supported on this platform");
+#endif
+}
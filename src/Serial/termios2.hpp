@@ -0,0 +1,16 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+// Kernel termios2 interface conflicts with <termios.h>, so it is kept in its
+// own translation unit, behind functions that do not need any of its types.
+
+namespace MB::Serial::detail {
+/**
+ * @brief Sets arbitrary baud rate of the open port (termios2 with BOTHER).
+ * @throws std::runtime_error - if driver does not accept the rate.
+ */
+void setCustomBaudRate(int fd, unsigned int baudRate);
+} // namespace MB::Serial::detail
@@ -0,0 +1,122 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "Serial/virtualLink.hpp"
+#include "modbusUtils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace MB::Serial;
+
+VirtualLink::VirtualLink(unsigned int baudRate) : _baudRate(baudRate) {
+    try {
+        if (::pipe(_wake) != 0)
+            throw std::runtime_error("Cannot create pipe - " + std::to_string(errno));
+
+        for (std::size_t end = 0; end < 2; end++) {
+            _masters[end] = ::posix_openpt(O_RDWR | O_NOCTTY);
+            if (_masters[end] < 0 || ::grantpt(_masters[end]) != 0 ||
+                ::unlockpt(_masters[end]) != 0)
+                throw std::runtime_error("Cannot create pseudo terminal - " +
+                                         std::to_string(errno));
+
+            _paths[end]  = ::ptsname(_masters[end]);
+            _slaves[end] = ::open(_paths[end].c_str(), O_RDWR | O_NOCTTY);
+            if (_slaves[end] < 0)
+                throw std::runtime_error("Cannot open " + _paths[end]);
+
+            // No echo or line editing, even before the end is configured
+            termios tty{};
+            ::tcgetattr(_slaves[end], &tty);
+            ::cfmakeraw(&tty);
+            ::tcsetattr(_slaves[end], TCSANOW, &tty);
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+
+    _relay = std::thread(&VirtualLink::relay, this);
+}
+
+VirtualLink::~VirtualLink() {
+    const uint8_t wake = 1;
+    utils::ignore_result(::write(_wake[1], &wake, 1));
+    if (_relay.joinable())
+        _relay.join();
+
+    close();
+}
+
+void VirtualLink::close() {
+    for (auto *fds : {&_masters, &_slaves}) {
+        for (auto &fd : *fds) {
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+        }
+    }
+
+    for (auto &fd : _wake) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+}
+
+void VirtualLink::relay() {
+    using Clock = std::chrono::steady_clock;
+    auto lineFree = Clock::now();
+    uint8_t buffer[256];
+
+    while (true) {
+        pollfd fds[3] = {{_masters[0], POLLIN, 0},
+                         {_masters[1], POLLIN, 0},
+                         {_wake[0], POLLIN, 0}};
+        if (::poll(fds, 3, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        if (fds[2].revents != 0)
+            return;
+
+        for (std::size_t end = 0; end < 2; end++) {
+            if ((fds[end].revents & POLLIN) == 0)
+                continue;
+
+            const auto size = ::read(_masters[end], buffer, sizeof(buffer));
+            if (size <= 0)
+                continue;
+
+            if (_baudRate > 0) {
+                // Bytes arrive after they are transmitted, one transmission at a time
+                const auto bits = static_cast<uint64_t>(size) * 11u * 1'000'000'000u;
+                const auto wire = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::nanoseconds(bits / _baudRate));
+                lineFree = std::max(lineFree, Clock::now()) + wire;
+                std::this_thread::sleep_until(lineFree);
+            }
+
+            const auto other = _masters[1 - end];
+            utils::ignore_result(::write(other, buffer, static_cast<std::size_t>(size)));
+            _relayed += static_cast<uint64_t>(size);
+        }
+    }
+}
+
+void VirtualLink::inject(const std::vector<uint8_t> &bytes) {
+    for (const auto fd : _masters) {
+        utils::ignore_result(::write(fd, bytes.data(), bytes.size()));
+    }
+}
@@ -3,12 +3,17 @@
 // Licensed under: MIT License <http://opensource.org/licenses/MIT>
 
 #include "TCP/connection.hpp"
+#include "transport.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <sys/poll.h>
 #include <sys/socket.h>
 
 using namespace MB::TCP;
 
+static_assert(MB::isClientTransport<Connection> && MB::isServerTransport<Connection>,
+              "Connection has to be usable with generic clients and servers");
+
 Connection::Connection(const int sockfd) noexcept {
     _sockfd    = sockfd;
     _messageID = 0;
@@ -23,83 +28,58 @@ Connection::~Connection() {
 }
 
 std::vector<uint8_t> Connection::sendRequest(const MB::ModbusRequest &req) {
-    std::vector<uint8_t> rawReq;
-    rawReq.reserve(6);
-
-    rawReq.push_back(
-        static_cast<const uint8_t &&>(reinterpret_cast<const uint8_t *>(&_messageID)[1]));
-    rawReq.push_back(static_cast<uint8_t>(_messageID));
-    rawReq.push_back(0x00);
-    rawReq.push_back(0x00);
-
-    std::vector<uint8_t> dat = req.toRaw();
-
-    uint32_t size = dat.size();
-    rawReq.push_back(
-        static_cast<const uint16_t &&>(reinterpret_cast<const uint16_t *>(&size)[1]));
-    rawReq.push_back(static_cast<uint16_t>(size));
+    _messageID        = _nextID++;
+    const auto rawReq = MB::MBAP::wrap(_messageID, req.toRaw());
 
-    rawReq.insert(rawReq.end(), dat.begin(), dat.end());
+    _outstanding[_messageID] = {req.slaveID(), std::chrono::steady_clock::now()};
+    // Id may be reused after wrap around
+    _early.erase(_messageID);
+    ::send(_sockfd, rawReq.data(), rawReq.size(), 0);
+    trace(TraceEvent::FrameSent, TraceSource::TCP, _sockfd, rawReq);
+    capture(true, rawReq);
 
-    ::send(_sockfd, rawReq.begin().base(), rawReq.size(), 0);
+    if (_metrics)
+        _metrics->requestSent(req.slaveID(), rawReq.size());
 
     return rawReq;
 }
 
 std::vector<uint8_t> Connection::sendResponse(const MB::ModbusResponse &res) {
-    std::vector<uint8_t> rawReq;
-    rawReq.reserve(6);
-
-    rawReq.push_back(
-        static_cast<const uint8_t &&>(reinterpret_cast<const uint8_t *>(&_messageID)[1]));
-    rawReq.push_back(static_cast<uint8_t>(_messageID));
-    rawReq.push_back(0x00);
-    rawReq.push_back(0x00);
-
-    std::vector<uint8_t> dat = res.toRaw();
-
-    uint32_t size = dat.size();
-    rawReq.push_back(
-        static_cast<const uint16_t &&>(reinterpret_cast<const uint16_t *>(&size)[1]));
-    rawReq.push_back(static_cast<uint16_t>(size));
+    const auto rawReq = MB::MBAP::wrap(_messageID, res.toRaw());
 
-    rawReq.insert(rawReq.end(), dat.begin(), dat.end());
+    ::send(_sockfd, rawReq.data(), rawReq.size(), 0);
+    trace(TraceEvent::FrameSent, TraceSource::TCP, _sockfd, rawReq);
+    capture(true, rawReq);
 
-    ::send(_sockfd, rawReq.begin().base(), rawReq.size(), 0);
+    if (_metrics)
+        _metrics->responseSent(res.slaveID(), rawReq.size());
 
     return rawReq;
 }
 
 std::vector<uint8_t> Connection::sendException(const MB::ModbusException &ex) {
-    std::vector<uint8_t> rawReq;
-    rawReq.reserve(6);
+    const auto rawReq = MB::MBAP::wrap(_messageID, ex.toRaw());
 
-    rawReq.push_back(
-        static_cast<const uint8_t &&>(reinterpret_cast<const uint8_t *>(&_messageID)[1]));
-    rawReq.push_back(static_cast<uint8_t>(_messageID));
-    rawReq.push_back(0x00);
-    rawReq.push_back(0x00);
+    ::send(_sockfd, rawReq.data(), rawReq.size(), 0);
+    trace(TraceEvent::FrameSent, TraceSource::TCP, _sockfd, rawReq);
+    capture(true, rawReq);
 
-    std::vector<uint8_t> dat = ex.toRaw();
-
-    uint32_t size = dat.size();
-    rawReq.push_back(
-        static_cast<const uint16_t &&>(reinterpret_cast<const uint16_t *>(&size)[1]));
-    rawReq.push_back(static_cast<uint16_t>(size));
-
-    rawReq.insert(rawReq.end(), dat.begin(), dat.end());
-
-    ::send(_sockfd, rawReq.begin().base(), rawReq.size(), 0);
+    if (_metrics)
+        _metrics->responseSent(ex.slaveID(), rawReq.size());
 
     return rawReq;
 }
 
 std::vector<uint8_t> Connection::awaitRawMessage() {
+    // Already received, e.g. by awaitResponse() reading more than one frame
+    if (_deframer.buffered() > 0)
+        return _deframer.take();
+
     pollfd pfd;
     pfd.fd      = this->_sockfd;
     pfd.events  = POLLIN;
     pfd.revents = POLLIN;
-    if (::poll(&pfd, 1, 60 * 1000 /* 1 minute means the connection has died */) <= 0) {
+    if (::poll(&pfd, 1, _idleTimeout) <= 0) {
         throw MB::ModbusException(MB::utils::ConnectionClosed);
     }
 
@@ -115,74 +95,178 @@ std::vector<uint8_t> Connection::awaitRawMessage() {
 
     r.resize(size); // Set vector to proper shape
     r.shrink_to_fit();
+    trace(TraceEvent::FrameReceived, TraceSource::TCP, _sockfd, r);
+    capture(false, r);
+    if (_metrics)
+        _metrics->bytesReceived(r.size());
 
     return r;
 }
 
+std::optional<std::vector<uint8_t>>
+Connection::receiveFrame(std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        // Single read may contain several frames
+        if (auto frame = _deframer.next())
+            return frame;
+
+        const auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - std::chrono::steady_clock::now());
+        const auto timeout = std::max<long long>((left.count() + 999) / 1000, 0);
+
+        pollfd pfd;
+        pfd.fd      = this->_sockfd;
+        pfd.events  = POLLIN;
+        pfd.revents = POLLIN;
+        if (::poll(&pfd, 1, static_cast<int>(timeout)) <= 0)
+            return std::nullopt;
+
+        std::vector<uint8_t> r(1024);
+        auto size = ::recv(_sockfd, r.begin().base(), r.size(), 0);
+
+        if (size == -1)
+            throw MB::ModbusException(MB::utils::ProtocolError);
+        else if (size == 0) {
+            throw MB::ModbusException(MB::utils::ConnectionClosed);
+        }
+
+        r.resize(size); // Set vector to proper shape
+        trace(TraceEvent::FrameReceived, TraceSource::TCP, _sockfd, r);
+        capture(false, r);
+        if (_metrics)
+            _metrics->bytesReceived(r.size());
+        _deframer.append(r);
+    }
+}
+
 MB::ModbusRequest Connection::awaitRequest() {
-    pollfd pfd;
-    pfd.fd      = this->_sockfd;
-    pfd.events  = POLLIN;
-    pfd.revents = POLLIN;
-    if (::poll(&pfd, 1, 60 * 1000 /* 1 minute means the connection has died */) <= 0) {
+    auto r = receiveFrame(std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(_idleTimeout));
+    if (!r)
         throw MB::ModbusException(MB::utils::Timeout);
-    }
 
-    std::vector<uint8_t> r(1024);
+    _messageID = MB::MBAP::parseHeader(r->data()).transactionId;
 
-    auto size = ::recv(_sockfd, r.begin().base(), r.size(), 0);
+    r->erase(r->begin(), r->begin() + 6);
 
-    if (size == -1)
-        throw MB::ModbusException(MB::utils::ProtocolError);
-    else if (size == 0) {
-        throw MB::ModbusException(MB::utils::ConnectionClosed);
-    }
+    auto request = MB::ModbusRequest::fromRaw(*r);
+    if (_metrics)
+        _metrics->requestReceived(request.slaveID());
+    return request;
+}
 
-    r.resize(size); // Set vector to proper shape
-    r.shrink_to_fit();
+MB::ModbusResponse Connection::awaitResponse(uint16_t transactionId) {
+    const auto now   = std::chrono::steady_clock::now();
+    const auto found = _outstanding.find(transactionId);
+    // Id set by setMessageId(), without a request
+    const auto request =
+        found != _outstanding.end() ? found->second : Outstanding{0xFF, now};
+
+    // Estimated timeout covers the whole round trip, so it runs from sending,
+    // not from the call (which may come later for pipelined requests)
+    auto deadline = now + std::chrono::milliseconds(this->_timeout);
+    if (_rtt)
+        deadline = request.sent + _rtt->timeout(request.unit);
+
+    std::vector<uint8_t> r;
+    while (true) {
+        const auto early = _early.find(transactionId);
+        if (early != _early.end()) {
+            r = std::move(early->second);
+            _early.erase(early);
+            break;
+        }
+
+        auto frame = receiveFrame(deadline);
+        if (!frame) {
+            _outstanding.erase(transactionId);
+            reportOutcome(request, MB::utils::Timeout);
+            throw MB::ModbusException(MB::utils::Timeout);
+        }
+
+        const auto resultMessageID = MB::MBAP::parseHeader(frame->data()).transactionId;
+        if (resultMessageID == transactionId) {
+            r = std::move(*frame);
+            break;
+        }
+
+        // Response to other request in flight, late responses are dropped
+        if (_outstanding.count(resultMessageID) > 0)
+            _early[resultMessageID] = std::move(*frame);
+    }
+    _outstanding.erase(transactionId);
 
-    const auto resultMessageID = *reinterpret_cast<uint16_t *>(&r[0]);
+    r.erase(r.begin(), r.begin() + 6);
 
-    _messageID = resultMessageID;
+    if (MB::ModbusException::exist(r)) {
+        const auto exception = MB::ModbusException(r);
+        reportOutcome(request, exception.getErrorCode());
+        throw exception;
+    }
 
-    r.erase(r.begin(), r.begin() + 6);
+    reportOutcome(request, std::nullopt);
+    return MB::ModbusResponse::fromRaw(r);
+}
 
-    return MB::ModbusRequest::fromRaw(r);
+void Connection::forgetResponse(uint16_t transactionId) {
+    _outstanding.erase(transactionId);
+    _early.erase(transactionId);
 }
 
-MB::ModbusResponse Connection::awaitResponse() {
-    pollfd pfd;
-    pfd.fd      = this->_sockfd;
-    pfd.events  = POLLIN;
-    pfd.revents = POLLIN;
+void Connection::reportOutcome(const Outstanding &request,
+                               std::optional<utils::MBErrorCode> error) {
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - request.sent);
+    // Exception response is still a response
+    const bool responded = !error.has_value() || utils::isStandardErrorCode(*error);
+
+    if (_rtt) {
+        if (responded)
+            _rtt->sample(request.unit, latency);
+        else if (*error == utils::Timeout)
+            _rtt->timedOut(request.unit);
+    }
 
-    if (::poll(&pfd, 1, this->_timeout) <= 0) {
-        throw MB::ModbusException(MB::utils::Timeout);
+    if (_metrics) {
+        if (responded)
+            _metrics->responseReceived(request.unit, latency);
+        if (error.has_value())
+            _metrics->error(request.unit, *error);
     }
 
-    std::vector<uint8_t> r(1024);
-    auto size = ::recv(this->_sockfd, r.begin().base(), r.size(), 0);
+    if (error.has_value())
+        traceError(TraceSource::TCP, _sockfd, *error);
+}
 
-    if (size == -1)
-        throw MB::ModbusException(MB::utils::ProtocolError);
-    else if (size == 0) {
-        throw MB::ModbusException(MB::utils::ConnectionClosed);
-    }
+void Connection::setCapture(std::shared_ptr<PcapWriter> capture) {
+    if (capture && capture->linkType() != PcapLinkType::Raw)
+        throw std::invalid_argument("TCP capture requires raw link type");
 
-    r.resize(size); // Set vector to proper shape
-    r.shrink_to_fit();
+    const auto endpointOf = [](const sockaddr_in &address) {
+        return PcapEndpoint{ntohl(address.sin_addr.s_addr), ntohs(address.sin_port)};
+    };
 
-    const auto resultMessageID = *reinterpret_cast<uint16_t *>(&r[0]);
+    sockaddr_in address{};
+    socklen_t size = sizeof(address);
+    if (::getsockname(_sockfd, reinterpret_cast<sockaddr *>(&address), &size) == 0)
+        _local = endpointOf(address);
 
-    if (resultMessageID != this->_messageID)
-        throw MB::ModbusException(MB::utils::InvalidMessageID);
+    address = {};
+    size    = sizeof(address);
+    if (::getpeername(_sockfd, reinterpret_cast<sockaddr *>(&address), &size) == 0)
+        _peer = endpointOf(address);
 
-    r.erase(r.begin(), r.begin() + 6);
+    _capture = std::move(capture);
+}
 
-    if (MB::ModbusException::exist(r))
-        throw MB::ModbusException(r);
+void Connection::capture(bool sent, const std::vector<uint8_t> &frame) {
+    if (!_capture)
+        return;
 
-    return MB::ModbusResponse::fromRaw(r);
+    if (sent)
+        _capture->writeTcp(_local, _peer, frame);
+    else
+        _capture->writeTcp(_peer, _local, frame);
 }
 
 Connection::Connection(Connection &&moved) noexcept {
@@ -191,6 +275,17 @@ Connection::Connection(Connection &&moved) noexcept {
 
     _sockfd       = moved._sockfd;
     _messageID    = moved._messageID;
+    _nextID       = moved._nextID;
+    _timeout      = moved._timeout;
+    _idleTimeout  = moved._idleTimeout;
+    _rtt          = std::move(moved._rtt);
+    _metrics      = std::move(moved._metrics);
+    _capture      = std::move(moved._capture);
+    _local        = moved._local;
+    _peer         = moved._peer;
+    _deframer     = std::move(moved._deframer);
+    _outstanding  = std::move(moved._outstanding);
+    _early        = std::move(moved._early);
     moved._sockfd = -1;
 }
 
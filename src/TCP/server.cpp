@@ -26,6 +26,12 @@ Server::Server(int port) {
                sizeof(_server)) < 0)
         throw std::runtime_error("Cannot bind socket");
 
+    // Port chosen by the system, if 0 was given
+    socklen_t size = sizeof(_server);
+    if (::getsockname(_serverfd, reinterpret_cast<struct sockaddr *>(&_server), &size) ==
+        0)
+        _port = ::ntohs(_server.sin_port);
+
     ::listen(_serverfd, 255);
 }
 
@@ -42,8 +48,11 @@ std::optional<Connection> Server::awaitConnection() {
     auto connfd =
         ::accept(_serverfd, reinterpret_cast<struct sockaddr *>(&_server), &addrLen);
 
-    if (connfd < 0)
-        throw;
+    if (connfd < 0) {
+        traceError(TraceSource::Server, _serverfd, utils::ConnectionClosed);
+        return std::nullopt;
+    }
 
+    trace(TraceEvent::ConnectionAccepted, TraceSource::Server, connfd, nullptr, 0);
     return Connection(connfd);
 }
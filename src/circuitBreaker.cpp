@@ -0,0 +1,91 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "circuitBreaker.hpp"
+
+#include <stdexcept>
+
+using namespace MB;
+
+CircuitBreaker::CircuitBreaker(std::size_t failureThreshold, Clock::duration openTime)
+    : _failureThreshold(failureThreshold), _openTime(openTime) {
+    if (failureThreshold == 0)
+        throw std::invalid_argument("Circuit breaker failure threshold can not be 0");
+}
+
+bool CircuitBreaker::allow(uint8_t unitId, Clock::time_point now) {
+    if (unitId == 0)
+        return true;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &unit = _units[unitId];
+
+    switch (unit.state) {
+    case State::Closed:
+        return true;
+    case State::Open:
+    case State::HalfOpen:
+        // In HalfOpen state probe is on its way, but if its outcome is never
+        // reported, another one is let through after the open time
+        if (now - unit.openedAt < _openTime)
+            return false;
+        unit.state    = State::HalfOpen;
+        unit.openedAt = now;
+        return true;
+    }
+
+    return true;
+}
+
+void CircuitBreaker::check(uint8_t unitId, utils::MBFunctionCode functionCode,
+                           Clock::time_point now) {
+    if (!allow(unitId, now))
+        throw ModbusException(utils::CircuitOpen, unitId, functionCode);
+}
+
+void CircuitBreaker::success(uint8_t unitId) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _units[unitId] = Unit();
+}
+
+void CircuitBreaker::failure(uint8_t unitId, Clock::time_point now) {
+    if (unitId == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &unit = _units[unitId];
+
+    unit.failures++;
+    if (unit.state == State::HalfOpen || unit.failures >= _failureThreshold)
+        open(unit, now);
+}
+
+void CircuitBreaker::report(uint8_t unitId, std::optional<utils::MBErrorCode> error,
+                            Clock::time_point now) {
+    if (error == utils::CircuitOpen)
+        return; // Nothing was sent
+
+    if (!error.has_value() ||
+        (utils::isStandardErrorCode(*error) && *error != utils::SlaveDeviceFailure))
+        success(unitId);
+    else
+        failure(unitId, now);
+}
+
+CircuitBreaker::State CircuitBreaker::state(uint8_t unitId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _units[unitId].state;
+}
+
+std::size_t CircuitBreaker::failures(uint8_t unitId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _units[unitId].failures;
+}
+
+void CircuitBreaker::reset(uint8_t unitId) { success(unitId); }
+
+void CircuitBreaker::open(Unit &unit, Clock::time_point now) {
+    unit.state    = State::Open;
+    unit.openedAt = now;
+}
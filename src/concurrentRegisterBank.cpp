@@ -0,0 +1,158 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "concurrentRegisterBank.hpp"
+
+#include <thread>
+
+using namespace MB;
+
+ConcurrentRegisterBank::Table::Table(std::size_t size, std::size_t regionSize)
+    : _size(size), _regionSize(regionSize > 0 ? regionSize : DefaultRegionSize),
+      _values(new std::atomic<uint16_t>[size]()),
+      _regions(new Region[(size + _regionSize - 1) / _regionSize]) {}
+
+void ConcurrentRegisterBank::Table::read(std::size_t address, std::size_t count,
+                                         uint16_t *out) const {
+    if (count == 0)
+        return;
+
+    const auto first = address / _regionSize;
+    const auto last  = (address + count - 1) / _regionSize;
+
+    // Sequences only grow, so sum of them changes if any of the regions changed
+    while (true) {
+        uint64_t before = 0;
+        bool writing    = false;
+        for (auto r = first; r <= last; r++) {
+            const auto sequence = _regions[r].sequence.load(std::memory_order_acquire);
+            writing |= (sequence & 1) != 0;
+            before += sequence;
+        }
+
+        if (writing) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            out[i] = _values[address + i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        uint64_t after = 0;
+        for (auto r = first; r <= last; r++) {
+            after += _regions[r].sequence.load(std::memory_order_relaxed);
+        }
+
+        if (before == after)
+            return;
+    }
+}
+
+void ConcurrentRegisterBank::Table::write(std::size_t address, std::size_t count,
+                                          const uint16_t *in) {
+    if (count == 0)
+        return;
+
+    const auto first = address / _regionSize;
+    const auto last  = (address + count - 1) / _regionSize;
+
+    // Odd sequence marks region as being written
+    for (auto r = first; r <= last; r++) {
+        auto &sequence = _regions[r].sequence;
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < count; i++) {
+        _values[address + i].store(in[i], std::memory_order_relaxed);
+    }
+
+    for (auto r = first; r <= last; r++) {
+        auto &sequence = _regions[r].sequence;
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+    }
+}
+
+ConcurrentRegisterBank::ConcurrentRegisterBank(std::size_t coils,
+                                               std::size_t discreteInputs,
+                                               std::size_t holdingRegisters,
+                                               std::size_t inputRegisters,
+                                               std::size_t regionSize)
+    // Order of tables is the same as in utils::MBFunctionRegisters
+    : _tables{Table(coils, regionSize), Table(discreteInputs, regionSize),
+              Table(holdingRegisters, regionSize), Table(inputRegisters, regionSize)} {}
+
+const ConcurrentRegisterBank::Table &
+ConcurrentRegisterBank::tableOf(utils::MBFunctionRegisters table) const {
+    return _tables[static_cast<std::size_t>(table)];
+}
+
+ConcurrentRegisterBank::Table &
+ConcurrentRegisterBank::tableOf(utils::MBFunctionRegisters table) {
+    return _tables[static_cast<std::size_t>(table)];
+}
+
+void ConcurrentRegisterBank::checkRange(utils::MBFunctionRegisters table,
+                                        uint16_t address, std::size_t count) const {
+    if (address + count > tableOf(table).size())
+        throw ModbusException(utils::IllegalDataAddress);
+}
+
+std::variant<ModbusResponse, ModbusException>
+ConcurrentRegisterBank::handle(const ModbusRequest &request) {
+    return serveRequest(*this, request);
+}
+
+void ConcurrentRegisterBank::read(utils::MBFunctionRegisters table, uint16_t address,
+                                  std::size_t count, uint16_t *out) const {
+    checkRange(table, address, count);
+    tableOf(table).read(address, count, out);
+}
+
+std::vector<uint16_t> ConcurrentRegisterBank::read(utils::MBFunctionRegisters table,
+                                                   uint16_t address,
+                                                   std::size_t count) const {
+    std::vector<uint16_t> values(count);
+    read(table, address, count, values.data());
+    return values;
+}
+
+void ConcurrentRegisterBank::write(utils::MBFunctionRegisters table, uint16_t address,
+                                   const uint16_t *in, std::size_t count) {
+    checkRange(table, address, count);
+
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    tableOf(table).write(address, count, in);
+}
+
+std::vector<ModbusCell>
+ConcurrentRegisterBank::readCells(utils::MBFunctionRegisters table, uint16_t address,
+                                  uint16_t count) const {
+    const auto values = read(table, address, count);
+    const bool isBit  = table == utils::OutputCoils || table == utils::InputContacts;
+
+    std::vector<ModbusCell> cells(count);
+    for (std::size_t i = 0; i < count; i++) {
+        cells[i] = isBit ? ModbusCell::initCoil(values[i] != 0)
+                         : ModbusCell::initReg(values[i]);
+    }
+    return cells;
+}
+
+void ConcurrentRegisterBank::writeCells(utils::MBFunctionRegisters table,
+                                        uint16_t address,
+                                        const std::vector<ModbusCell> &values) {
+    const bool isBit = table == utils::OutputCoils || table == utils::InputContacts;
+
+    std::vector<uint16_t> raw(values.size());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        raw[i] = isBit ? static_cast<uint16_t>(values[i].coil()) : values[i].reg();
+    }
+    write(table, address, raw.data(), raw.size());
+}
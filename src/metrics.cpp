@@ -0,0 +1,312 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace MB;
+
+std::size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < SubBuckets)
+        return static_cast<std::size_t>(value);
+
+    std::size_t exponent = 4;
+    while (exponent < MaxExponent && (value >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    if ((value >> (MaxExponent + 1)) != 0)
+        return BucketCount - 1;
+
+    const auto sub = (value >> (exponent - 4)) & (SubBuckets - 1);
+    return (exponent - 3) * SubBuckets + static_cast<std::size_t>(sub);
+}
+
+uint64_t LatencyHistogram::bucketLowest(std::size_t bucket) {
+    if (bucket < SubBuckets)
+        return bucket;
+
+    const auto exponent = bucket / SubBuckets + 3;
+    const auto sub      = bucket % SubBuckets;
+    return static_cast<uint64_t>(SubBuckets + sub) << (exponent - 4);
+}
+
+uint64_t LatencyHistogram::bucketHighest(std::size_t bucket) {
+    if (bucket < SubBuckets)
+        return bucket;
+
+    const auto exponent = bucket / SubBuckets + 3;
+    return bucketLowest(bucket) + (uint64_t(1) << (exponent - 4)) - 1;
+}
+
+void LatencyHistogram::record(Duration value) {
+    const auto micros = static_cast<uint64_t>(std::max<int64_t>(value.count(), 0));
+
+    _counts[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(micros, std::memory_order_relaxed);
+
+    auto min = _min.load(std::memory_order_relaxed);
+    while (micros < min &&
+           !_min.compare_exchange_weak(min, micros, std::memory_order_relaxed)) {
+    }
+    auto max = _max.load(std::memory_order_relaxed);
+    while (micros > max &&
+           !_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+
+    for (std::size_t i = 0; i < BucketCount; i++) {
+        snapshot.counts[i] = _counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+
+    snapshot.sum = Duration(_sum.load(std::memory_order_relaxed));
+    snapshot.max = Duration(_max.load(std::memory_order_relaxed));
+    if (snapshot.count > 0)
+        snapshot.min = Duration(_min.load(std::memory_order_relaxed));
+
+    return snapshot;
+}
+
+LatencyHistogram::Duration LatencyHistogram::Snapshot::percentile(double quantile) const {
+    if (count == 0)
+        return Duration(0);
+
+    quantile          = std::clamp(quantile, 0.0, 1.0);
+    const auto rank   = std::ceil(quantile * static_cast<double>(count));
+    const auto target = std::max<uint64_t>(static_cast<uint64_t>(rank), 1);
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BucketCount; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            const auto highest = static_cast<int64_t>(bucketHighest(i));
+            return std::clamp(Duration(highest), min, max);
+        }
+    }
+
+    return max;
+}
+
+Metrics::~Metrics() {
+    for (auto &unit : _units) {
+        delete unit.load();
+    }
+}
+
+Metrics::Unit &Metrics::unit(uint8_t unitId) {
+    auto *existing = _units[unitId].load(std::memory_order_acquire);
+    if (existing != nullptr)
+        return *existing;
+
+    // First use of the unit, only one of the racing threads installs its copy
+    auto *created = new Unit();
+    if (_units[unitId].compare_exchange_strong(existing, created,
+                                               std::memory_order_acq_rel)) {
+        return *created;
+    }
+
+    delete created;
+    return *existing;
+}
+
+void Metrics::requestSent(uint8_t unitId, std::size_t bytes) {
+    _bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+    _framesOut.fetch_add(1, std::memory_order_relaxed);
+    unit(unitId).requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::responseSent(uint8_t unitId, std::size_t bytes) {
+    _bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+    _framesOut.fetch_add(1, std::memory_order_relaxed);
+    unit(unitId).responsesSent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::frameSent(std::size_t bytes) {
+    _bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+    _framesOut.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::requestReceived(uint8_t unitId) {
+    _framesIn.fetch_add(1, std::memory_order_relaxed);
+    unit(unitId).requestsReceived.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::responseReceived(uint8_t unitId, Duration latency) {
+    _framesIn.fetch_add(1, std::memory_order_relaxed);
+
+    auto &target = unit(unitId);
+    target.responses.fetch_add(1, std::memory_order_relaxed);
+    target.latency.record(latency);
+}
+
+void Metrics::error(uint8_t unitId, utils::MBErrorCode code) {
+    auto &target = unit(unitId);
+
+    switch (code) {
+    case utils::Timeout:
+        target.timeouts.fetch_add(1, std::memory_order_relaxed);
+        return;
+    case utils::InvalidCRC:
+    case utils::ErrorCodeCRCError:
+        target.crcErrors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    case utils::InvalidMessageID:
+        target.invalidMessageIds.fetch_add(1, std::memory_order_relaxed);
+        return;
+    default:
+        break;
+    }
+
+    if (utils::isStandardErrorCode(code) && code < ExceptionCodes)
+        target.exceptions[code].fetch_add(1, std::memory_order_relaxed);
+    else
+        target.otherErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+Metrics::Snapshot Metrics::snapshot() const {
+    Snapshot snapshot{_bytesIn.load(std::memory_order_relaxed),
+                      _bytesOut.load(std::memory_order_relaxed),
+                      _framesIn.load(std::memory_order_relaxed),
+                      _framesOut.load(std::memory_order_relaxed),
+                      {}};
+
+    for (std::size_t id = 0; id < _units.size(); id++) {
+        const auto *unit = _units[id].load(std::memory_order_acquire);
+        if (unit == nullptr)
+            continue;
+
+        UnitSnapshot result{static_cast<uint8_t>(id),
+                            unit->requests.load(std::memory_order_relaxed),
+                            unit->responses.load(std::memory_order_relaxed),
+                            unit->timeouts.load(std::memory_order_relaxed),
+                            unit->crcErrors.load(std::memory_order_relaxed),
+                            unit->invalidMessageIds.load(std::memory_order_relaxed),
+                            unit->otherErrors.load(std::memory_order_relaxed),
+                            {},
+                            unit->latency.snapshot(),
+                            unit->responsesSent.load(std::memory_order_relaxed),
+                            unit->requestsReceived.load(std::memory_order_relaxed)};
+        for (std::size_t code = 0; code < ExceptionCodes; code++) {
+            const auto &counter     = unit->exceptions[code];
+            result.exceptions[code] = counter.load(std::memory_order_relaxed);
+        }
+
+        snapshot.units.push_back(result);
+    }
+
+    return snapshot;
+}
+
+namespace {
+std::string escapeLabel(const std::string &value) {
+    std::string result;
+    for (const auto c : value) {
+        if (c == '\\' || c == '"')
+            result += '\\';
+        if (c == '\n') {
+            result += "\\n";
+            continue;
+        }
+        result += c;
+    }
+    return result;
+}
+
+double seconds(std::chrono::microseconds value) {
+    return static_cast<double>(value.count()) / 1e6;
+}
+} // namespace
+
+std::string MB::toPrometheus(
+    const std::vector<std::pair<std::string, Metrics::Snapshot>> &connections,
+    const std::string &prefix) {
+    std::ostringstream out;
+
+    const auto header = [&](const std::string &name, const char *type,
+                            const char *help) {
+        out << "# HELP " << prefix << "_" << name << " " << help << "\n";
+        out << "# TYPE " << prefix << "_" << name << " " << type << "\n";
+    };
+
+    const auto connectionCounter = [&](const std::string &name, const char *help,
+                                       uint64_t Metrics::Snapshot::*field) {
+        header(name, "counter", help);
+        for (const auto &[label, snapshot] : connections) {
+            out << prefix << "_" << name << "{connection=\"" << escapeLabel(label)
+                << "\"} " << snapshot.*field << "\n";
+        }
+    };
+
+    const auto unitCounter = [&](const std::string &name, const char *help,
+                                 uint64_t Metrics::UnitSnapshot::*field) {
+        header(name, "counter", help);
+        for (const auto &[label, snapshot] : connections) {
+            for (const auto &unit : snapshot.units) {
+                out << prefix << "_" << name << "{connection=\"" << escapeLabel(label)
+                    << "\",unit=\"" << int(unit.unitId) << "\"} " << unit.*field << "\n";
+            }
+        }
+    };
+
+    connectionCounter("bytes_in_total", "Bytes received.", &Metrics::Snapshot::bytesIn);
+    connectionCounter("bytes_out_total", "Bytes sent.", &Metrics::Snapshot::bytesOut);
+    connectionCounter("frames_in_total", "Frames received.",
+                      &Metrics::Snapshot::framesIn);
+    connectionCounter("frames_out_total", "Frames sent.", &Metrics::Snapshot::framesOut);
+
+    unitCounter("requests_total", "Requests sent.", &Metrics::UnitSnapshot::requests);
+    unitCounter("responses_total", "Responses received, including exceptions.",
+                &Metrics::UnitSnapshot::responses);
+    unitCounter("requests_received_total", "Requests received by the slave.",
+                &Metrics::UnitSnapshot::requestsReceived);
+    unitCounter("responses_sent_total", "Responses sent by the slave.",
+                &Metrics::UnitSnapshot::responsesSent);
+    unitCounter("timeouts_total", "Requests without response.",
+                &Metrics::UnitSnapshot::timeouts);
+    unitCounter("crc_errors_total", "Frames with invalid CRC.",
+                &Metrics::UnitSnapshot::crcErrors);
+    unitCounter("invalid_message_ids_total", "Responses with unexpected message id.",
+                &Metrics::UnitSnapshot::invalidMessageIds);
+    unitCounter("other_errors_total", "Other transaction errors.",
+                &Metrics::UnitSnapshot::otherErrors);
+
+    header("exceptions_total", "counter", "Exception responses by exception code.");
+    for (const auto &[label, snapshot] : connections) {
+        for (const auto &unit : snapshot.units) {
+            for (std::size_t code = 0; code < Metrics::ExceptionCodes; code++) {
+                if (unit.exceptions[code] == 0)
+                    continue;
+                out << prefix << "_exceptions_total{connection=\"" << escapeLabel(label)
+                    << "\",unit=\"" << int(unit.unitId) << "\",code=\"" << code << "\"} "
+                    << unit.exceptions[code] << "\n";
+            }
+        }
+    }
+
+    header("latency_seconds", "summary", "Time from request to response.");
+    for (const auto &[label, snapshot] : connections) {
+        for (const auto &unit : snapshot.units) {
+            const auto labels = "connection=\"" + escapeLabel(label) + "\",unit=\"" +
+                                std::to_string(unit.unitId) + "\"";
+            for (const auto quantile : {0.5, 0.9, 0.99, 0.999}) {
+                out << prefix << "_latency_seconds{" << labels << ",quantile=\""
+                    << quantile << "\"} " << seconds(unit.latency.percentile(quantile))
+                    << "\n";
+            }
+            out << prefix << "_latency_seconds_sum{" << labels << "} "
+                << seconds(unit.latency.sum) << "\n";
+            out << prefix << "_latency_seconds_count{" << labels << "} "
+                << unit.latency.count << "\n";
+        }
+    }
+
+    return out.str();
+}
@@ -64,8 +64,8 @@ std::vector<uint8_t> ModbusException::toRaw() const noexcept {
     std::vector<uint8_t> result(3);
 
     result[0] = _slaveId;
-    result[1] = static_cast<uint8_t>(_errorCode | 0b10000000);
-    result[2] = static_cast<uint8_t>(_functionCode);
+    result[1] = static_cast<uint8_t>(_functionCode | 0b10000000);
+    result[2] = static_cast<uint8_t>(_errorCode);
 
     return result;
 }
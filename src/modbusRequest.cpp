@@ -5,6 +5,7 @@
 #include "modbusRequest.hpp"
 #include "modbusException.hpp"
 #include "modbusUtils.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
 #include <iterator>
@@ -17,7 +18,10 @@ ModbusRequest::ModbusRequest(uint8_t slaveId, utils::MBFunctionCode functionCode
                              std::vector<ModbusCell> values) noexcept
     : _slaveID(slaveId), _functionCode(functionCode), _address(address),
       _registersNumber(registersNumber), _values(std::move(values)) {
-    // Force proper modbuscell type
+    // Force proper modbuscell type, cells of user defined functions are left as is
+    if (!utils::isStandardFunctionCode(_functionCode))
+        return;
+
     switch (functionRegisters()) {
     case utils::OutputCoils:
     case utils::InputContacts:
@@ -49,7 +53,9 @@ ModbusRequest &ModbusRequest::operator=(const ModbusRequest &reference) {
 
 ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
     try {
-        if (inputData.size() < 3)
+        // Every supported request has at least slave id, function code and two
+        // 16-bit fields
+        if (inputData.size() < 6)
             throw ModbusException(utils::InvalidByteOrder);
 
         _slaveID      = inputData[0];
@@ -57,7 +63,7 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
         _address      = utils::bigEndianConv(&inputData[2]);
 
         int crcIndex = -1;
-        int8_t follow;
+        uint8_t follow;
 
         switch (_functionCode) {
         case utils::ReadDiscreteOutputCoils:
@@ -80,18 +86,23 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
             break;
         case utils::WriteMultipleDiscreteOutputCoils:
             _registersNumber = utils::bigEndianConv(&inputData[4]);
-            follow           = inputData[6];
-            _values          = std::vector<ModbusCell>(_registersNumber);
-            for (int8_t i = 0; i < _registersNumber; i++) {
+            follow           = inputData.size() > 6 ? inputData[6] : 0;
+            if (inputData.size() < 7u + follow ||
+                follow < (_registersNumber + 7) / 8)
+                throw ModbusException(utils::InvalidByteOrder);
+            _values = std::vector<ModbusCell>(_registersNumber);
+            for (uint16_t i = 0; i < _registersNumber; i++) {
                 _values[i].coil() = inputData[7 + (i / 8)] & (1 << (i % 8));
             }
             crcIndex = 6 + follow + 1;
             break;
         case utils::WriteMultipleAnalogOutputHoldingRegisters:
             _registersNumber = utils::bigEndianConv(&inputData[4]);
-            follow           = inputData[6];
-            _values          = std::vector<ModbusCell>(_registersNumber);
-            for (int8_t i = 0; i < _registersNumber; i++) {
+            follow           = inputData.size() > 6 ? inputData[6] : 0;
+            if (inputData.size() < 7u + follow || follow < _registersNumber * 2)
+                throw ModbusException(utils::InvalidByteOrder);
+            _values = std::vector<ModbusCell>(_registersNumber);
+            for (uint16_t i = 0; i < _registersNumber; i++) {
                 _values[i].reg() = utils::bigEndianConv(&inputData[i * 2 + 7]);
             }
             crcIndex = 6 + follow + 1;
@@ -114,10 +125,14 @@ ModbusRequest::ModbusRequest(const std::vector<uint8_t> &inputData, bool CRC) {
                 throw ModbusException(utils::InvalidCRC, _slaveID);
             }
         }
+
+        trace(TraceEvent::FrameParsed, TraceSource::RequestParser, -1, inputData);
     } catch (const ModbusException &ex) {
+        traceError(TraceSource::RequestParser, -1, ex.getErrorCode());
         throw ex;
     } catch (const std::exception &) {
         // TODO: Save the exception somewhere
+        traceError(TraceSource::RequestParser, -1, utils::InvalidByteOrder);
         throw ModbusException(utils::InvalidByteOrder);
     }
 }
@@ -5,6 +5,7 @@
 #include "modbusResponse.hpp"
 #include "modbusException.hpp"
 #include "modbusUtils.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
 #include <cstdint>
@@ -17,7 +18,10 @@ ModbusResponse::ModbusResponse(uint8_t slaveId, utils::MBFunctionCode functionCo
                                std::vector<ModbusCell> values)
     : _slaveID(slaveId), _functionCode(functionCode), _address(address),
       _registersNumber(registersNumber), _values(std::move(values)) {
-    // Force proper modbuscell type
+    // Force proper modbuscell type, cells of user defined functions are left as is
+    if (!utils::isStandardFunctionCode(_functionCode))
+        return;
+
     switch (functionRegisters()) {
     case utils::OutputCoils:
     case utils::InputContacts:
@@ -35,15 +39,14 @@ ModbusResponse::ModbusResponse(uint8_t slaveId, utils::MBFunctionCode functionCo
 ModbusResponse::ModbusResponse(const ModbusResponse &reference)
     : _slaveID(reference.slaveID()), _functionCode(reference.functionCode()),
       _address(reference.registerAddress()),
-      _registersNumber(reference.numberOfRegisters()),
-      _values(reference.registerValues()) {}
+      _registersNumber(reference.numberOfRegisters()), _values(reference._values) {}
 
 ModbusResponse &ModbusResponse::operator=(const ModbusResponse &reference) {
     this->_slaveID         = reference.slaveID();
     this->_functionCode    = reference.functionCode();
     this->_address         = reference.registerAddress();
     this->_registersNumber = reference.numberOfRegisters();
-    this->_values          = reference.registerValues();
+    this->_values          = reference._values;
     return *this;
 }
 
@@ -118,10 +121,14 @@ ModbusResponse::ModbusResponse(std::vector<uint8_t> inputData, bool CRC) {
                 throw ModbusException(utils::InvalidCRC, _slaveID);
             }
         }
+
+        trace(TraceEvent::FrameParsed, TraceSource::ResponseParser, -1, inputData);
     } catch (const ModbusException &ex) {
+        traceError(TraceSource::ResponseParser, -1, ex.getErrorCode());
         throw ex;
     } catch (const std::exception &) {
         // TODO: Save the exception somewhere
+        traceError(TraceSource::ResponseParser, -1, utils::InvalidByteOrder);
         throw ModbusException(utils::InvalidByteOrder);
     }
 }
@@ -157,7 +164,7 @@ std::string ModbusResponse::toString() const {
 std::vector<uint8_t> ModbusResponse::toRaw() const {
     // Fix for: https://github.com/Mazurel/Modbus/issues/3
     const auto longBytesToFollow = this->numberOfBytesToFollow();
-    if (longBytesToFollow > 0xFF) {
+    if (functionType() == utils::Read && longBytesToFollow > 0xFF) {
         throw ModbusException(utils::NumberOfRegistersInvalid);
     }
     const uint8_t bytesToFollow = static_cast<uint8_t>(longBytesToFollow);
@@ -196,7 +203,8 @@ std::vector<uint8_t> ModbusResponse::toRaw() const {
                 utils::pushUint16(result, _values[0].reg());
             }
         } else {
-            utils::pushUint16(result, bytesToFollow);
+            // Write multiple response echoes quantity of written values
+            utils::pushUint16(result, _registersNumber);
         }
     }
 
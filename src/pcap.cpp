@@ -0,0 +1,245 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "pcap.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace MB;
+
+namespace {
+constexpr uint32_t MagicMicroseconds = 0xA1B2C3D4;
+constexpr uint32_t MagicNanoseconds  = 0xA1B23C4D;
+constexpr uint32_t SnapLength        = 65535;
+// Larger records are treated as corruption, as by libpcap
+constexpr uint32_t MaxSnapLength     = 262144;
+constexpr std::size_t IpHeaderSize   = 20;
+constexpr std::size_t TcpHeaderSize  = 20;
+
+// Pcap headers are written in little endian
+void putLittle32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putBig16(std::vector<uint8_t> &out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putBig32(std::vector<uint8_t> &out, uint32_t value) {
+    putBig16(out, static_cast<uint16_t>(value >> 16));
+    putBig16(out, static_cast<uint16_t>(value));
+}
+
+uint16_t big16(const uint8_t *data) {
+    return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t big32(const uint8_t *data) {
+    return static_cast<uint32_t>(big16(data)) << 16 | big16(data + 2);
+}
+
+// Internet checksum (RFC 1071) continued from the partial sum
+uint32_t sumWords(const uint8_t *data, std::size_t size, uint32_t sum = 0) {
+    for (std::size_t i = 0; i + 1 < size; i += 2) {
+        sum += big16(data + i);
+    }
+    if (size % 2 == 1)
+        sum += static_cast<uint32_t>(data[size - 1]) << 8;
+    return sum;
+}
+
+uint16_t foldChecksum(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+} // namespace
+
+PcapWriter::PcapWriter(const std::string &path, PcapLinkType linkType)
+    : _file(path, std::ios::binary | std::ios::trunc), _linkType(linkType) {
+    if (!_file)
+        throw std::runtime_error("Cannot open capture file " + path);
+
+    std::vector<uint8_t> header;
+    putLittle32(header, MagicNanoseconds);
+    putLittle32(header, 2 | 4 << 16); // Version 2.4
+    putLittle32(header, 0);           // Time zone, always UTC
+    putLittle32(header, 0);           // Accuracy of timestamps
+    putLittle32(header, SnapLength);
+    putLittle32(header, static_cast<uint32_t>(linkType));
+
+    _file.write(reinterpret_cast<const char *>(header.data()), header.size());
+}
+
+void PcapWriter::writeRecord(Clock::time_point timestamp,
+                             const std::vector<uint8_t> &packet) {
+    const auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        timestamp.time_since_epoch());
+
+    std::vector<uint8_t> header;
+    header.reserve(16);
+    putLittle32(header, static_cast<uint32_t>(since.count() / 1000000000));
+    putLittle32(header, static_cast<uint32_t>(since.count() % 1000000000));
+    putLittle32(header, static_cast<uint32_t>(packet.size()));
+    putLittle32(header, static_cast<uint32_t>(packet.size()));
+
+    _file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    _file.write(reinterpret_cast<const char *>(packet.data()), packet.size());
+    _packets++;
+}
+
+void PcapWriter::writeTcp(const PcapEndpoint &from, const PcapEndpoint &to,
+                          const std::vector<uint8_t> &frame, Clock::time_point now) {
+    if (_linkType != PcapLinkType::Raw)
+        throw std::logic_error("TCP frames require raw link type");
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Streams start at sequence number 1, as if SYN was seen
+    auto &sequence          = _sequences.try_emplace({from, to}, 1).first->second;
+    const auto acknowledged = _sequences.try_emplace({to, from}, 1).first->second;
+    const auto totalLength  = IpHeaderSize + TcpHeaderSize + frame.size();
+
+    std::vector<uint8_t> packet;
+    packet.reserve(totalLength);
+
+    putBig16(packet, 0x4500); // IPv4, 20 byte header, no TOS
+    putBig16(packet, static_cast<uint16_t>(totalLength));
+    putBig16(packet, _ipId++);
+    putBig16(packet, 0x4000); // Don't fragment
+    putBig16(packet, 0x4006); // TTL 64, TCP
+    putBig16(packet, 0);      // Checksum, filled below
+    putBig32(packet, from.address);
+    putBig32(packet, to.address);
+
+    const auto ipChecksum = foldChecksum(sumWords(packet.data(), IpHeaderSize));
+    packet[10]            = static_cast<uint8_t>(ipChecksum >> 8);
+    packet[11]            = static_cast<uint8_t>(ipChecksum);
+
+    putBig16(packet, from.port);
+    putBig16(packet, to.port);
+    putBig32(packet, sequence);
+    putBig32(packet, acknowledged);
+    putBig16(packet, 0x5018); // 20 byte header, PSH + ACK
+    putBig16(packet, 0xFFFF); // Window
+    putBig16(packet, 0);      // Checksum, filled below
+    putBig16(packet, 0);      // Urgent pointer
+    packet.insert(packet.end(), frame.begin(), frame.end());
+
+    // Checksum covers pseudo header (addresses, protocol, length) and segment
+    const auto segmentSize = TcpHeaderSize + frame.size();
+    uint32_t sum           = sumWords(packet.data() + 12, 8);
+    sum += 6 + static_cast<uint32_t>(segmentSize);
+    sum = sumWords(packet.data() + IpHeaderSize, segmentSize, sum);
+
+    const auto tcpChecksum    = foldChecksum(sum);
+    packet[IpHeaderSize + 16] = static_cast<uint8_t>(tcpChecksum >> 8);
+    packet[IpHeaderSize + 17] = static_cast<uint8_t>(tcpChecksum);
+
+    sequence += static_cast<uint32_t>(frame.size());
+    writeRecord(now, packet);
+}
+
+void PcapWriter::writeRtu(const std::vector<uint8_t> &frame, Clock::time_point now) {
+    if (_linkType != PcapLinkType::User0)
+        throw std::logic_error("RTU frames require user link type");
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    writeRecord(now, frame);
+}
+
+void PcapWriter::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _file.flush();
+}
+
+PcapReader::PcapReader(const std::string &path) : _file(path, std::ios::binary) {
+    if (!_file)
+        throw std::runtime_error("Cannot open capture file " + path);
+
+    uint8_t header[24];
+    if (!_file.read(reinterpret_cast<char *>(header), sizeof(header)))
+        throw std::runtime_error("Capture file " + path + " is too short");
+
+    const uint32_t magic = header[0] | header[1] << 8 | header[2] << 16 |
+                           static_cast<uint32_t>(header[3]) << 24;
+    const auto swap = [](uint32_t value) {
+        return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) |
+               (value << 24);
+    };
+
+    if (magic == MagicMicroseconds || magic == MagicNanoseconds) {
+        _swapped = false;
+    } else if (swap(magic) == MagicMicroseconds || swap(magic) == MagicNanoseconds) {
+        _swapped = true;
+    } else {
+        throw std::runtime_error(path + " is not a pcap file");
+    }
+
+    _nanoseconds = field(header) == MagicNanoseconds;
+    _linkType    = static_cast<PcapLinkType>(field(header + 20));
+
+    const auto snapLength = field(header + 16);
+    _snapLength = snapLength == 0 ? MaxSnapLength : std::min(snapLength, MaxSnapLength);
+}
+
+uint32_t PcapReader::field(const uint8_t *data) const {
+    if (_swapped)
+        return big32(data);
+    return data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+std::optional<PcapPacket> PcapReader::next() {
+    uint8_t header[16];
+    if (!_file.read(reinterpret_cast<char *>(header), sizeof(header)))
+        return std::nullopt;
+
+    const auto seconds  = field(header);
+    const auto fraction = field(header + 4);
+    const auto captured = field(header + 8);
+
+    const auto nanoseconds = _nanoseconds ? fraction : fraction * uint64_t(1000);
+    const auto since =
+        std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds);
+
+    PcapPacket packet;
+    packet.timestamp = PcapWriter::Clock::time_point(
+        std::chrono::duration_cast<PcapWriter::Clock::duration>(since));
+
+    // Length comes from the file, it must not drive the allocation
+    if (captured > _snapLength)
+        throw std::runtime_error("Capture record is longer than snapshot length");
+
+    packet.data.resize(captured);
+    if (!_file.read(reinterpret_cast<char *>(packet.data.data()), captured))
+        return std::nullopt;
+
+    return packet;
+}
+
+std::optional<PcapTcpSegment> PcapReader::tcpPayload(const std::vector<uint8_t> &packet) {
+    if (packet.size() < IpHeaderSize || (packet[0] >> 4) != 4 || packet[9] != 6)
+        return std::nullopt;
+
+    const std::size_t ipHeader = (packet[0] & 0x0F) * 4u;
+    const std::size_t total    = std::min<std::size_t>(big16(&packet[2]), packet.size());
+    if (ipHeader < IpHeaderSize || total < ipHeader + TcpHeaderSize)
+        return std::nullopt;
+
+    const auto *tcp             = packet.data() + ipHeader;
+    const std::size_t tcpHeader = (tcp[12] >> 4) * 4u;
+    if (tcpHeader < TcpHeaderSize || total < ipHeader + tcpHeader)
+        return std::nullopt;
+
+    PcapTcpSegment segment;
+    segment.from = {big32(&packet[12]), big16(tcp)};
+    segment.to   = {big32(&packet[16]), big16(tcp + 2)};
+    segment.payload.assign(packet.begin() + ipHeader + tcpHeader, packet.begin() + total);
+    return segment;
+}
@@ -0,0 +1,165 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "pollScheduler.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace MB;
+
+PollScheduler::JobId PollScheduler::add(Clock::duration period, Task task,
+                                        Clock::time_point now) {
+    if (period <= Clock::duration::zero())
+        throw std::invalid_argument("Poll period has to be positive");
+    if (!task)
+        throw std::invalid_argument("Poll task can not be empty");
+
+    auto shared = std::make_shared<const Task>(std::move(task));
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    const auto id       = _nextJobId++;
+    const auto deadline = now + phaseOf(period);
+    _jobs.emplace(id, Job{period, deadline, std::move(shared), 0});
+    _deadlines.push(Entry{deadline, id});
+
+    lock.unlock();
+    // New job may be more urgent than the one run() waits for
+    _changed.notify_all();
+    return id;
+}
+
+bool PollScheduler::remove(JobId job) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _jobs.erase(job) > 0;
+}
+
+std::size_t PollScheduler::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _jobs.size();
+}
+
+std::optional<PollScheduler::Clock::time_point> PollScheduler::nextDeadline() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    dropStaleEntries();
+    if (_deadlines.empty())
+        return std::nullopt;
+    return _deadlines.top().deadline;
+}
+
+std::size_t PollScheduler::overruns(JobId job) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _jobs.find(job);
+    return it != _jobs.end() ? it->second.overruns : 0;
+}
+
+std::size_t PollScheduler::overruns() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _overruns;
+}
+
+void PollScheduler::setOverrunHandler(OverrunHandler handler) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _overrunHandler = std::move(handler);
+}
+
+std::size_t PollScheduler::runDue(Clock::time_point now) {
+    std::size_t count = 0;
+
+    while (true) {
+        std::shared_ptr<const Task> task;
+        std::optional<Overrun> overrun;
+        OverrunHandler handler;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            dropStaleEntries();
+            if (_deadlines.empty() || _deadlines.top().deadline > now)
+                break;
+
+            const auto id = _deadlines.top().job;
+            _deadlines.pop();
+
+            auto &job           = _jobs.at(id);
+            const auto lateness = now - job.deadline;
+            const auto missed   = static_cast<std::size_t>(lateness / job.period);
+            if (missed > 0) {
+                job.overruns++;
+                _overruns++;
+                overrun = Overrun{id, missed, lateness};
+                handler = _overrunHandler;
+            }
+
+            // Next deadline is always on the original grid, so jobs do not drift
+            job.deadline += job.period * static_cast<Clock::duration::rep>(missed + 1);
+            _deadlines.push(Entry{job.deadline, id});
+            task = job.task;
+        }
+
+        if (overrun.has_value() && handler)
+            handler(*overrun);
+
+        (*task)();
+        count++;
+    }
+
+    return count;
+}
+
+void PollScheduler::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (!_stopped) {
+        dropStaleEntries();
+
+        if (_deadlines.empty()) {
+            _changed.wait(lock);
+            continue;
+        }
+
+        const auto deadline = _deadlines.top().deadline;
+        if (Clock::now() < deadline) {
+            _changed.wait_until(lock, deadline);
+            continue;
+        }
+
+        lock.unlock();
+        runDue(Clock::now());
+        lock.lock();
+    }
+
+    _stopped = false;
+}
+
+void PollScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _changed.notify_all();
+}
+
+PollScheduler::Clock::duration PollScheduler::phaseOf(Clock::duration period) {
+    // Golden ratio sequence spreads any number of jobs evenly over the period
+    constexpr double goldenRatioFraction = 0.6180339887498949;
+
+    const auto index    = _periodCounts[period.count()]++;
+    const auto fraction =
+        std::fmod(static_cast<double>(index) * goldenRatioFraction, 1.0);
+    return Clock::duration(static_cast<Clock::duration::rep>(
+        static_cast<double>(period.count()) * fraction));
+}
+
+void PollScheduler::dropStaleEntries() const {
+    while (!_deadlines.empty()) {
+        const auto &entry = _deadlines.top();
+        const auto it     = _jobs.find(entry.job);
+        if (it != _jobs.end() && it->second.deadline == entry.deadline)
+            return;
+        _deadlines.pop();
+    }
+}
@@ -0,0 +1,117 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "readPlanner.hpp"
+#include "registerBank.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+using namespace MB;
+
+namespace {
+bool isBitRead(utils::MBFunctionCode functionCode) {
+    return functionCode == utils::ReadDiscreteOutputCoils ||
+           functionCode == utils::ReadDiscreteInputContacts;
+}
+
+uint16_t maxReadCount(utils::MBFunctionCode functionCode) {
+    return isBitRead(functionCode) ? MaxReadBits : MaxReadRegisters;
+}
+} // namespace
+
+std::size_t ReadPlanner::add(uint8_t unitId, utils::MBFunctionCode functionCode,
+                             uint16_t address, uint16_t count) {
+    if (!utils::isStandardFunctionCode(functionCode) ||
+        utils::functionType(functionCode) != utils::Read)
+        throw ModbusException(utils::IllegalFunction, unitId, functionCode);
+
+    if (count == 0 || count > maxReadCount(functionCode) ||
+        static_cast<uint32_t>(address) + count > 0x10000)
+        throw ModbusException(utils::NumberOfRegistersInvalid, unitId, functionCode);
+
+    _tags.push_back(Tag{unitId, functionCode, address, count});
+    return _tags.size() - 1;
+}
+
+std::vector<ReadPlanner::Read> ReadPlanner::plan() const {
+    std::vector<std::size_t> order(_tags.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+        const auto &lhs = _tags[a];
+        const auto &rhs = _tags[b];
+        return std::tie(lhs.unitId, lhs.functionCode, lhs.address, a) <
+               std::tie(rhs.unitId, rhs.functionCode, rhs.address, b);
+    });
+
+    std::vector<Read> reads;
+
+    // Tags are sorted by address, so greedily extending the current request as
+    // long as the next tag fits gives the minimal number of requests
+    std::size_t first = 0;
+    while (first < order.size()) {
+        const auto &head = _tags[order[first]];
+        const auto gap   = isBitRead(head.functionCode) ? _maxBitGap : _maxRegisterGap;
+        const auto limit = maxReadCount(head.functionCode);
+
+        const uint32_t begin = head.address;
+        uint32_t end         = begin + head.count;
+
+        auto last = first + 1;
+        for (; last < order.size(); last++) {
+            const auto &tag = _tags[order[last]];
+            if (tag.unitId != head.unitId || tag.functionCode != head.functionCode)
+                break;
+
+            const uint32_t tagEnd = static_cast<uint32_t>(tag.address) + tag.count;
+            const auto newEnd     = std::max(end, tagEnd);
+            if (tag.address > end + gap || newEnd - begin > limit)
+                break;
+
+            end = newEnd;
+        }
+
+        Read read{ModbusRequest(head.unitId, head.functionCode,
+                                static_cast<uint16_t>(begin),
+                                static_cast<uint16_t>(end - begin)),
+                  {}};
+        read.slices.reserve(last - first);
+        for (auto i = first; i < last; i++) {
+            const auto &tag = _tags[order[i]];
+            read.slices.push_back(
+                Slice{order[i], static_cast<uint16_t>(tag.address - begin), tag.count});
+        }
+
+        reads.push_back(std::move(read));
+        first = last;
+    }
+
+    return reads;
+}
+
+std::vector<std::pair<std::size_t, std::vector<ModbusCell>>>
+ReadPlanner::split(const Read &read, const ModbusResponse &response) {
+    const auto &request = read.request;
+    if (response.slaveID() != request.slaveID() ||
+        response.functionCode() != request.functionCode())
+        throw ModbusException(utils::InvalidMessageID, response.slaveID(),
+                              response.functionCode());
+
+    // Coil responses are padded to full bytes, so there may be more values
+    const auto &values = response.registerValues();
+    if (values.size() < request.numberOfRegisters())
+        throw ModbusException(utils::NumberOfValuesInvalid, response.slaveID(),
+                              response.functionCode());
+
+    std::vector<std::pair<std::size_t, std::vector<ModbusCell>>> result;
+    result.reserve(read.slices.size());
+    for (const auto &slice : read.slices) {
+        const auto begin = values.begin() + slice.offset;
+        result.emplace_back(slice.tag,
+                            std::vector<ModbusCell>(begin, begin + slice.count));
+    }
+
+    return result;
+}
@@ -0,0 +1,79 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "registerBank.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace MB;
+
+std::variant<ModbusResponse, ModbusException>
+RegisterBank::handle(const ModbusRequest &request) {
+    return serveRequest(*this, request);
+}
+
+std::size_t RegisterBank::tableSize(utils::MBFunctionRegisters table) const {
+    switch (table) {
+    case utils::OutputCoils:
+        return _coils.size();
+    case utils::InputContacts:
+        return _discreteInputs.size();
+    case utils::HoldingRegisters:
+        return _holdingRegisters.size();
+    case utils::InputRegisters:
+        return _inputRegisters.size();
+    }
+    return 0;
+}
+
+std::vector<ModbusCell> RegisterBank::readCells(utils::MBFunctionRegisters table,
+                                                uint16_t address, uint16_t count) const {
+    std::vector<ModbusCell> cells(count);
+
+    switch (table) {
+    case utils::OutputCoils:
+    case utils::InputContacts: {
+        const auto &bits = table == utils::OutputCoils ? _coils : _discreteInputs;
+        for (std::size_t i = 0; i < count; i++) {
+            cells[i] = ModbusCell::initCoil(bits[address + i] != 0);
+        }
+        break;
+    }
+    case utils::HoldingRegisters:
+    case utils::InputRegisters: {
+        const auto &regs =
+            table == utils::HoldingRegisters ? _holdingRegisters : _inputRegisters;
+        for (std::size_t i = 0; i < count; i++) {
+            cells[i] = ModbusCell::initReg(regs[address + i]);
+        }
+        break;
+    }
+    }
+
+    return cells;
+}
+
+void RegisterBank::writeCells(utils::MBFunctionRegisters table, uint16_t address,
+                              const std::vector<ModbusCell> &values) {
+    switch (table) {
+    case utils::OutputCoils:
+    case utils::InputContacts: {
+        auto &bits = table == utils::OutputCoils ? _coils : _discreteInputs;
+        for (std::size_t i = 0; i < values.size(); i++) {
+            bits[address + i] = values[i].coil() ? 1 : 0;
+        }
+        break;
+    }
+    case utils::HoldingRegisters:
+    case utils::InputRegisters: {
+        auto &regs =
+            table == utils::HoldingRegisters ? _holdingRegisters : _inputRegisters;
+        for (std::size_t i = 0; i < values.size(); i++) {
+            regs[address + i] = values[i].reg();
+        }
+        break;
+    }
+    }
+}
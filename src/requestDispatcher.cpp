@@ -0,0 +1,32 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "requestDispatcher.hpp"
+
+using namespace MB;
+
+std::vector<uint8_t>
+RequestDispatcher::dispatchRaw(const std::vector<uint8_t> &request) const {
+    if (request.size() < 2) {
+        const uint8_t slaveId = request.empty() ? 0 : request[0];
+        return ModbusException(utils::IllegalDataValue, slaveId).toRaw();
+    }
+
+    const auto slaveId      = request[0];
+    const auto functionCode = static_cast<utils::MBFunctionCode>(request[1]);
+
+    if (const auto &rawHandler = _rawHandlers[functionCode])
+        return rawHandler(request);
+
+    if (!_handlers[functionCode])
+        return ModbusException(utils::IllegalFunction, slaveId, functionCode).toRaw();
+
+    try {
+        const auto result = dispatch(ModbusRequest::fromRaw(request));
+        return std::visit([](const auto &value) { return value.toRaw(); }, result);
+    } catch (const ModbusException &) {
+        // Either request could not be parsed or response could not be serialized
+        return ModbusException(utils::IllegalDataValue, slaveId, functionCode).toRaw();
+    }
+}
@@ -0,0 +1,183 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "responseCache.hpp"
+
+#include <algorithm>
+
+using namespace MB;
+
+namespace {
+bool isRead(utils::MBFunctionCode functionCode) {
+    switch (functionCode) {
+    case utils::ReadDiscreteOutputCoils:
+    case utils::ReadDiscreteInputContacts:
+    case utils::ReadAnalogOutputHoldingRegisters:
+    case utils::ReadAnalogInputRegisters:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Function code of the request at the start of the frame, 0 if there is none
+utils::MBFunctionCode functionOf(const std::vector<uint8_t> &request) {
+    return static_cast<utils::MBFunctionCode>(request.size() > 1 ? request[1] : 0);
+}
+
+bool overlaps(const ResponseCache::Key &key, utils::MBFunctionCode readCode,
+              uint16_t address, uint16_t count) {
+    const uint32_t begin    = address;
+    const uint32_t end      = begin + count;
+    const uint32_t keyBegin = key.address;
+    const uint32_t keyEnd   = keyBegin + key.count;
+
+    return key.functionCode == readCode && keyBegin < end && begin < keyEnd;
+}
+} // namespace
+
+std::optional<ResponseCache::Key>
+ResponseCache::keyOf(const std::vector<uint8_t> &request) {
+    if (request.size() != 6)
+        return std::nullopt;
+
+    const auto functionCode = static_cast<utils::MBFunctionCode>(request[1]);
+    if (!isRead(functionCode))
+        return std::nullopt;
+
+    const auto count = utils::bigEndianConv(&request[4]);
+    if (count == 0)
+        return std::nullopt;
+
+    return Key{request[0], functionCode, utils::bigEndianConv(&request[2]), count};
+}
+
+ResponseCache::ResponseCache() { _ttl.fill(Clock::duration::zero()); }
+
+void ResponseCache::setTtl(Clock::duration ttl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ttl.fill(ttl);
+}
+
+void ResponseCache::setTtl(uint8_t unitId, Clock::duration ttl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ttl[unitId] = ttl;
+}
+
+ResponseCache::Clock::duration ResponseCache::ttl(uint8_t unitId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _ttl[unitId];
+}
+
+std::optional<std::vector<uint8_t>> ResponseCache::lookup(const Key &key,
+                                                          Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto it = _entries.find(key);
+    if (it == _entries.end())
+        return std::nullopt;
+
+    if (it->second.expires <= now) {
+        _entries.erase(it);
+        return std::nullopt;
+    }
+
+    return it->second.response;
+}
+
+void ResponseCache::store(const Key &key, const std::vector<uint8_t> &response,
+                          Clock::time_point now) {
+    // Exception responses have highest bit of function code set
+    if (response.size() < 2 || (response[1] & 0x80) != 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto ttl = _ttl[key.unitId];
+    if (ttl <= Clock::duration::zero())
+        return;
+
+    _entries[key] = Entry{response, now + ttl};
+
+    // Expired entries are dropped lazily, purge them before the map grows too much
+    if (_entries.size() >= _nextPurge) {
+        purge(now);
+        _nextPurge = std::max(MinPurgeSize, _entries.size() * 2);
+    }
+}
+
+bool ResponseCache::affects(const std::vector<uint8_t> &request, const Key &key) {
+    if (request.empty())
+        return false;
+
+    // Broadcast (unit id 0) reaches every unit
+    const auto unitId = request[0];
+    if (unitId != 0 && key.unitId != unitId)
+        return false;
+
+    const auto functionCode = functionOf(request);
+    if (isRead(functionCode))
+        return false;
+
+    switch (functionCode) {
+    case utils::WriteSingleDiscreteOutputCoil:
+    case utils::WriteSingleAnalogOutputRegister:
+        if (request.size() < 4)
+            break;
+        return overlaps(key,
+                        functionCode == utils::WriteSingleDiscreteOutputCoil
+                            ? utils::ReadDiscreteOutputCoils
+                            : utils::ReadAnalogOutputHoldingRegisters,
+                        utils::bigEndianConv(&request[2]), 1);
+    case utils::WriteMultipleDiscreteOutputCoils:
+    case utils::WriteMultipleAnalogOutputHoldingRegisters:
+        if (request.size() < 6)
+            break;
+        return overlaps(key,
+                        functionCode == utils::WriteMultipleDiscreteOutputCoils
+                            ? utils::ReadDiscreteOutputCoils
+                            : utils::ReadAnalogOutputHoldingRegisters,
+                        utils::bigEndianConv(&request[2]),
+                        utils::bigEndianConv(&request[4]));
+    default:
+        break;
+    }
+
+    // Unknown or malformed request, it may have changed anything
+    return true;
+}
+
+void ResponseCache::invalidate(const std::vector<uint8_t> &request) {
+    // Reads do not change anything, no need to go through the entries
+    if (request.empty() || isRead(functionOf(request)))
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (affects(request, it->first))
+            it = _entries.erase(it);
+        else
+            it++;
+    }
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+}
+
+std::size_t ResponseCache::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+void ResponseCache::purge(Clock::time_point now) {
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->second.expires <= now)
+            it = _entries.erase(it);
+        else
+            it++;
+    }
+}
@@ -0,0 +1,77 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "rttEstimator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace MB;
+
+RttEstimator::RttEstimator(Duration initialTimeout, Duration minTimeout,
+                           Duration maxTimeout)
+    : _initialTimeout(initialTimeout), _minTimeout(minTimeout), _maxTimeout(maxTimeout) {
+    if (minTimeout <= Duration::zero() || minTimeout > maxTimeout)
+        throw std::invalid_argument("Invalid RTT estimator timeout bounds");
+
+    _initialTimeout = std::clamp(_initialTimeout, _minTimeout, _maxTimeout);
+}
+
+void RttEstimator::sample(uint8_t unitId, Duration rtt) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &unit = _units[unitId];
+
+    rtt = std::max(rtt, Duration::zero());
+
+    // Gains as in RFC 6298: alpha = 1/8, beta = 1/4
+    if (unit.samples == 0) {
+        unit.srtt   = rtt;
+        unit.rttvar = rtt / 2;
+    } else {
+        const auto error = unit.srtt > rtt ? unit.srtt - rtt : rtt - unit.srtt;
+        unit.rttvar      = (unit.rttvar * 3 + error) / 4;
+        unit.srtt        = (unit.srtt * 7 + rtt) / 8;
+    }
+
+    unit.samples++;
+    unit.timeouts = 0;
+}
+
+void RttEstimator::timedOut(uint8_t unitId) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _units[unitId].timeouts++;
+}
+
+RttEstimator::Duration RttEstimator::timeout(uint8_t unitId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return timeoutOf(_units[unitId]);
+}
+
+std::optional<RttEstimator::Estimate> RttEstimator::estimate(uint8_t unitId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto &unit = _units[unitId];
+
+    if (unit.samples == 0)
+        return std::nullopt;
+
+    return Estimate{unit.srtt, unit.rttvar, timeoutOf(unit), unit.samples,
+                    unit.timeouts};
+}
+
+void RttEstimator::reset(uint8_t unitId) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _units[unitId] = Unit();
+}
+
+RttEstimator::Duration RttEstimator::timeoutOf(const Unit &unit) const {
+    auto timeout = unit.samples == 0 ? _initialTimeout : unit.srtt + unit.rttvar * 4;
+    timeout      = std::clamp(timeout, _minTimeout, _maxTimeout);
+
+    // Exponential backoff, stops doubling once maximum is reached
+    for (std::size_t i = 0; i < unit.timeouts && timeout < _maxTimeout; i++) {
+        timeout *= 2;
+    }
+
+    return std::min(timeout, _maxTimeout);
+}
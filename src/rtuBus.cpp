@@ -0,0 +1,64 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "rtuBus.hpp"
+#include "rtuFramer.hpp"
+
+#include <algorithm>
+
+using namespace MB::RTU;
+
+BusSchedule::BusSchedule(unsigned int baudRate, Clock::time_point now)
+    : _baudRate(baudRate), _gap(Timing::forBaudRate(baudRate).interFrame), _freeAt(now),
+      _transactionStart(now), _transmitted(now), _statsStart(now) {}
+
+BusSchedule::Clock::duration BusSchedule::wireTime(std::size_t bytes) const {
+    // 11 bits per character
+    const auto nanoseconds = static_cast<uint64_t>(bytes) * 11u * 1'000'000'000u;
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::nanoseconds(nanoseconds / _baudRate));
+}
+
+void BusSchedule::sent(std::size_t size, bool broadcast, Clock::time_point now) {
+    _transactionStart = now;
+    _transmitted      = now + wireTime(size);
+    _stats.bytesSent += size;
+    _stats.wire += wireTime(size);
+
+    if (broadcast) {
+        _stats.broadcasts++;
+        _freeAt = _transmitted + std::max(_turnaround, _gap);
+        _stats.busy += _freeAt - now;
+    }
+}
+
+void BusSchedule::finished(std::size_t responseSize, bool exception,
+                           Clock::time_point now) {
+    _stats.transactions++;
+    if (exception)
+        _stats.exceptions++;
+    else if (responseSize == 0)
+        _stats.failures++;
+
+    _stats.bytesReceived += responseSize;
+    _stats.wire += wireTime(responseSize);
+
+    // Request may be still on the wire, if the transaction failed right away
+    _freeAt = std::max(now, _transmitted) + _gap;
+    _stats.busy += _freeAt - _transactionStart;
+}
+
+BusStats BusSchedule::stats(Clock::time_point now) const {
+    auto stats    = _stats;
+    stats.elapsed = now - _statsStart;
+    // Gap or turnaround that has not passed yet
+    if (_freeAt > now)
+        stats.busy -= std::min(_freeAt - now, stats.busy);
+    return stats;
+}
+
+void BusSchedule::resetStats(Clock::time_point now) {
+    _stats      = BusStats();
+    _statsStart = now;
+}
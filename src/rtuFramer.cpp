@@ -0,0 +1,225 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "rtuFramer.hpp"
+#include "crc.hpp"
+#include "modbusUtils.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace MB::RTU;
+
+namespace {
+// Whether frame may start with these bytes, used only when searching for
+// frames in noise
+bool plausibleStart(uint8_t unit, uint8_t function) {
+    return unit <= 247 && MB::utils::isStandardFunctionCode(function & 0x7F);
+}
+} // namespace
+
+std::size_t MB::RTU::expectedResponseSize(const ModbusRequest &request) {
+    // Unit id, function code and CRC
+    constexpr std::size_t overhead = 4;
+
+    switch (request.functionCode()) {
+    case utils::ReadDiscreteOutputCoils:
+    case utils::ReadDiscreteInputContacts:
+        // Byte count and bit packed values
+        return overhead + 1 + (request.numberOfRegisters() + 7u) / 8u;
+    case utils::ReadAnalogOutputHoldingRegisters:
+    case utils::ReadAnalogInputRegisters:
+        return overhead + 1 + 2u * request.numberOfRegisters();
+    case utils::WriteSingleDiscreteOutputCoil:
+    case utils::WriteSingleAnalogOutputRegister:
+    case utils::WriteMultipleDiscreteOutputCoils:
+    case utils::WriteMultipleAnalogOutputHoldingRegisters:
+        // Echo of address and value or count
+        return overhead + 4;
+    default:
+        throw std::runtime_error("Response size of the function code is not known");
+    }
+}
+
+Timing Timing::forBaudRate(unsigned int baudRate) {
+    if (baudRate == 0)
+        throw std::invalid_argument("Baud rate has to be positive");
+
+    if (baudRate > 19200)
+        return {std::chrono::microseconds(750), std::chrono::microseconds(1750)};
+
+    // 11 bits per character: start, 8 data, parity (or second stop) and stop
+    const auto character = 11'000'000.0 / baudRate;
+    return {std::chrono::microseconds(static_cast<long long>(character * 1.5 + 0.5)),
+            std::chrono::microseconds(static_cast<long long>(character * 3.5 + 0.5))};
+}
+
+Framer::Framer(const Timing &timing) : _timing(timing) { clear(); }
+
+void Framer::append(const uint8_t *data, std::size_t size, Clock::time_point now) {
+    if (size == 0)
+        return;
+
+    if (_size > 0) {
+        const auto gap = now - _lastByte;
+        if (gap >= frameGap() && !holding()) {
+            close();
+        } else if (gap > _timing.interCharacter) {
+            _late = true;
+            _lateCharacters++;
+        }
+    }
+    _lastByte = now;
+
+    for (std::size_t i = 0; i < size; i++) {
+        if (_size == MaxFrameSize) {
+            // No frame is that long, drop the oldest byte
+            _start = (_start + 1) % MaxFrameSize;
+            _size--;
+            _discardedBytes++;
+            _overflowed = true;
+        }
+
+        _ring[(_start + _size) % MaxFrameSize] = data[i];
+        _size++;
+        _crc = CRC::update(_crc, data[i]);
+
+        if (_overflowed || (_strict && _late) || _crc != 0)
+            continue;
+
+        // Expected response (or request, whose length is in its header) is
+        // complete, next bytes start another frame. Valid CRC alone would also
+        // match some prefixes of longer frames.
+        const bool exception = _size >= 2 && (at(1) & 0x80) != 0;
+        const auto size      = _expected == 0 ? requestSize()
+                               : exception    ? ExceptionResponseSize
+                                              : _expected;
+        if (_size == size) {
+            emit(0, _size);
+            clear();
+        }
+    }
+}
+
+std::size_t Framer::requestSize() const {
+    if (_size < 2 || at(0) > 247)
+        return 0;
+
+    switch (at(1)) {
+    case utils::ReadDiscreteOutputCoils:
+    case utils::ReadDiscreteInputContacts:
+    case utils::ReadAnalogOutputHoldingRegisters:
+    case utils::ReadAnalogInputRegisters:
+    case utils::WriteSingleDiscreteOutputCoil:
+    case utils::WriteSingleAnalogOutputRegister:
+        // Address and count or value
+        return 8;
+    case utils::WriteMultipleDiscreteOutputCoils:
+    case utils::WriteMultipleAnalogOutputHoldingRegisters:
+        // Address, count, byte count and values
+        return _size >= 7 ? 9u + at(6) : 0;
+    default:
+        return 0;
+    }
+}
+
+Framer::Clock::duration Framer::frameGap() const {
+    if (_strict)
+        return _timing.interFrame;
+    return std::max<Clock::duration>(_timing.interFrame, _minimumGap);
+}
+
+std::optional<std::vector<uint8_t>> Framer::next(Clock::time_point now) {
+    if (_frames.empty() && _size > 0 && !holding() && now - _lastByte >= frameGap())
+        close();
+
+    if (_frames.empty())
+        return std::nullopt;
+
+    auto frame = std::move(_frames.front());
+    _frames.pop_front();
+    return frame;
+}
+
+std::size_t Framer::remaining() const {
+    if (_expected == 0 || _overflowed)
+        return 0;
+
+    // Until function code is known, response may be an exception
+    std::size_t size = std::min(_expected, ExceptionResponseSize);
+    if (_size >= 2)
+        size = (at(1) & 0x80) != 0 ? ExceptionResponseSize : _expected;
+
+    return size > _size ? size - _size : 0;
+}
+
+std::optional<Framer::Clock::time_point> Framer::completesAt() const {
+    if (_size == 0 || holding())
+        return std::nullopt;
+    return _lastByte + frameGap();
+}
+
+void Framer::reset() {
+    _frames.clear();
+    clear();
+}
+
+void Framer::close() {
+    if (_strict && _late) {
+        _discardedBytes += _size;
+        clear();
+        return;
+    }
+
+    // Bytes between two silences are a single frame
+    if (!_overflowed && _size >= MinFrameSize && _crc == 0) {
+        emit(0, _size);
+        clear();
+        return;
+    }
+
+    // Otherwise search for the shortest valid frames, skipping the noise
+    std::size_t offset = 0;
+    while (_size - offset >= MinFrameSize) {
+        std::size_t end = 0;
+        if (plausibleStart(at(offset), at(offset + 1))) {
+            auto crc = CRC::Initial;
+            for (std::size_t i = offset; i < _size; i++) {
+                crc = CRC::update(crc, at(i));
+                if (i + 1 - offset >= MinFrameSize && crc == 0) {
+                    end = i + 1;
+                    break;
+                }
+            }
+        }
+
+        if (end == 0) {
+            offset++;
+            _discardedBytes++;
+            continue;
+        }
+
+        emit(offset, end - offset);
+        offset = end;
+    }
+
+    _discardedBytes += _size - offset;
+    clear();
+}
+
+void Framer::emit(std::size_t offset, std::size_t size) {
+    std::vector<uint8_t> frame(size);
+    for (std::size_t i = 0; i < size; i++) {
+        frame[i] = at(offset + i);
+    }
+    _frames.push_back(std::move(frame));
+}
+
+void Framer::clear() {
+    _start      = 0;
+    _size       = 0;
+    _crc        = CRC::Initial;
+    _overflowed = false;
+    _late       = false;
+}
@@ -0,0 +1,100 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "timerWheel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace MB;
+
+TimerWheel::TimerWheel(Clock::duration tick, std::size_t slots, Clock::time_point now)
+    : _tick(tick), _origin(now), _slots(slots) {
+    if (tick.count() <= 0)
+        throw std::invalid_argument("Tick of the timer wheel has to be positive");
+    if (slots == 0)
+        throw std::invalid_argument("Timer wheel needs at least one slot");
+}
+
+uint64_t TimerWheel::tickOf(Clock::time_point time) const {
+    if (time <= _origin)
+        return 0;
+
+    // Rounded up, so that timers never fire early
+    const auto since = time - _origin;
+    return static_cast<uint64_t>((since + _tick - Clock::duration(1)) / _tick);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(Clock::time_point at, Callback callback) {
+    const auto tick = std::max(tickOf(at), _current + 1);
+    const auto id   = _nextId++;
+
+    _timers.emplace(id, Timer{tick, std::move(callback)});
+    _slots[tick % _slots.size()].push_back(id);
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId timer) { return _timers.erase(timer) > 0; }
+
+std::size_t TimerWheel::advance(Clock::time_point now) {
+    if (now < _origin)
+        return 0;
+
+    const auto nowTick = static_cast<uint64_t>((now - _origin) / _tick);
+    if (nowTick <= _current)
+        return 0;
+
+    // After a long pause every slot is visited once
+    const auto steps  = std::min<uint64_t>(nowTick - _current, _slots.size());
+    const auto first  = nowTick - steps + 1;
+    std::size_t fired = 0;
+    // Timers scheduled by the callbacks are due after now
+    _current = nowTick;
+
+    for (auto tick = first; tick <= nowTick; tick++) {
+        // Callbacks may schedule to this slot
+        auto &slot = _slots[tick % _slots.size()];
+        auto ids   = std::move(slot);
+        slot.clear();
+
+        for (const auto id : ids) {
+            const auto timer = _timers.find(id);
+            if (timer == _timers.end())
+                continue;
+            // Later revolution
+            if (timer->second.tick > nowTick) {
+                slot.push_back(id);
+                continue;
+            }
+
+            auto callback = std::move(timer->second.callback);
+            _timers.erase(timer);
+            callback();
+            fired++;
+        }
+    }
+
+    return fired;
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::nextExpiry() const {
+    if (_timers.empty())
+        return std::nullopt;
+
+    // The first slot with a timer of the current revolution has the earliest one
+    for (uint64_t tick = _current + 1; tick <= _current + _slots.size(); tick++) {
+        for (const auto id : _slots[tick % _slots.size()]) {
+            const auto timer = _timers.find(id);
+            if (timer != _timers.end() && timer->second.tick == tick)
+                return _origin + _tick * static_cast<Clock::rep>(tick);
+        }
+    }
+
+    // All timers are further than one revolution
+    uint64_t earliest = UINT64_MAX;
+    for (const auto &[id, timer] : _timers) {
+        earliest = std::min(earliest, timer.tick);
+    }
+    return _origin + _tick * static_cast<Clock::rep>(earliest);
+}
@@ -0,0 +1,76 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "trace.hpp"
+
+#include <stdexcept>
+
+using namespace MB;
+
+std::atomic<TraceRing *> RingTracing::_ring{nullptr};
+
+TraceRing::TraceRing(std::size_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        throw std::invalid_argument("Trace ring capacity has to be a power of two");
+
+    _slots = std::make_unique<Slot[]>(capacity);
+    _mask  = capacity - 1;
+    for (std::size_t i = 0; i < capacity; i++) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+// Bounded queue with per slot sequence numbers (D. Vyukov): slot is free for
+// position `pos` when its sequence equals `pos`, and holds a record when it
+// equals `pos + 1`.
+bool TraceRing::tryPush(const TraceRecord &record) {
+    auto pos = _head.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    while (true) {
+        slot           = &_slots[pos & _mask];
+        const auto seq = slot->sequence.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+        if (diff == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+std::optional<TraceRecord> TraceRing::tryPop() {
+    auto pos = _tail.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    while (true) {
+        slot           = &_slots[pos & _mask];
+        const auto seq = slot->sequence.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+        if (diff == 0) {
+            if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return std::nullopt;
+        } else {
+            pos = _tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto record = slot->record;
+    slot->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return record;
+}
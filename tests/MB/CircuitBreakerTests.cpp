@@ -0,0 +1,98 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/circuitBreaker.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+const auto start = CircuitBreaker::Clock::time_point();
+}
+
+TEST(CircuitBreaker, OpensAfterConsecutiveFailures) {
+    CircuitBreaker breaker(3, 1s);
+
+    breaker.report(1, utils::Timeout, start);
+    breaker.report(1, utils::SlaveDeviceFailure, start);
+    // Any response resets the counter
+    breaker.report(1, utils::IllegalDataAddress, start);
+    EXPECT_EQ(0, breaker.failures(1));
+
+    breaker.report(1, utils::Timeout, start);
+    breaker.report(1, utils::Timeout, start);
+    EXPECT_EQ(CircuitBreaker::State::Closed, breaker.state(1));
+    EXPECT_TRUE(breaker.allow(1, start));
+
+    breaker.report(1, utils::Timeout, start);
+    EXPECT_EQ(CircuitBreaker::State::Open, breaker.state(1));
+    EXPECT_FALSE(breaker.allow(1, start + 999ms));
+    // Rejected requests are neither failures nor successes
+    breaker.report(1, utils::CircuitOpen, start);
+    EXPECT_EQ(3, breaker.failures(1));
+    // Other units are not affected
+    EXPECT_TRUE(breaker.allow(2, start));
+}
+
+TEST(CircuitBreaker, GarbageResponsesAreFailures) {
+    CircuitBreaker breaker(3, 1s);
+
+    // Unit answers, but never with a valid frame
+    breaker.report(1, utils::InvalidCRC, start);
+    breaker.report(1, utils::InvalidMessageID, start);
+    breaker.report(1, utils::InvalidByteOrder, start);
+    EXPECT_EQ(CircuitBreaker::State::Open, breaker.state(1));
+}
+
+TEST(CircuitBreaker, FailsFastWithDistinctCode) {
+    CircuitBreaker breaker(1, 1s);
+    breaker.failure(5, start);
+
+    try {
+        breaker.check(5, utils::ReadAnalogInputRegisters, start);
+        FAIL() << "Request to open device has to fail";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::CircuitOpen, ex.getErrorCode());
+        EXPECT_EQ(5, ex.slaveID());
+        EXPECT_FALSE(utils::isStandardErrorCode(ex.getErrorCode()));
+    }
+
+    // Broadcasts are never blocked
+    EXPECT_NO_THROW(breaker.check(0, utils::WriteSingleAnalogOutputRegister, start));
+}
+
+TEST(CircuitBreaker, HalfOpenProbe) {
+    CircuitBreaker breaker(1, 1s);
+    breaker.failure(1, start);
+
+    // Single probe after open time
+    EXPECT_TRUE(breaker.allow(1, start + 1s));
+    EXPECT_EQ(CircuitBreaker::State::HalfOpen, breaker.state(1));
+    EXPECT_FALSE(breaker.allow(1, start + 1s));
+
+    // Failed probe opens the breaker again
+    breaker.report(1, utils::Timeout, start + 1100ms);
+    EXPECT_EQ(CircuitBreaker::State::Open, breaker.state(1));
+    EXPECT_FALSE(breaker.allow(1, start + 2s));
+
+    // Successful probe closes it
+    EXPECT_TRUE(breaker.allow(1, start + 2100ms));
+    breaker.report(1, std::nullopt, start + 2200ms);
+    EXPECT_EQ(CircuitBreaker::State::Closed, breaker.state(1));
+    EXPECT_TRUE(breaker.allow(1, start + 2200ms));
+}
+
+TEST(CircuitBreaker, LostProbeIsRepeated) {
+    CircuitBreaker breaker(1, 1s);
+    breaker.failure(1, start);
+
+    EXPECT_TRUE(breaker.allow(1, start + 1s));
+    // Outcome never reported
+    EXPECT_FALSE(breaker.allow(1, start + 1500ms));
+    EXPECT_TRUE(breaker.allow(1, start + 2s));
+    EXPECT_THROW(CircuitBreaker(0), std::invalid_argument);
+}
@@ -0,0 +1,86 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/concurrentRegisterBank.hpp"
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+
+#include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace MB;
+
+TEST(ConcurrentRegisterBank, ReadWrite) {
+    ConcurrentRegisterBank bank(10, 10, 100, 100, 8);
+
+    bank.write(utils::HoldingRegisters, 6, {1, 2, 3, 4});
+    EXPECT_EQ(std::vector<uint16_t>({0, 1, 2, 3, 4, 0}),
+              bank.read(utils::HoldingRegisters, 5, 6));
+
+    EXPECT_THROW(bank.write(utils::InputRegisters, 99, {1, 2}), ModbusException);
+    EXPECT_THROW(auto _ = bank.read(utils::OutputCoils, 5, 6), ModbusException);
+}
+
+TEST(ConcurrentRegisterBank, Handle) {
+    ConcurrentRegisterBank bank(10, 10, 100, 100);
+
+    auto result = bank.handle(ModbusRequest(1, utils::WriteMultipleDiscreteOutputCoils, 2,
+                                            2,
+                                            {ModbusCell::initCoil(true),
+                                             ModbusCell::initCoil(true)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(std::vector<uint16_t>({0, 1, 1, 0}), bank.read(utils::OutputCoils, 1, 4));
+
+    result = bank.handle(ModbusRequest(1, utils::ReadDiscreteOutputCoils, 0, 4));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_TRUE(std::get<ModbusResponse>(result).registerValues()[2].coil());
+
+    result = bank.handle(ModbusRequest(1, utils::ReadAnalogInputRegisters, 90, 11));
+    ASSERT_TRUE(std::holds_alternative<ModbusException>(result));
+    EXPECT_EQ(utils::IllegalDataAddress,
+              std::get<ModbusException>(result).getErrorCode());
+}
+
+TEST(ConcurrentRegisterBank, SnapshotsAreNotTorn) {
+    constexpr std::size_t BLOCK = 125;
+    ConcurrentRegisterBank bank(0, 0, 256, 0, 16);
+    std::atomic<bool> done{false};
+
+    // Writer fills whole block (spanning many regions) with the same value
+    std::thread writer([&]() {
+        std::vector<uint16_t> values(BLOCK);
+        for (uint16_t i = 1; i < 20000; i++) {
+            std::fill(values.begin(), values.end(), i);
+            bank.write(utils::HoldingRegisters, 3, values);
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    std::atomic<int> torn{0};
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&]() {
+            std::vector<uint16_t> snapshot(BLOCK);
+            while (!done) {
+                bank.read(utils::HoldingRegisters, 3, BLOCK, snapshot.data());
+                for (auto value : snapshot) {
+                    if (value != snapshot[0])
+                        torn++;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, torn);
+    EXPECT_EQ(19999, bank.read(utils::HoldingRegisters, 3 + BLOCK - 1, 1)[0]);
+}
@@ -0,0 +1,261 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Gateway/gateway.hpp"
+#include "serialTestUtils.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <optional>
+#include <thread>
+
+using namespace MB;
+using namespace MB::Testing;
+using namespace std::chrono_literals;
+
+namespace {
+// Gateway in front of a slave serving units 1 and 2, unit 3 is routed to the
+// same line, but nobody answers it
+class GatewayTest : public SerialServer {
+  protected:
+    // Long enough for the requests of the test to queue up behind unit 3
+    static constexpr int SerialTimeout = 300;
+
+    // Port chosen by the system, so that tests do not race for it
+    Gateway::Gateway gateway{0};
+    std::thread running;
+
+    void SetUp() override {
+        SerialServer::SetUp();
+
+        auto connection = open(link.first());
+        connection.setTimeout(SerialTimeout);
+        gateway.addPort(std::move(connection), {1, 2, 3}, 115200);
+    }
+
+    void start() {
+        running = std::thread([this]() { gateway.run(); });
+    }
+
+    void TearDown() override {
+        gateway.stop();
+        if (running.joinable())
+            running.join();
+        SerialServer::TearDown();
+    }
+
+    TCP::Connection connect() {
+        auto connection = TCP::Connection::with("127.0.0.1", gateway.port());
+        connection.setTimeout(2000);
+        return connection;
+    }
+
+    // Responses the slave has sent on behalf of the unit
+    uint64_t answered(uint8_t unitId) const {
+        for (const auto &unit : metrics->snapshot().units) {
+            if (unit.unitId == unitId)
+                return unit.responsesSent;
+        }
+        return 0;
+    }
+
+    // Sends read to the silent unit 3 and waits until it occupies the bus
+    void occupyBus(TCP::Connection &client) {
+        (void)client.sendRequest(ModbusRequest(3, utils::ReadAnalogOutputHoldingRegisters,
+                                               0, 1));
+        while (gateway.queueStats(0, RequestPriority::Normal).served == 0) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+};
+
+// Error of the exception response, nullopt if the request succeeded
+std::optional<utils::MBErrorCode> errorOf(TCP::Connection &client,
+                                          uint16_t transactionId) {
+    try {
+        (void)client.awaitResponse(transactionId);
+    } catch (const ModbusException &ex) {
+        return ex.getErrorCode();
+    }
+    return std::nullopt;
+}
+} // namespace
+
+TEST_F(GatewayTest, RoutesByUnit) {
+    start();
+    auto client = connect();
+    client.setMessageId(0x1234);
+
+    (void)client.sendRequest(ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 2,
+                                           1, {ModbusCell::initReg(7)}));
+    EXPECT_EQ(0x1234, client.getMessageId());
+    (void)client.awaitResponse(0x1234);
+    (void)client.sendRequest(ModbusRequest(2, utils::WriteSingleAnalogOutputRegister, 2,
+                                           1, {ModbusCell::initReg(9)}));
+    (void)client.awaitResponse();
+
+    EXPECT_EQ(7, first.holdingRegisters()[2]);
+    EXPECT_EQ(9, second.holdingRegisters()[2]);
+
+    // Exception of the slave is forwarded as it is
+    (void)client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                                           20, 1));
+    EXPECT_EQ(utils::IllegalDataAddress, errorOf(client, client.getMessageId()));
+}
+
+TEST_F(GatewayTest, FailedPaths) {
+    start();
+    auto client = connect();
+
+    // No port serves unit 4
+    (void)client.sendRequest(ModbusRequest(4, utils::ReadAnalogOutputHoldingRegisters,
+                                           0, 1));
+    EXPECT_EQ(utils::GatewayPathUnavailable, errorOf(client, client.getMessageId()));
+
+    // Unit 3 does not answer
+    (void)client.sendRequest(ModbusRequest(3, utils::ReadAnalogOutputHoldingRegisters,
+                                           0, 1));
+    EXPECT_EQ(utils::GatewayTargetDeviceFailedToRespond,
+              errorOf(client, client.getMessageId()));
+
+    // Line is usable afterwards
+    first.holdingRegisters()[1] = 11;
+    (void)client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                                           1, 1));
+    EXPECT_EQ(11, client.awaitResponse().registerValues()[0].reg());
+}
+
+TEST_F(GatewayTest, PipelinedSessions) {
+    for (uint16_t i = 0; i < 10; i++) {
+        first.holdingRegisters()[i]  = 100 + i;
+        second.holdingRegisters()[i] = 200 + i;
+    }
+    start();
+
+    // Both clients use the same transaction ids
+    auto clientA = connect();
+    auto clientB = connect();
+    clientA.setMessageId(0x4321);
+    clientB.setMessageId(0x4321);
+
+    for (uint16_t address = 0; address < 3; address++) {
+        (void)clientA.sendRequest(
+            ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, address, 1));
+        (void)clientB.sendRequest(
+            ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters, address, 1));
+    }
+
+    // Awaited in reverse order, every response has to come with its own id
+    for (uint16_t address = 3; address-- > 0;) {
+        const auto id = static_cast<uint16_t>(0x4321 + address);
+        EXPECT_EQ(100 + address, clientA.awaitResponse(id).registerValues()[0].reg());
+        EXPECT_EQ(200 + address, clientB.awaitResponse(id).registerValues()[0].reg());
+    }
+}
+
+TEST_F(GatewayTest, TurnaroundAfterBroadcast) {
+    gateway.setTurnaround(0, 200ms);
+    start();
+    auto client = connect();
+
+    (void)client.sendRequest(ModbusRequest(0, utils::WriteSingleAnalogOutputRegister, 6,
+                                           1, {ModbusCell::initReg(66)}));
+    const auto broadcast = std::chrono::steady_clock::now();
+    (void)client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                                           6, 1));
+
+    // Read waits until the slaves are done with the broadcast
+    EXPECT_EQ(66, client.awaitResponse().registerValues()[0].reg());
+    EXPECT_GE(std::chrono::steady_clock::now() - broadcast, 200ms);
+}
+
+TEST_F(GatewayTest, CoalescesReads) {
+    first.holdingRegisters()[4] = 44;
+    start();
+    auto clientA = connect();
+    auto clientB = connect();
+
+    // Both reads wait behind unit 3, only one of them reaches the slave
+    occupyBus(clientA);
+    const auto read = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 4, 1);
+    (void)clientA.sendRequest(read);
+    (void)clientB.sendRequest(read);
+
+    EXPECT_EQ(44, clientA.awaitResponse().registerValues()[0].reg());
+    EXPECT_EQ(44, clientB.awaitResponse().registerValues()[0].reg());
+    EXPECT_EQ(1, answered(1));
+}
+
+TEST_F(GatewayTest, WritesDetachReadsInFlight) {
+    start();
+    auto clientA = connect();
+    auto clientB = connect();
+
+    // Read of unit 3 stays on the bus until it times out, read sent after the
+    // write must not share its response
+    occupyBus(clientA);
+    (void)clientB.sendRequest(ModbusRequest(3, utils::WriteSingleAnalogOutputRegister, 0,
+                                            1, {ModbusCell::initReg(1)}));
+    (void)clientB.sendRequest(ModbusRequest(3, utils::ReadAnalogOutputHoldingRegisters,
+                                            0, 1));
+
+    EXPECT_EQ(utils::GatewayTargetDeviceFailedToRespond,
+              errorOf(clientA, clientA.getMessageId()));
+    EXPECT_EQ(utils::GatewayTargetDeviceFailedToRespond,
+              errorOf(clientB, clientB.getMessageId()));
+    EXPECT_EQ(1, gateway.queueStats(0, RequestPriority::High).served);
+    EXPECT_EQ(2, gateway.queueStats(0, RequestPriority::Normal).served);
+}
+
+TEST_F(GatewayTest, WritesInvalidateCache) {
+    gateway.setCacheTtl(10s);
+    first.holdingRegisters()[4] = 44;
+    start();
+    auto client = connect();
+
+    const auto read = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 3, 2);
+    for (int i = 0; i < 2; i++) {
+        (void)client.sendRequest(read);
+        EXPECT_EQ(44, client.awaitResponse().registerValues()[1].reg());
+    }
+    EXPECT_EQ(1, answered(1));
+
+    (void)client.sendRequest(ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 4,
+                                           1, {ModbusCell::initReg(45)}));
+    (void)client.awaitResponse();
+
+    (void)client.sendRequest(read);
+    EXPECT_EQ(45, client.awaitResponse().registerValues()[1].reg());
+    EXPECT_EQ(3, answered(1));
+}
+
+TEST_F(GatewayTest, Priorities) {
+    gateway.setReadPriority(2, RequestPriority::Urgent);
+    start();
+    auto client = connect();
+
+    occupyBus(client);
+    // Normal read of unit 1 goes after the write sent later
+    (void)client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters,
+                                           5, 1));
+    const auto normal = client.getMessageId();
+    (void)client.sendRequest(ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 5,
+                                           1, {ModbusCell::initReg(42)}));
+    // Urgent read of unit 2 goes before the write sent earlier
+    (void)client.sendRequest(ModbusRequest(2, utils::WriteSingleAnalogOutputRegister, 5,
+                                           1, {ModbusCell::initReg(43)}));
+    (void)client.sendRequest(ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters,
+                                           5, 1));
+    const auto urgent = client.getMessageId();
+
+    EXPECT_EQ(0, client.awaitResponse(urgent).registerValues()[0].reg());
+    EXPECT_EQ(42, client.awaitResponse(normal).registerValues()[0].reg());
+    EXPECT_EQ(43, second.holdingRegisters()[5]);
+
+    EXPECT_EQ(1, gateway.queueStats(0, RequestPriority::Urgent).served);
+    EXPECT_EQ(2, gateway.queueStats(0, RequestPriority::High).served);
+    const auto normalStats = gateway.queueStats(0, RequestPriority::Normal);
+    EXPECT_EQ(2, normalStats.served);
+    EXPECT_EQ(0, normalStats.waiting);
+}
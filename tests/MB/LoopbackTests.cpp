@@ -0,0 +1,169 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Loopback/connection.hpp"
+#include "MB/registerBank.hpp"
+#include "MB/spscQueue.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+#include <variant>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+// Serves requests from the bank until the client stops sending them
+std::thread serveBank(Loopback::Connection &server, RegisterBank &bank) {
+    return std::thread([&server, &bank]() {
+        server.setTimeout(300);
+        try {
+            while (true) {
+                const auto request = server.awaitRequest();
+                const auto result  = bank.handle(request);
+                if (const auto *response = std::get_if<ModbusResponse>(&result))
+                    server.sendResponse(*response);
+                else
+                    server.sendException(std::get<ModbusException>(result));
+            }
+        } catch (const ModbusException &) {
+        }
+    });
+}
+} // namespace
+
+TEST(Loopback, SpscQueue) {
+    EXPECT_THROW(SpscQueue<int>(3), std::invalid_argument);
+
+    SpscQueue<int> queue(2);
+    EXPECT_EQ(nullptr, queue.front());
+    EXPECT_TRUE(queue.tryPush(1));
+    EXPECT_TRUE(queue.tryPush(2));
+    EXPECT_FALSE(queue.tryPush(3));
+    EXPECT_EQ(1, *queue.tryPop());
+    EXPECT_TRUE(queue.tryPush(3));
+    EXPECT_EQ(2, *queue.tryPop());
+    EXPECT_EQ(3, *queue.tryPop());
+    EXPECT_FALSE(queue.tryPop().has_value());
+
+    // Items arrive in order across threads
+    constexpr int items = 100000;
+    SpscQueue<int> shared(64);
+    std::thread producer([&shared]() {
+        for (int i = 0; i < items; i++) {
+            while (!shared.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (int expected = 0; expected < items;) {
+        if (auto item = shared.tryPop()) {
+            ASSERT_EQ(expected, *item);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(Loopback, RequestResponseExchange) {
+    auto [client, server] = Loopback::Connection::pair();
+    RegisterBank bank(0, 0, 16, 0);
+    auto serving = serveBank(server, bank);
+
+    const std::vector<ModbusCell> values = {ModbusCell::initReg(10),
+                                            ModbusCell::initReg(20)};
+    client.sendRequest(
+        ModbusRequest(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 2, 2, values));
+    (void)client.awaitResponse();
+
+    client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 2));
+    const auto response = client.awaitResponse();
+    ASSERT_EQ(2, response.registerValues().size());
+    EXPECT_EQ(10, response.registerValues()[0].reg());
+    EXPECT_EQ(20, response.registerValues()[1].reg());
+
+    // Exception responses are thrown, as with TCP::Connection
+    client.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 15, 2));
+    try {
+        (void)client.awaitResponse();
+        FAIL() << "Exception response expected";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::IllegalDataAddress, ex.getErrorCode());
+    }
+
+    serving.join();
+}
+
+TEST(Loopback, SplitFramesAndLatency) {
+    Loopback::Profile profile;
+    profile.latency    = 5ms;
+    profile.jitter     = 2ms;
+    profile.maxSegment = 3;
+
+    auto [client, server] = Loopback::Connection::pair(profile, profile);
+    RegisterBank bank(0, 0, 0, 200);
+    auto serving = serveBank(server, bank);
+
+    for (int i = 0; i < 5; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 100));
+        const auto response = client.awaitResponse();
+
+        EXPECT_EQ(100, response.registerValues().size());
+        // Both directions are delayed
+        EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+    }
+
+    serving.join();
+}
+
+TEST(Loopback, LossCausesTimeout) {
+    Loopback::Profile lossy;
+    lossy.loss = 1;
+
+    auto [client, server] = Loopback::Connection::pair(lossy);
+    client.setTimeout(20);
+    server.setTimeout(20);
+
+    const auto sent =
+        client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1));
+    EXPECT_EQ(12, sent.size());
+
+    try {
+        (void)server.awaitRequest();
+        FAIL() << "Lost frame should not arrive";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::Timeout, ex.getErrorCode());
+    }
+
+    try {
+        (void)client.awaitResponse();
+        FAIL() << "Timeout expected";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::Timeout, ex.getErrorCode());
+    }
+}
+
+TEST(Loopback, StaleResponsesAreSkipped) {
+    auto [client, server] = Loopback::Connection::pair();
+    client.setTimeout(20);
+
+    // First response is late, so the client gives up on it
+    client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1));
+    EXPECT_THROW((void)client.awaitResponse(), ModbusException);
+    (void)server.awaitRequest();
+    server.sendResponse(ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 1,
+                                       {ModbusCell::initReg(1)}));
+
+    client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1));
+    (void)server.awaitRequest();
+    server.sendResponse(ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 1,
+                                       {ModbusCell::initReg(2)}));
+
+    EXPECT_EQ(2, client.awaitResponse().registerValues()[0].reg());
+}
@@ -0,0 +1,58 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/mbap.hpp"
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace MB;
+
+TEST(MBAP, WrapAndParse) {
+    const auto raw   = ModbusRequest(0x11, utils::ReadAnalogInputRegisters, 8, 1).toRaw();
+    const auto frame = MBAP::wrap(0x0102, raw);
+
+    ASSERT_EQ(raw.size() + 6, frame.size());
+    EXPECT_EQ(std::vector<uint8_t>({0x01, 0x02, 0x00, 0x00, 0x00, 0x06, 0x11}),
+              std::vector<uint8_t>(frame.begin(), frame.begin() + MBAP::HeaderSize));
+
+    const auto header = MBAP::parseHeader(frame.data());
+    EXPECT_EQ(0x0102, header.transactionId);
+    EXPECT_EQ(0, header.protocolId);
+    EXPECT_EQ(6, header.length);
+    EXPECT_EQ(0x11, header.unitId);
+}
+
+TEST(MBAP, Deframer) {
+    const auto first  = MBAP::wrap(1, {0x01, 0x03, 0x00, 0x00, 0x00, 0x02});
+    const auto second = MBAP::wrap(2, {0x02, 0x04, 0x00, 0x10, 0x00, 0x01});
+
+    std::vector<uint8_t> stream(first);
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    MBAP::Deframer deframer;
+
+    // Partial frame
+    deframer.append(stream.data(), 5);
+    EXPECT_FALSE(deframer.next().has_value());
+
+    // Rest of the first frame and beginning of the second one
+    deframer.append(stream.data() + 5, first.size());
+    auto frame = deframer.next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(first, *frame);
+    EXPECT_FALSE(deframer.next().has_value());
+
+    deframer.append(stream.data() + 5 + first.size(), second.size() - 5);
+    frame = deframer.next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(second, *frame);
+    EXPECT_EQ(0, deframer.buffered());
+
+    // Garbage in length field cannot be recovered from
+    deframer.append({0x00, 0x01, 0x00, 0x00, 0xFF, 0xFF});
+    EXPECT_THROW(auto _ = deframer.next(), ModbusException);
+}
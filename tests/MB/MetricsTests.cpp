@@ -0,0 +1,175 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/metrics.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+TEST(Metrics, BucketBounds) {
+    // Small values are exact
+    for (uint64_t value = 0; value < LatencyHistogram::SubBuckets; value++) {
+        EXPECT_EQ(value, LatencyHistogram::bucketOf(value));
+    }
+
+    for (uint64_t value : {16ull, 17ull, 31ull, 32ull, 1000ull, 123456ull, 1ull << 30}) {
+        const auto bucket = LatencyHistogram::bucketOf(value);
+        EXPECT_LE(LatencyHistogram::bucketLowest(bucket), value);
+        EXPECT_GE(LatencyHistogram::bucketHighest(bucket), value);
+        // Relative width of the bucket is below 1/16
+        const auto width = LatencyHistogram::bucketHighest(bucket) -
+                           LatencyHistogram::bucketLowest(bucket) + 1;
+        EXPECT_LE(width * LatencyHistogram::SubBuckets, value);
+    }
+
+    // Buckets are contiguous
+    for (std::size_t bucket = 1; bucket < LatencyHistogram::BucketCount; bucket++) {
+        EXPECT_EQ(LatencyHistogram::bucketHighest(bucket - 1) + 1,
+                  LatencyHistogram::bucketLowest(bucket));
+    }
+
+    // Huge values are clamped to the last bucket
+    EXPECT_EQ(LatencyHistogram::BucketCount - 1, LatencyHistogram::bucketOf(UINT64_MAX));
+}
+
+TEST(Metrics, Percentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0us, histogram.snapshot().percentile(0.99));
+
+    for (int i = 1; i <= 1000; i++) {
+        histogram.record(std::chrono::microseconds(i * 10));
+    }
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(1000, snapshot.count);
+    EXPECT_EQ(10us, snapshot.min);
+    EXPECT_EQ(10000us, snapshot.max);
+    EXPECT_EQ(5005us, snapshot.mean());
+
+    const auto expectNear = [&](double quantile, int64_t expected) {
+        const auto value = snapshot.percentile(quantile).count();
+        EXPECT_GE(value, expected);
+        EXPECT_LE(value, expected + expected / 16);
+    };
+    expectNear(0.5, 5000);
+    expectNear(0.99, 9900);
+    expectNear(0.999, 9990);
+    EXPECT_EQ(10000us, snapshot.percentile(1.0));
+    EXPECT_EQ(10us, snapshot.percentile(0.0));
+}
+
+TEST(Metrics, Counters) {
+    Metrics metrics;
+
+    metrics.requestSent(1, 8);
+    metrics.bytesReceived(7);
+    metrics.responseReceived(1, 2ms);
+
+    metrics.requestSent(1, 8);
+    metrics.error(1, utils::Timeout);
+
+    metrics.requestSent(2, 8);
+    metrics.bytesReceived(5);
+    metrics.responseReceived(2, 3ms);
+    metrics.error(2, utils::IllegalDataAddress);
+
+    metrics.error(2, utils::InvalidCRC);
+    metrics.error(2, utils::InvalidMessageID);
+    metrics.error(2, utils::ProtocolError);
+
+    // Slave answering as unit 3 sends no requests
+    metrics.bytesReceived(8);
+    metrics.requestReceived(3);
+    metrics.responseSent(3, 9);
+    // Neither request nor response
+    metrics.frameSent(4);
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(20, snapshot.bytesIn);
+    EXPECT_EQ(37, snapshot.bytesOut);
+    EXPECT_EQ(3, snapshot.framesIn);
+    EXPECT_EQ(5, snapshot.framesOut);
+
+    // Only used units are reported
+    ASSERT_EQ(3, snapshot.units.size());
+    EXPECT_EQ(0, snapshot.units[2].requests);
+    EXPECT_EQ(1, snapshot.units[2].requestsReceived);
+    EXPECT_EQ(1, snapshot.units[2].responsesSent);
+
+    const auto &first = snapshot.units[0];
+    EXPECT_EQ(1, first.unitId);
+    EXPECT_EQ(2, first.requests);
+    EXPECT_EQ(1, first.responses);
+    EXPECT_EQ(1, first.timeouts);
+    EXPECT_EQ(1, first.latency.count);
+    EXPECT_EQ(2ms, first.latency.max);
+
+    const auto &second = snapshot.units[1];
+    EXPECT_EQ(2, second.unitId);
+    EXPECT_EQ(1, second.exceptions[utils::IllegalDataAddress]);
+    EXPECT_EQ(1, second.crcErrors);
+    EXPECT_EQ(1, second.invalidMessageIds);
+    EXPECT_EQ(1, second.otherErrors);
+    EXPECT_EQ(0, second.timeouts);
+}
+
+TEST(Metrics, ConcurrentUpdates) {
+    Metrics metrics;
+    constexpr int threads    = 4;
+    constexpr int iterations = 10000;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&metrics, t]() {
+            for (int i = 0; i < iterations; i++) {
+                metrics.requestSent(static_cast<uint8_t>(i % 8), 8);
+                metrics.responseReceived(static_cast<uint8_t>(i % 8),
+                                         std::chrono::microseconds(t * 100 + i % 100));
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    const auto snapshot = metrics.snapshot();
+    EXPECT_EQ(threads * iterations, snapshot.framesOut);
+    EXPECT_EQ(threads * iterations * 8, snapshot.bytesOut);
+    ASSERT_EQ(8, snapshot.units.size());
+
+    uint64_t responses = 0;
+    for (const auto &unit : snapshot.units) {
+        EXPECT_EQ(unit.responses, unit.latency.count);
+        responses += unit.responses;
+    }
+    EXPECT_EQ(threads * iterations, responses);
+}
+
+TEST(Metrics, Prometheus) {
+    Metrics metrics;
+    metrics.requestSent(3, 12);
+    metrics.responseReceived(3, 1500us);
+    metrics.error(3, utils::IllegalFunction);
+
+    const auto text = toPrometheus({{"plc\"1", metrics.snapshot()}});
+
+    EXPECT_NE(std::string::npos, text.find("# TYPE modbus_requests_total counter\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("modbus_bytes_out_total{connection=\"plc\\\"1\"} 12\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("modbus_requests_total{connection=\"plc\\\"1\",unit=\"3\"} 1\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("modbus_exceptions_total{connection=\"plc\\\"1\",unit=\"3\","
+                        "code=\"1\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE modbus_latency_seconds summary\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("modbus_latency_seconds_count{connection=\"plc\\\"1\","
+                        "unit=\"3\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("quantile=\"0.99\"} 0.0015\n"));
+}
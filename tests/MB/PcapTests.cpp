@@ -0,0 +1,146 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/pcap.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+std::string temporaryPath(const std::string &name) {
+    return ::testing::TempDir() + "modbus_" + name + ".pcap";
+}
+
+// Internet checksum of a header that contains its own checksum is 0
+uint16_t checksum(const uint8_t *data, std::size_t size, uint32_t sum = 0) {
+    for (std::size_t i = 0; i + 1 < size; i += 2) {
+        sum += static_cast<uint32_t>(data[i] << 8 | data[i + 1]);
+    }
+    if (size % 2 == 1)
+        sum += static_cast<uint32_t>(data[size - 1]) << 8;
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+} // namespace
+
+TEST(Pcap, TcpRoundTrip) {
+    const auto path = temporaryPath("tcp");
+    const PcapEndpoint client{0x7F000001, 40000};
+    const PcapEndpoint server{0x7F000002, 502};
+    const PcapWriter::Clock::time_point start(1700000000s + 123456789ns);
+
+    const std::vector<uint8_t> request  = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06,
+                                           0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+    const std::vector<uint8_t> response = {0x00, 0x01, 0x00, 0x00, 0x00, 0x05,
+                                           0x01, 0x03, 0x02, 0x12, 0x34};
+    {
+        PcapWriter writer(path, PcapLinkType::Raw);
+        EXPECT_THROW(writer.writeRtu(request), std::logic_error);
+
+        writer.writeTcp(client, server, request, start);
+        writer.writeTcp(server, client, response, start + 1500us);
+        writer.writeTcp(client, server, request, start + 2ms);
+        EXPECT_EQ(3, writer.packets());
+    }
+
+    PcapReader reader(path);
+    EXPECT_EQ(PcapLinkType::Raw, reader.linkType());
+
+    const auto first = reader.next();
+    ASSERT_TRUE(first.has_value());
+    // Nanosecond resolution is kept
+    EXPECT_EQ(start, first->timestamp);
+    EXPECT_EQ(0, checksum(first->data.data(), 20));
+
+    // TCP checksum over pseudo header and segment
+    const auto segmentSize = first->data.size() - 20;
+    uint32_t pseudo        = 6 + static_cast<uint32_t>(segmentSize);
+    for (std::size_t i = 12; i < 20; i += 2) {
+        pseudo += static_cast<uint32_t>(first->data[i] << 8 | first->data[i + 1]);
+    }
+    EXPECT_EQ(0, checksum(first->data.data() + 20, segmentSize, pseudo));
+
+    const auto segment = PcapReader::tcpPayload(first->data);
+    ASSERT_TRUE(segment.has_value());
+    EXPECT_EQ(client, segment->from);
+    EXPECT_EQ(server, segment->to);
+    EXPECT_EQ(request, segment->payload);
+
+    const auto second = reader.next();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(start + 1500us, second->timestamp);
+    EXPECT_EQ(response, PcapReader::tcpPayload(second->data)->payload);
+
+    // Sequence number advances by payload, acknowledgement follows other side
+    const auto third = reader.next();
+    ASSERT_TRUE(third.has_value());
+    const auto *tcp          = third->data.data() + 20;
+    const uint32_t sequence  = tcp[4] << 24 | tcp[5] << 16 | tcp[6] << 8 | tcp[7];
+    const uint32_t ackNumber = tcp[8] << 24 | tcp[9] << 16 | tcp[10] << 8 | tcp[11];
+    EXPECT_EQ(1 + request.size(), sequence);
+    EXPECT_EQ(1 + response.size(), ackNumber);
+
+    EXPECT_FALSE(reader.next().has_value());
+    std::remove(path.c_str());
+}
+
+TEST(Pcap, RtuRoundTrip) {
+    const auto path = temporaryPath("rtu");
+    const std::vector<uint8_t> frame = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0A};
+
+    {
+        PcapWriter writer(path, PcapLinkType::User0);
+        EXPECT_THROW(writer.writeTcp({}, {}, frame), std::logic_error);
+        writer.writeRtu(frame);
+    }
+
+    PcapReader reader(path);
+    EXPECT_EQ(PcapLinkType::User0, reader.linkType());
+
+    const auto packet = reader.next();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(frame, packet->data);
+    EXPECT_FALSE(PcapReader::tcpPayload(packet->data).has_value());
+    EXPECT_FALSE(reader.next().has_value());
+    std::remove(path.c_str());
+}
+
+TEST(Pcap, RejectsOversizedRecord) {
+    const auto path = temporaryPath("oversized");
+    {
+        PcapWriter writer(path, PcapLinkType::User0);
+        writer.writeRtu({0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0A});
+    }
+    {
+        // Captured length of the first record, just after the file header
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(24 + 8);
+        const char captured[4] = {0x00, 0x00, 0x00, 0x7F};
+        file.write(captured, sizeof(captured));
+    }
+
+    PcapReader reader(path);
+    EXPECT_THROW(reader.next(), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(Pcap, RejectsOtherFiles) {
+    const auto path = temporaryPath("invalid");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "This is not a capture file";
+    }
+
+    EXPECT_THROW(PcapReader{path}, std::runtime_error);
+    EXPECT_THROW(PcapReader{temporaryPath("missing")}, std::runtime_error);
+    std::remove(path.c_str());
+}
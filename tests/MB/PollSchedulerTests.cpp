@@ -0,0 +1,126 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/pollScheduler.hpp"
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+const auto start = PollScheduler::Clock::time_point();
+}
+
+TEST(PollScheduler, SpreadsJobsOverPeriod) {
+    PollScheduler scheduler;
+
+    for (int i = 0; i < 8; i++) {
+        scheduler.add(100ms, []() {}, start);
+    }
+
+    // Every job runs once in the first period, without bunching up
+    std::vector<int> counts(10, 0);
+    PollScheduler::Clock::time_point now = start;
+    while (now < start + 100ms) {
+        const auto run = scheduler.runDue(now);
+        counts[(now - start) / 10ms] += static_cast<int>(run);
+        now += 1ms;
+    }
+
+    EXPECT_EQ(8, std::accumulate(counts.begin(), counts.end(), 0));
+    EXPECT_LE(*std::max_element(counts.begin(), counts.end()), 2);
+}
+
+TEST(PollScheduler, RunsInDeadlineOrderWithoutDrift) {
+    PollScheduler scheduler;
+
+    std::vector<char> order;
+    scheduler.add(30ms, [&]() { order.push_back('a'); }, start);
+    scheduler.add(20ms, [&]() { order.push_back('b'); }, start);
+
+    // First jobs of every period start immediately
+    EXPECT_EQ(2, scheduler.runDue(start));
+    // Runs are late, but next deadlines stay on the original grid
+    EXPECT_EQ(1, scheduler.runDue(start + 25ms));
+    EXPECT_EQ(1, scheduler.runDue(start + 35ms));
+    EXPECT_EQ(1, scheduler.runDue(start + 40ms));
+    EXPECT_EQ(0, scheduler.runDue(start + 59ms));
+    EXPECT_EQ(2, scheduler.runDue(start + 60ms));
+
+    EXPECT_EQ(std::vector<char>({'a', 'b', 'b', 'a', 'b', 'a', 'b'}), order);
+    EXPECT_EQ(0, scheduler.overruns());
+}
+
+TEST(PollScheduler, ReportsOverruns) {
+    PollScheduler scheduler;
+
+    std::vector<PollScheduler::Overrun> overruns;
+    scheduler.setOverrunHandler(
+        [&](const PollScheduler::Overrun &overrun) { overruns.push_back(overrun); });
+
+    int runs      = 0;
+    const auto id = scheduler.add(10ms, [&]() { runs++; }, start);
+
+    EXPECT_EQ(1, scheduler.runDue(start + 35ms));
+    // Missed runs are skipped
+    EXPECT_EQ(start + 40ms, scheduler.nextDeadline());
+
+    ASSERT_EQ(1, overruns.size());
+    EXPECT_EQ(id, overruns[0].job);
+    EXPECT_EQ(3, overruns[0].missed);
+    EXPECT_EQ(35ms, overruns[0].lateness);
+    EXPECT_EQ(1, scheduler.overruns(id));
+    EXPECT_EQ(1, runs);
+}
+
+TEST(PollScheduler, RemoveJob) {
+    PollScheduler scheduler;
+
+    int runs       = 0;
+    const auto id  = scheduler.add(10ms, [&]() { runs++; }, start);
+    const auto id2 = scheduler.add(10ms, [&]() { scheduler.remove(id); }, start);
+
+    scheduler.runDue(start + 9ms);
+    EXPECT_EQ(1, runs);
+    EXPECT_EQ(1, scheduler.size());
+    EXPECT_TRUE(scheduler.remove(id2));
+    EXPECT_FALSE(scheduler.remove(id2));
+    EXPECT_FALSE(scheduler.nextDeadline().has_value());
+    EXPECT_THROW(scheduler.add(0ms, []() {}), std::invalid_argument);
+}
+
+TEST(PollScheduler, ManyJobs) {
+    PollScheduler scheduler;
+
+    std::size_t runs = 0;
+    for (int i = 0; i < 100000; i++) {
+        scheduler.add(1s, [&]() { runs++; }, start);
+    }
+
+    // Phases are spread over the whole first period
+    const auto lastTick = start + 1s - PollScheduler::Clock::duration(1);
+    EXPECT_EQ(100000, scheduler.runDue(lastTick));
+    EXPECT_EQ(0, scheduler.overruns());
+    EXPECT_EQ(100000, runs);
+}
+
+TEST(PollScheduler, RunAndStop) {
+    PollScheduler scheduler;
+
+    std::atomic<int> runs{0};
+    scheduler.add(1ms, [&]() {
+        if (++runs == 5)
+            scheduler.stop();
+    });
+
+    std::thread runner([&]() { scheduler.run(); });
+    runner.join();
+    EXPECT_GE(runs, 5);
+}
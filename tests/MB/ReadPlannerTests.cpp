@@ -0,0 +1,138 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/readPlanner.hpp"
+#include "MB/registerBank.hpp"
+
+#include "gtest/gtest.h"
+#include <map>
+
+using namespace MB;
+
+namespace {
+// Sends read through raw representation, as it would go over the wire
+ModbusResponse serve(RegisterBank &bank, const ReadPlanner::Read &read) {
+    const auto result = bank.handle(read.request);
+    return ModbusResponse::fromRaw(std::get<ModbusResponse>(result).toRaw());
+}
+} // namespace
+
+TEST(ReadPlanner, MergesWithinGap) {
+    ReadPlanner planner(3);
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 10, 2);
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 15, 1); // gap of 3
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 20, 1); // gap of 4
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 11, 1); // overlaps first
+
+    const auto reads = planner.plan();
+    ASSERT_EQ(2, reads.size());
+
+    EXPECT_EQ(10, reads[0].request.registerAddress());
+    EXPECT_EQ(6, reads[0].request.numberOfRegisters());
+    ASSERT_EQ(3, reads[0].slices.size());
+    EXPECT_EQ(0, reads[0].slices[0].tag);
+    EXPECT_EQ(3, reads[0].slices[1].tag);
+    EXPECT_EQ(1, reads[0].slices[1].offset);
+    EXPECT_EQ(1, reads[0].slices[2].tag);
+    EXPECT_EQ(5, reads[0].slices[2].offset);
+
+    EXPECT_EQ(20, reads[1].request.registerAddress());
+    EXPECT_EQ(1, reads[1].request.numberOfRegisters());
+}
+
+TEST(ReadPlanner, SeparatesUnitsAndFunctions) {
+    ReadPlanner planner(100, 100);
+    planner.add(2, utils::ReadAnalogOutputHoldingRegisters, 0, 1);
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 1, 1);
+    planner.add(1, utils::ReadAnalogInputRegisters, 0, 1);
+    planner.add(1, utils::ReadDiscreteOutputCoils, 0, 1);
+
+    const auto reads = planner.plan();
+    ASSERT_EQ(4, reads.size());
+    EXPECT_EQ(utils::ReadDiscreteOutputCoils, reads[0].request.functionCode());
+    EXPECT_EQ(utils::ReadAnalogOutputHoldingRegisters, reads[1].request.functionCode());
+    EXPECT_EQ(utils::ReadAnalogInputRegisters, reads[2].request.functionCode());
+    EXPECT_EQ(2, reads[3].request.slaveID());
+}
+
+TEST(ReadPlanner, RespectsRequestLimits) {
+    ReadPlanner planner(1000, 1000);
+    for (uint16_t address = 0; address < 1000; address += 10) {
+        planner.add(1, utils::ReadAnalogInputRegisters, address, 2);
+    }
+    planner.add(1, utils::ReadDiscreteInputContacts, 0, 1);
+    planner.add(1, utils::ReadDiscreteInputContacts, 3000, 1);
+
+    const auto reads = planner.plan();
+    // Discrete inputs are 3001 bits apart, registers span 992 registers
+    ASSERT_EQ(2 + 8, reads.size());
+    for (const auto &read : reads) {
+        const auto limit = read.request.functionCode() == utils::ReadDiscreteInputContacts
+                               ? MaxReadBits
+                               : MaxReadRegisters;
+        EXPECT_LE(read.request.numberOfRegisters(), limit);
+    }
+}
+
+TEST(ReadPlanner, RejectsInvalidTags) {
+    ReadPlanner planner;
+    EXPECT_THROW(planner.add(1, utils::WriteSingleAnalogOutputRegister, 0, 1),
+                 ModbusException);
+    EXPECT_THROW(planner.add(1, utils::ReadAnalogInputRegisters, 0, 0), ModbusException);
+    EXPECT_THROW(planner.add(1, utils::ReadAnalogInputRegisters, 0, 126),
+                 ModbusException);
+    EXPECT_THROW(planner.add(1, utils::ReadAnalogInputRegisters, 0xFFFF, 2),
+                 ModbusException);
+    EXPECT_EQ(0, planner.size());
+}
+
+TEST(ReadPlanner, SplitsResponses) {
+    RegisterBank bank(100, 0, 100, 0);
+    for (uint16_t i = 0; i < 100; i++) {
+        bank.holdingRegisters()[i] = 1000 + i;
+        bank.coils()[i]            = i % 3 == 0;
+    }
+
+    ReadPlanner planner(10, 10);
+    const auto regA  = planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 40, 2);
+    const auto regB  = planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 45, 3);
+    const auto coilA = planner.add(1, utils::ReadDiscreteOutputCoils, 3, 1);
+    const auto coilB = planner.add(1, utils::ReadDiscreteOutputCoils, 7, 3);
+
+    std::map<std::size_t, std::vector<ModbusCell>> values;
+    const auto reads = planner.plan();
+    ASSERT_EQ(2, reads.size());
+    for (const auto &read : reads) {
+        for (auto &[tag, cells] : ReadPlanner::split(read, serve(bank, read))) {
+            values[tag] = cells;
+        }
+    }
+
+    ASSERT_EQ(4, values.size());
+    EXPECT_EQ(2, values[regA].size());
+    EXPECT_EQ(1041, values[regA][1].reg());
+    ASSERT_EQ(3, values[regB].size());
+    EXPECT_EQ(1045, values[regB][0].reg());
+    EXPECT_EQ(1047, values[regB][2].reg());
+    ASSERT_EQ(1, values[coilA].size());
+    EXPECT_TRUE(values[coilA][0].coil());
+    ASSERT_EQ(3, values[coilB].size());
+    EXPECT_FALSE(values[coilB][0].coil());
+    EXPECT_FALSE(values[coilB][1].coil());
+    EXPECT_TRUE(values[coilB][2].coil());
+}
+
+TEST(ReadPlanner, SplitRejectsMismatchedResponse) {
+    ReadPlanner planner;
+    planner.add(1, utils::ReadAnalogOutputHoldingRegisters, 0, 4);
+    const auto read = planner.plan().front();
+
+    const ModbusResponse otherUnit(2, utils::ReadAnalogOutputHoldingRegisters, 0, 4,
+                                   std::vector<ModbusCell>(4, ModbusCell::initReg(0)));
+    EXPECT_THROW(ReadPlanner::split(read, otherUnit), ModbusException);
+
+    const ModbusResponse tooShort(1, utils::ReadAnalogOutputHoldingRegisters, 0, 2,
+                                  std::vector<ModbusCell>(2, ModbusCell::initReg(0)));
+    EXPECT_THROW(ReadPlanner::split(read, tooShort), ModbusException);
+}
@@ -0,0 +1,131 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/registerBank.hpp"
+
+#include "gtest/gtest.h"
+#include <variant>
+#include <vector>
+
+using namespace MB;
+
+class RegisterBankTest : public ::testing::Test {
+  protected:
+    RegisterBankTest() : bank(16, 16, 200, 200) {}
+
+    virtual void SetUp() {
+        for (std::size_t i = 0; i < bank.holdingRegisters().size(); i++) {
+            bank.holdingRegisters()[i] = static_cast<uint16_t>(i * 2);
+            bank.inputRegisters()[i]   = static_cast<uint16_t>(i * 3);
+        }
+        bank.coils()[3]          = 1;
+        bank.discreteInputs()[5] = 1;
+    }
+
+    RegisterBank bank;
+};
+
+TEST_F(RegisterBankTest, ReadRegisters) {
+    auto result =
+        bank.handle(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 10, 3));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+
+    const auto &response = std::get<ModbusResponse>(result);
+    EXPECT_EQ(1, response.slaveID());
+    EXPECT_EQ(3, response.numberOfRegisters());
+    EXPECT_EQ(20, response.registerValues()[0].reg());
+    EXPECT_EQ(24, response.registerValues()[2].reg());
+
+    result = bank.handle(ModbusRequest(1, utils::ReadAnalogInputRegisters, 199, 1));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(597, std::get<ModbusResponse>(result).registerValues()[0].reg());
+}
+
+TEST_F(RegisterBankTest, ReadBits) {
+    auto result = bank.handle(ModbusRequest(1, utils::ReadDiscreteOutputCoils, 0, 16));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+
+    const auto &coils = std::get<ModbusResponse>(result).registerValues();
+    EXPECT_TRUE(coils[3].coil());
+    EXPECT_FALSE(coils[4].coil());
+
+    result = bank.handle(ModbusRequest(1, utils::ReadDiscreteInputContacts, 5, 1));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_TRUE(std::get<ModbusResponse>(result).registerValues()[0].coil());
+}
+
+TEST_F(RegisterBankTest, Writes) {
+    auto result = bank.handle(ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 7,
+                                            1, {ModbusCell::initReg(0xBEEF)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(0xBEEF, bank.holdingRegisters()[7]);
+
+    result = bank.handle(ModbusRequest(1, utils::WriteSingleDiscreteOutputCoil, 3, 1,
+                                       {ModbusCell::initCoil(false)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(0, bank.coils()[3]);
+
+    result = bank.handle(
+        ModbusRequest(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 100, 2,
+                      {ModbusCell::initReg(1), ModbusCell::initReg(2)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(1, bank.holdingRegisters()[100]);
+    EXPECT_EQ(2, bank.holdingRegisters()[101]);
+    EXPECT_EQ(2, std::get<ModbusResponse>(result).numberOfRegisters());
+
+    result = bank.handle(ModbusRequest(1, utils::WriteMultipleDiscreteOutputCoils, 14, 2,
+                                       {ModbusCell::initCoil(true),
+                                        ModbusCell::initCoil(true)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(1, bank.coils()[14]);
+    EXPECT_EQ(1, bank.coils()[15]);
+}
+
+TEST_F(RegisterBankTest, Exceptions) {
+    const auto errorOf = [this](const ModbusRequest &request) {
+        auto result = bank.handle(request);
+        EXPECT_TRUE(std::holds_alternative<ModbusException>(result));
+        return std::get<ModbusException>(result).getErrorCode();
+    };
+
+    EXPECT_EQ(utils::IllegalDataAddress,
+              errorOf(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 199, 2)));
+    EXPECT_EQ(utils::IllegalDataAddress,
+              errorOf(ModbusRequest(1, utils::ReadDiscreteInputContacts, 16, 1)));
+    EXPECT_EQ(utils::IllegalDataAddress,
+              errorOf(ModbusRequest(1, utils::WriteSingleDiscreteOutputCoil, 16, 1,
+                                    {ModbusCell::initCoil(true)})));
+    EXPECT_EQ(utils::IllegalDataValue,
+              errorOf(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 126)));
+    EXPECT_EQ(utils::IllegalDataValue,
+              errorOf(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 0)));
+}
+
+TEST_F(RegisterBankTest, RawRoundTrip) {
+    // Write 200 coils in one frame and check that the echo can be serialized
+    RegisterBank coils(300);
+    std::vector<ModbusCell> values(200, ModbusCell::initCoil(true));
+    const auto raw = ModbusRequest(1, utils::WriteMultipleDiscreteOutputCoils, 50, 200,
+                                   values)
+                         .toRaw();
+
+    auto result = coils.handle(ModbusRequest::fromRaw(raw));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(1, coils.coils()[249]);
+    EXPECT_EQ(0, coils.coils()[250]);
+
+    const auto rawResponse = std::get<ModbusResponse>(result).toRaw();
+    ASSERT_EQ(6, rawResponse.size());
+    EXPECT_EQ(200, utils::bigEndianConv(&rawResponse[4]));
+
+    // Exception is serialized as function code with MSB set and error code
+    auto error = coils.handle(ModbusRequest(7, utils::ReadAnalogInputRegisters, 0, 1));
+    ASSERT_TRUE(std::holds_alternative<ModbusException>(error));
+    const auto rawError = std::get<ModbusException>(error).toRaw();
+    EXPECT_EQ(std::vector<uint8_t>({0x07, 0x84, utils::IllegalDataAddress}), rawError);
+    EXPECT_EQ(utils::IllegalDataAddress, ModbusException(rawError).getErrorCode());
+}
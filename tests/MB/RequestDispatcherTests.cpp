@@ -0,0 +1,78 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/registerBank.hpp"
+#include "MB/requestDispatcher.hpp"
+
+#include "gtest/gtest.h"
+#include <variant>
+#include <vector>
+
+using namespace MB;
+
+TEST(RequestDispatcher, UnregisteredFunction) {
+    RequestDispatcher dispatcher;
+
+    auto result =
+        dispatcher.dispatch(ModbusRequest(3, utils::ReadAnalogInputRegisters, 0, 1));
+    ASSERT_TRUE(std::holds_alternative<ModbusException>(result));
+    EXPECT_EQ(utils::IllegalFunction, std::get<ModbusException>(result).getErrorCode());
+    EXPECT_EQ(3, std::get<ModbusException>(result).slaveID());
+
+    // Vendor function code without handler
+    EXPECT_EQ(std::vector<uint8_t>({0x03, 0xC1, utils::IllegalFunction}),
+              dispatcher.dispatchRaw({0x03, 0x41, 0x00}));
+}
+
+TEST(RequestDispatcher, Handlers) {
+    RequestDispatcher dispatcher;
+    int calls = 0;
+
+    dispatcher.on(utils::ReadAnalogInputRegisters, [&](const ModbusRequest &request) {
+        calls++;
+        return ModbusResponse(request.slaveID(), request.functionCode(),
+                              request.registerAddress(), 1, {ModbusCell::initReg(42)});
+    });
+
+    auto result =
+        dispatcher.dispatch(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(42, std::get<ModbusResponse>(result).registerValues()[0].reg());
+    EXPECT_EQ(1, calls);
+
+    // Raw path parses request and serializes response
+    const auto raw = ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1).toRaw();
+    EXPECT_EQ(std::vector<uint8_t>({0x01, 0x04, 0x02, 0x00, 0x2A}),
+              dispatcher.dispatchRaw(raw));
+    EXPECT_EQ(2, calls);
+
+    // Vendor specific function code
+    dispatcher.onRaw(0x41, [](const std::vector<uint8_t> &request) {
+        return std::vector<uint8_t>({request[0], request[1], 0xAB});
+    });
+    EXPECT_TRUE(dispatcher.has(0x41));
+    EXPECT_EQ(std::vector<uint8_t>({0x05, 0x41, 0xAB}),
+              dispatcher.dispatchRaw({0x05, 0x41}));
+
+    dispatcher.remove(0x41);
+    EXPECT_FALSE(dispatcher.has(0x41));
+}
+
+TEST(RequestDispatcher, ServeBank) {
+    RegisterBank bank(0, 0, 10, 0);
+    RequestDispatcher dispatcher;
+    dispatcher.serve(bank);
+
+    auto result = dispatcher.dispatch(ModbusRequest(
+        1, utils::WriteSingleAnalogOutputRegister, 2, 1, {ModbusCell::initReg(7)}));
+    ASSERT_TRUE(std::holds_alternative<ModbusResponse>(result));
+    EXPECT_EQ(7, bank.holdingRegisters()[2]);
+
+    // Malformed request is answered with exception
+    EXPECT_EQ(std::vector<uint8_t>({0x01, 0x83, utils::IllegalDataValue}),
+              dispatcher.dispatchRaw({0x01, 0x03, 0x00}));
+}
@@ -0,0 +1,95 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/requestQueue.hpp"
+
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+using namespace MB;
+
+TEST(RequestQueue, RoundRobinBetweenSources) {
+    RequestQueue<int> queue;
+
+    // Source 1 floods the queue before source 2 and 3 ask for anything
+    for (int i = 0; i < 4; i++) {
+        queue.push(1, 10 + i);
+    }
+    queue.push(2, 20);
+    queue.push(3, 30);
+    queue.push(2, 21);
+
+    std::vector<int> order;
+    while (auto item = queue.tryPop()) {
+        order.push_back(*item);
+    }
+
+    EXPECT_EQ(std::vector<int>({10, 20, 30, 11, 21, 12, 13}), order);
+    EXPECT_EQ(0, queue.size());
+}
+
+TEST(RequestQueue, Close) {
+    RequestQueue<int> queue;
+    queue.push(0, 1);
+
+    std::thread consumer([&]() {
+        EXPECT_EQ(1, queue.pop());
+        // Blocks until queue is closed
+        EXPECT_FALSE(queue.pop().has_value());
+    });
+
+    queue.close();
+    consumer.join();
+
+    EXPECT_FALSE(queue.push(0, 2));
+}
+
+TEST(RequestQueue, PriorityClasses) {
+    RequestQueue<int> queue;
+    const auto now = RequestQueue<int>::Clock::now();
+
+    queue.push(1, 30, RequestPriority::Low, now);
+    queue.push(1, 20, RequestPriority::Normal, now);
+    queue.push(2, 21, RequestPriority::Normal, now);
+    queue.push(2, 10, RequestPriority::High, now);
+    queue.push(3, 0, RequestPriority::Urgent, now);
+
+    std::vector<int> order;
+    while (auto item = queue.tryPop(now)) {
+        order.push_back(*item);
+    }
+
+    EXPECT_EQ(std::vector<int>({0, 10, 20, 21, 30}), order);
+}
+
+TEST(RequestQueue, AgingPreventsStarvation) {
+    using namespace std::chrono_literals;
+
+    RequestQueue<int> queue;
+    queue.setAging(1s);
+    const auto start = RequestQueue<int>::Clock::now();
+
+    queue.push(1, 30, RequestPriority::Low, start);
+
+    // Fresh writes keep coming, low priority item still gets its turn
+    std::vector<int> order;
+    for (int i = 1; i <= 4; i++) {
+        const auto now = start + i * 1000ms;
+        queue.push(2, 10 + i, RequestPriority::High, now);
+        order.push_back(*queue.tryPop(now));
+    }
+
+    EXPECT_EQ(std::vector<int>({11, 12, 30, 13}), order);
+
+    const auto low = queue.stats(RequestPriority::Low);
+    EXPECT_EQ(1, low.served);
+    EXPECT_EQ(3s, low.maxDelay);
+    EXPECT_EQ(0, low.waiting);
+
+    const auto high = queue.stats(RequestPriority::High);
+    EXPECT_EQ(3, high.served);
+    EXPECT_EQ(1, high.waiting);
+    EXPECT_EQ(1s, high.totalDelay);
+}
@@ -0,0 +1,139 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusException.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/responseCache.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+const auto start = ResponseCache::Clock::time_point();
+
+std::vector<uint8_t> readRequest(uint8_t unitId, utils::MBFunctionCode functionCode,
+                                 uint16_t address, uint16_t count) {
+    return ModbusRequest(unitId, functionCode, address, count).toRaw();
+}
+
+std::vector<uint8_t> readResponse(uint8_t unitId, uint16_t value) {
+    return ModbusResponse(unitId, utils::ReadAnalogOutputHoldingRegisters, 0, 1,
+                          {ModbusCell::initReg(value)})
+        .toRaw();
+}
+} // namespace
+
+TEST(ResponseCache, KeyOnlyForReads) {
+    const auto key = ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 100, 10));
+    ASSERT_TRUE(key.has_value());
+    EXPECT_EQ(3, key->unitId);
+    EXPECT_EQ(utils::ReadAnalogOutputHoldingRegisters, key->functionCode);
+    EXPECT_EQ(100, key->address);
+    EXPECT_EQ(10, key->count);
+
+    const auto write = ModbusRequest(3, utils::WriteSingleAnalogOutputRegister, 100, 1,
+                                     {ModbusCell::initReg(1)});
+    EXPECT_FALSE(ResponseCache::keyOf(write.toRaw()).has_value());
+    EXPECT_FALSE(ResponseCache::keyOf({3, 0x03, 0, 0, 0, 0}).has_value());
+    EXPECT_FALSE(ResponseCache::keyOf({3, 0x03, 0}).has_value());
+}
+
+TEST(ResponseCache, ExpiresAfterTtl) {
+    ResponseCache cache;
+    cache.setTtl(3, 100ms);
+
+    const auto key = *ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 0, 1));
+    cache.store(key, readResponse(3, 42), start);
+
+    EXPECT_EQ(readResponse(3, 42), cache.lookup(key, start + 99ms));
+    EXPECT_FALSE(cache.lookup(key, start + 100ms).has_value());
+    EXPECT_EQ(0, cache.size());
+}
+
+TEST(ResponseCache, DisabledByDefault) {
+    ResponseCache cache;
+    cache.setTtl(4, 1s);
+
+    const auto key = *ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 0, 1));
+    cache.store(key, readResponse(3, 42), start);
+
+    EXPECT_FALSE(cache.lookup(key, start).has_value());
+}
+
+TEST(ResponseCache, ExceptionsAreNotCached) {
+    ResponseCache cache;
+    cache.setTtl(1s);
+
+    const auto key = *ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 0, 1));
+    cache.store(key,
+                ModbusException(utils::SlaveDeviceBusy, 3,
+                                utils::ReadAnalogOutputHoldingRegisters)
+                    .toRaw(),
+                start);
+
+    EXPECT_FALSE(cache.lookup(key, start).has_value());
+}
+
+TEST(ResponseCache, WriteInvalidatesOverlappingReads) {
+    ResponseCache cache;
+    cache.setTtl(1s);
+
+    const auto overlapping = *ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 10, 10));
+    const auto disjoint = *ResponseCache::keyOf(
+        readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 20, 10));
+    const auto otherTable =
+        *ResponseCache::keyOf(readRequest(3, utils::ReadAnalogInputRegisters, 10, 10));
+    const auto otherUnit = *ResponseCache::keyOf(
+        readRequest(4, utils::ReadAnalogOutputHoldingRegisters, 10, 10));
+
+    for (const auto &key : {overlapping, disjoint, otherTable, otherUnit}) {
+        cache.store(key, readResponse(key.unitId, 1), start);
+    }
+
+    // Writes registers 18 and 19
+    const auto write =
+        ModbusRequest(3, utils::WriteMultipleAnalogOutputHoldingRegisters, 18, 2,
+                      {ModbusCell::initReg(1), ModbusCell::initReg(2)});
+    cache.invalidate(write.toRaw());
+
+    EXPECT_FALSE(cache.lookup(overlapping, start).has_value());
+    EXPECT_TRUE(cache.lookup(disjoint, start).has_value());
+    EXPECT_TRUE(cache.lookup(otherTable, start).has_value());
+    EXPECT_TRUE(cache.lookup(otherUnit, start).has_value());
+
+    // Reads do not invalidate anything
+    cache.invalidate(readRequest(3, utils::ReadAnalogOutputHoldingRegisters, 20, 10));
+    EXPECT_EQ(3, cache.size());
+}
+
+TEST(ResponseCache, UnknownFunctionInvalidatesUnit) {
+    ResponseCache cache;
+    cache.setTtl(1s);
+
+    const auto unit3 =
+        *ResponseCache::keyOf(readRequest(3, utils::ReadDiscreteOutputCoils, 0, 8));
+    const auto unit4 =
+        *ResponseCache::keyOf(readRequest(4, utils::ReadDiscreteOutputCoils, 0, 8));
+    cache.store(unit3, readResponse(3, 1), start);
+    cache.store(unit4, readResponse(4, 1), start);
+
+    cache.invalidate({3, 0x41, 0x00});
+    EXPECT_FALSE(cache.lookup(unit3, start).has_value());
+    EXPECT_TRUE(cache.lookup(unit4, start).has_value());
+
+    // Broadcast reaches all units
+    cache.invalidate(ModbusRequest(0, utils::WriteSingleDiscreteOutputCoil, 3, 1,
+                                   {ModbusCell::initCoil(true)})
+                         .toRaw());
+    EXPECT_EQ(0, cache.size());
+}
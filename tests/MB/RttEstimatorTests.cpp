@@ -0,0 +1,81 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/rttEstimator.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+TEST(RttEstimator, InitialTimeout) {
+    RttEstimator estimator(200ms, 10ms, 1s);
+
+    EXPECT_EQ(200ms, estimator.timeout(1));
+    EXPECT_FALSE(estimator.estimate(1).has_value());
+}
+
+TEST(RttEstimator, ConvergesToResponseTime) {
+    RttEstimator estimator(500ms, 1ms, 10s);
+
+    // First sample sets SRTT = R and RTTVAR = R / 2
+    estimator.sample(1, 20ms);
+    EXPECT_EQ(20ms, estimator.estimate(1)->srtt);
+    EXPECT_EQ(10ms, estimator.estimate(1)->rttvar);
+    EXPECT_EQ(60ms, estimator.timeout(1));
+
+    for (int i = 0; i < 100; i++) {
+        estimator.sample(1, 20ms);
+    }
+
+    // Variation decays, so timeout approaches response time
+    const auto estimate = *estimator.estimate(1);
+    EXPECT_EQ(20ms, estimate.srtt);
+    EXPECT_LT(estimate.timeout, 21ms);
+    EXPECT_EQ(101, estimate.samples);
+
+    // Other units are not affected
+    EXPECT_EQ(500ms, estimator.timeout(2));
+}
+
+TEST(RttEstimator, FollowsJitter) {
+    RttEstimator estimator(500ms, 1ms, 10s);
+
+    for (int i = 0; i < 50; i++) {
+        estimator.sample(1, i % 2 == 0 ? 10ms : 50ms);
+    }
+
+    const auto estimate = *estimator.estimate(1);
+    EXPECT_GT(estimate.srtt, 20ms);
+    EXPECT_LT(estimate.srtt, 40ms);
+    // Timeout has to cover slow responses with a margin
+    EXPECT_GT(estimate.timeout, 60ms);
+}
+
+TEST(RttEstimator, ClampsAndBacksOff) {
+    RttEstimator estimator(100ms, 10ms, 1s);
+
+    estimator.sample(1, 1ms);
+    EXPECT_EQ(10ms, estimator.timeout(1));
+
+    estimator.timedOut(1);
+    EXPECT_EQ(20ms, estimator.timeout(1));
+    estimator.timedOut(1);
+    EXPECT_EQ(40ms, estimator.timeout(1));
+
+    for (int i = 0; i < 100; i++) {
+        estimator.timedOut(1);
+    }
+    EXPECT_EQ(1s, estimator.timeout(1));
+    EXPECT_EQ(102, estimator.estimate(1)->timeouts);
+
+    // Response ends backoff
+    estimator.sample(1, 1ms);
+    EXPECT_EQ(10ms, estimator.timeout(1));
+
+    estimator.reset(1);
+    EXPECT_EQ(100ms, estimator.timeout(1));
+    EXPECT_THROW(RttEstimator(100ms, 1s, 10ms), std::invalid_argument);
+}
@@ -0,0 +1,71 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/rtuBus.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+TEST(RtuBus, WireTime) {
+    const RTU::BusSchedule schedule(9600, RTU::BusSchedule::Clock::time_point());
+
+    // 11 bits per character
+    EXPECT_EQ(11458333ns, schedule.wireTime(10));
+    EXPECT_EQ(4010us, schedule.getInterFrameGap());
+    EXPECT_EQ(RTU::BusSchedule::DefaultTurnaround, schedule.getTurnaround());
+    EXPECT_THROW(RTU::BusSchedule(0), std::invalid_argument);
+}
+
+TEST(RtuBus, GapAfterResponse) {
+    const auto start = RTU::BusSchedule::Clock::time_point();
+    RTU::BusSchedule schedule(115200, start);
+    schedule.setInterFrameGap(2ms);
+    EXPECT_EQ(start, schedule.freeAt());
+
+    schedule.sent(8, false, start);
+    schedule.finished(9, false, start + 10ms);
+    EXPECT_EQ(start + 12ms, schedule.freeAt());
+
+    // Failed transaction still waits until the request is transmitted
+    schedule.sent(100, false, start + 20ms);
+    schedule.finished(0, false, start + 20ms);
+    EXPECT_EQ(start + 20ms + schedule.wireTime(100) + 2ms, schedule.freeAt());
+
+    const auto stats = schedule.stats(start + 100ms);
+    EXPECT_EQ(2, stats.transactions);
+    EXPECT_EQ(1, stats.failures);
+    EXPECT_EQ(0, stats.exceptions);
+    EXPECT_EQ(108, stats.bytesSent);
+    EXPECT_EQ(9, stats.bytesReceived);
+    EXPECT_EQ(schedule.wireTime(8) + schedule.wireTime(100) + schedule.wireTime(9),
+              stats.wire);
+    EXPECT_EQ(12ms + schedule.wireTime(100) + 2ms, stats.busy);
+    EXPECT_NEAR(stats.wire / 100.0ms, stats.utilization(), 1e-9);
+    EXPECT_NEAR(stats.busy / 100.0ms, stats.occupancy(), 1e-9);
+}
+
+TEST(RtuBus, TurnaroundAfterBroadcast) {
+    const auto start = RTU::BusSchedule::Clock::time_point();
+    RTU::BusSchedule schedule(19200, start);
+    schedule.setTurnaround(50ms);
+
+    schedule.sent(10, true, start);
+    EXPECT_EQ(start + schedule.wireTime(10) + 50ms, schedule.freeAt());
+
+    auto stats = schedule.stats(start + 1s);
+    EXPECT_EQ(1, stats.broadcasts);
+    EXPECT_EQ(0, stats.transactions);
+    EXPECT_EQ(schedule.wireTime(10) + 50ms, stats.busy);
+
+    // Only the part of the turnaround that already passed counts
+    EXPECT_EQ(20ms, schedule.stats(start + 20ms).busy);
+
+    schedule.resetStats(start + 1s);
+    stats = schedule.stats(start + 1s);
+    EXPECT_EQ(0, stats.broadcasts);
+    EXPECT_EQ(0, stats.utilization());
+}
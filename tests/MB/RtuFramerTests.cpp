@@ -0,0 +1,280 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/crc.hpp"
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/rtuFramer.hpp"
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+// Frame of the request, with CRC
+std::vector<uint8_t> rtuFrame(const ModbusRequest &request) {
+    auto frame     = request.toRaw();
+    const auto crc = CRC::calculateCRC(frame);
+    frame.push_back(static_cast<uint8_t>(crc));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+    return frame;
+}
+
+std::vector<uint8_t> join(std::vector<uint8_t> first, const std::vector<uint8_t> &rest) {
+    first.insert(first.end(), rest.begin(), rest.end());
+    return first;
+}
+} // namespace
+
+TEST(RtuFramer, Timing) {
+    const auto slow = RTU::Timing::forBaudRate(9600);
+    EXPECT_EQ(1719us, slow.interCharacter);
+    EXPECT_EQ(4010us, slow.interFrame);
+
+    const auto fast = RTU::Timing::forBaudRate(115200);
+    EXPECT_EQ(750us, fast.interCharacter);
+    EXPECT_EQ(1750us, fast.interFrame);
+
+    EXPECT_THROW(RTU::Timing::forBaudRate(0), std::invalid_argument);
+}
+
+TEST(RtuFramer, IncrementalCRC) {
+    const auto frame = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+
+    auto crc = CRC::Initial;
+    for (std::size_t i = 0; i < frame.size() - 2; i++) {
+        crc = CRC::update(crc, frame[i]);
+    }
+    EXPECT_EQ(CRC::calculateCRC(frame.data(), frame.size() - 2), crc);
+
+    crc = CRC::update(crc, frame[frame.size() - 2]);
+    crc = CRC::update(crc, frame[frame.size() - 1]);
+    EXPECT_EQ(0, crc);
+}
+
+TEST(RtuFramer, FrameInChunks) {
+    const auto frame = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+
+    framer.append(frame.data(), 3, start);
+    EXPECT_FALSE(framer.next(start + 100us).has_value());
+    ASSERT_TRUE(framer.completesAt().has_value());
+    EXPECT_EQ(start + framer.getTiming().interFrame, *framer.completesAt());
+
+    // Complete frame is returned without waiting for the silence
+    framer.append(frame.data() + 3, frame.size() - 3, start + 200us);
+    EXPECT_EQ(frame, framer.next(start + 200us));
+    EXPECT_FALSE(framer.next(start + 10ms).has_value());
+    EXPECT_FALSE(framer.completesAt().has_value());
+    EXPECT_EQ(0, framer.discardedBytes());
+}
+
+TEST(RtuFramer, SilenceDiscardsIncompleteFrame) {
+    const auto frame = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+
+    framer.append(frame.data(), 5, start);
+    EXPECT_FALSE(framer.next(start + 10ms).has_value());
+    EXPECT_EQ(5, framer.discardedBytes());
+
+    // Rest of the frame after the silence is not a frame either
+    framer.append(frame.data() + 5, frame.size() - 5, start + 11ms);
+    framer.append(frame, start + 20ms);
+    EXPECT_EQ(frame, framer.next(start + 20ms));
+    EXPECT_EQ(frame.size(), framer.discardedBytes());
+}
+
+TEST(RtuFramer, ResynchronizesOnGarbage) {
+    const auto first  = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    const auto second = rtuFrame(ModbusRequest(2, utils::ReadDiscreteOutputCoils, 4, 9));
+    const auto start  = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+
+    // Noise in front of two frames sent back to back
+    const std::vector<uint8_t> noise = {0xFF, 0x00, 0x03, 0x12};
+    framer.append(join(join(noise, first), second), start);
+    EXPECT_FALSE(framer.next(start + 1ms).has_value());
+
+    EXPECT_EQ(first, framer.next(start + 10ms));
+    EXPECT_EQ(second, framer.next(start + 10ms));
+    EXPECT_FALSE(framer.next(start + 10ms).has_value());
+    EXPECT_EQ(noise.size(), framer.discardedBytes());
+}
+
+TEST(RtuFramer, RequestPrefixWithValidCRC) {
+    // Write request, whose first 8 bytes happen to end with their own CRC
+    std::vector<uint8_t> frame;
+    for (uint16_t address = 0; frame.empty(); address++) {
+        const std::vector<ModbusCell> values(2, ModbusCell::initReg(0));
+        auto candidate = rtuFrame(ModbusRequest(
+            1, utils::WriteMultipleAnalogOutputHoldingRegisters, address, 2, values));
+        const auto crc = CRC::calculateCRC(candidate.data(), 6);
+        if (candidate[6] != static_cast<uint8_t>(crc))
+            continue;
+
+        // First value completes the CRC, frame CRC has to follow it
+        candidate[7] = static_cast<uint8_t>(crc >> 8);
+        candidate.resize(candidate.size() - 2);
+        const auto whole = CRC::calculateCRC(candidate);
+        candidate.push_back(static_cast<uint8_t>(whole));
+        candidate.push_back(static_cast<uint8_t>(whole >> 8));
+        frame = candidate;
+    }
+    ASSERT_EQ(0, CRC::calculateCRC(frame.data(), 8));
+
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+    framer.append(frame.data(), 8, start);
+    EXPECT_FALSE(framer.next(start + 100us).has_value());
+    framer.append(frame.data() + 8, frame.size() - 8, start + 200us);
+    EXPECT_EQ(frame, framer.next(start + 200us));
+    EXPECT_EQ(0, framer.discardedBytes());
+}
+
+TEST(RtuFramer, OverflowKeepsNewestBytes) {
+    const auto frame = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+
+    const std::vector<uint8_t> noise(RTU::MaxFrameSize + 100, 0xFF);
+    framer.append(noise, start);
+    framer.append(frame, start + 100us);
+
+    EXPECT_EQ(frame, framer.next(start + 10ms));
+    EXPECT_EQ(noise.size(), framer.discardedBytes());
+}
+
+TEST(RtuFramer, StrictInterCharacterTiming) {
+    const auto frame = rtuFrame(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    const auto start = RTU::Framer::Clock::time_point();
+    const auto gap   = RTU::Framer::Clock::duration(3ms); // Between t1.5 and t3.5
+    RTU::Framer framer(RTU::Timing::forBaudRate(9600));
+
+    framer.append(frame.data(), 3, start);
+    framer.append(frame.data() + 3, frame.size() - 3, start + gap);
+    EXPECT_EQ(frame, framer.next(start + gap));
+    EXPECT_EQ(1, framer.lateCharacters());
+
+    framer.setStrict(true);
+    framer.append(frame.data(), 3, start + 20ms);
+    framer.append(frame.data() + 3, frame.size() - 3, start + 20ms + gap);
+    EXPECT_FALSE(framer.next(start + 40ms).has_value());
+    EXPECT_EQ(frame.size(), framer.discardedBytes());
+}
+
+TEST(RtuFramer, ExpectedResponseSize) {
+    using utils::MBFunctionCode;
+    const auto size = [](MBFunctionCode code, uint16_t count) {
+        std::vector<ModbusCell> values;
+        if (code == utils::WriteMultipleDiscreteOutputCoils)
+            values.assign(count, ModbusCell::initCoil(true));
+        if (code == utils::WriteMultipleAnalogOutputHoldingRegisters)
+            values.assign(count, ModbusCell::initReg(1));
+        return RTU::expectedResponseSize(ModbusRequest(1, code, 0, count, values));
+    };
+
+    EXPECT_EQ(6, size(utils::ReadDiscreteOutputCoils, 1));
+    EXPECT_EQ(6, size(utils::ReadDiscreteInputContacts, 8));
+    EXPECT_EQ(7, size(utils::ReadDiscreteInputContacts, 9));
+    EXPECT_EQ(7, size(utils::ReadAnalogOutputHoldingRegisters, 1));
+    EXPECT_EQ(255, size(utils::ReadAnalogInputRegisters, 125));
+    EXPECT_EQ(8, size(utils::WriteMultipleAnalogOutputHoldingRegisters, 10));
+    EXPECT_EQ(8, size(utils::WriteMultipleDiscreteOutputCoils, 10));
+
+    const auto response = ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 3,
+                                         {ModbusCell::initReg(1), ModbusCell::initReg(2),
+                                          ModbusCell::initReg(3)});
+    EXPECT_EQ(size(utils::ReadAnalogInputRegisters, 3), response.toRaw().size() + 2);
+}
+
+TEST(RtuFramer, ExpectedResponseEndsFrame) {
+    const auto request = ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2);
+    const auto frame   = rtuFrame(request);
+    const auto start   = RTU::Framer::Clock::time_point();
+    RTU::Framer framer;
+
+    // Frame and start of another one, without a silence between them
+    framer.expect(frame.size());
+    EXPECT_EQ(RTU::ExceptionResponseSize, framer.remaining());
+    framer.append(frame.data(), 2, start);
+    EXPECT_EQ(frame.size() - 2, framer.remaining());
+    const std::vector<uint8_t> rest(frame.begin() + 2, frame.end());
+    framer.append(join(rest, {0x01, 0x04}), start);
+
+    EXPECT_EQ(frame, framer.next(start));
+    EXPECT_EQ(frame.size() - 2, framer.remaining());
+    EXPECT_FALSE(framer.next(start).has_value());
+
+    // Exception response is shorter
+    framer.reset();
+    const std::vector<uint8_t> exception = {0x01, 0x84, 0x02, 0xC2, 0xC1};
+    framer.append(exception.data(), 2, start);
+    EXPECT_EQ(3, framer.remaining());
+    framer.append(exception.data() + 2, 3, start);
+    EXPECT_EQ(exception, framer.next(start));
+
+    framer.expect(0);
+    EXPECT_EQ(0, framer.remaining());
+}
+
+TEST(RtuFramer, ExpectedResponseSpansReads) {
+    // USB adapter delivers the response in packets, with silence between them
+    std::vector<uint8_t> frame = {0x01, 0x03, 60};
+    for (uint8_t i = 0; i < 60; i++)
+        frame.push_back(i);
+    const auto crc = CRC::calculateCRC(frame);
+    frame.push_back(static_cast<uint8_t>(crc));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+    ASSERT_EQ(65, frame.size());
+
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer(RTU::Timing::forBaudRate(115200));
+    framer.expect(frame.size());
+
+    framer.append(frame.data(), 62, start);
+    EXPECT_FALSE(framer.next(start + 5ms).has_value());
+    // Only the caller's timeout ends incomplete response
+    EXPECT_FALSE(framer.completesAt().has_value());
+
+    framer.append(frame.data() + 62, frame.size() - 62, start + 5ms);
+    EXPECT_EQ(frame, framer.next(start + 5ms));
+    EXPECT_EQ(0, framer.discardedBytes());
+
+    // Strict framer ends it on silence
+    framer.reset();
+    framer.setStrict(true);
+    framer.append(frame.data(), 62, start);
+    EXPECT_FALSE(framer.next(start + 5ms).has_value());
+    EXPECT_EQ(62, framer.discardedBytes());
+}
+
+TEST(RtuFramer, MinimumGap) {
+    const auto start = RTU::Framer::Clock::time_point();
+    RTU::Framer framer(RTU::Timing::forBaudRate(115200));
+    framer.setMinimumGap(5ms);
+
+    // Frame of unknown length, with silence longer than t3.5 inside
+    std::vector<uint8_t> frame = {0x01, 0x41, 0xAA, 0xBB};
+    const auto crc = CRC::calculateCRC(frame);
+    frame.push_back(static_cast<uint8_t>(crc));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+
+    framer.append(frame.data(), 2, start);
+    ASSERT_TRUE(framer.completesAt().has_value());
+    EXPECT_EQ(start + 5ms, *framer.completesAt());
+    framer.append(frame.data() + 2, frame.size() - 2, start + 3ms);
+    EXPECT_FALSE(framer.next(start + 7ms).has_value());
+    EXPECT_EQ(frame, framer.next(start + 8ms));
+    EXPECT_EQ(0, framer.discardedBytes());
+
+    // Strict framer keeps t3.5
+    framer.setStrict(true);
+    framer.append(frame.data(), 2, start + 20ms);
+    EXPECT_EQ(start + 20ms + framer.getTiming().interFrame, *framer.completesAt());
+}
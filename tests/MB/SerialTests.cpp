@@ -0,0 +1,359 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Serial/busMaster.hpp"
+#include "MB/Serial/connection.hpp"
+#include "MB/Serial/multiplexer.hpp"
+#include "MB/Serial/server.hpp"
+#include "MB/Serial/virtualLink.hpp"
+#include "MB/metrics.hpp"
+#include "MB/registerBank.hpp"
+#include "serialTestUtils.hpp"
+
+#include "gtest/gtest.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <variant>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace MB;
+using namespace MB::Testing;
+using namespace std::chrono_literals;
+
+namespace {
+std::vector<uint8_t> withCRC(std::vector<uint8_t> frame) {
+    const auto crc = utils::calculateCRC(frame);
+    frame.push_back(static_cast<uint8_t>(crc & 0xFF));
+    frame.push_back(static_cast<uint8_t>(crc >> 8));
+    return frame;
+}
+} // namespace
+
+TEST(Serial, VirtualLinkRelaysFrames) {
+    Serial::VirtualLink link;
+    auto master = open(link.first());
+    auto slave  = open(link.second());
+
+    const auto sent =
+        master.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    EXPECT_EQ(sent, slave.awaitRawMessage());
+    EXPECT_EQ(sent.size(), link.relayed());
+}
+
+TEST(Serial, ResponseEndsAtExpectedLength) {
+    Serial::VirtualLink link;
+    auto master = open(link.first());
+    auto slave  = open(link.second());
+
+    const auto request = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 4, 1);
+    master.sendRequest(request);
+    const auto [received, raw] = slave.awaitRequest();
+    EXPECT_EQ(request.registerAddress(), received.registerAddress());
+
+    // Unrelated frame right after the response is left for the next read
+    auto line = withCRC(ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 4, 1,
+                                       {ModbusCell::initReg(0xBEEF)})
+                            .toRaw());
+    const auto extra =
+        withCRC(ModbusRequest(7, utils::ReadDiscreteOutputCoils, 0, 1).toRaw());
+    line.insert(line.end(), extra.begin(), extra.end());
+    link.inject(line);
+
+    const auto [response, frame] = master.awaitResponse();
+    EXPECT_EQ(0xBEEF, response.registerValues()[0].reg());
+    EXPECT_EQ(RTU::expectedResponseSize(request), frame.size());
+    EXPECT_EQ(extra, master.awaitRawMessage());
+}
+
+TEST(Serial, VirtualLinkPacesBytes) {
+    Serial::VirtualLink link(9600);
+    auto master = open(link.first(), 9600);
+    auto slave  = open(link.second(), 9600);
+
+    const auto start = std::chrono::steady_clock::now();
+    master.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 2));
+    (void)slave.awaitRequest();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // 8 bytes, 11 bits each, plus the silence ending the frame
+    EXPECT_GE(elapsed, 8 * 11 * 1'000'000us / 9600);
+}
+
+TEST(Serial, CustomBaudRate) {
+    Serial::VirtualLink link;
+    auto connection = open(link.first(), 921600);
+    EXPECT_EQ(RTU::Timing::forBaudRate(921600).interFrame,
+              connection.getFramer().getTiming().interFrame);
+
+    // Pseudo terminals have no RS-485 mode
+    EXPECT_THROW(connection.setRS485(Serial::RS485Options()), std::runtime_error);
+}
+
+TEST_F(SerialServer, ServesUnits) {
+    Serial::BusMaster master(open(link.first()), 115200);
+    master.connection().setTimeout(100);
+    auto masterMetrics = std::make_shared<Metrics>();
+    master.connection().setMetrics(masterMetrics);
+
+    master.transact(ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 3, 1,
+                                  {ModbusCell::initReg(11)}));
+    master.transact(ModbusRequest(2, utils::WriteSingleAnalogOutputRegister, 3, 1,
+                                  {ModbusCell::initReg(22)}));
+
+    const auto results = master.transactAll({
+        ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 3, 1),
+        ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters, 3, 1),
+        ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters, 30, 1),
+        ModbusRequest(3, utils::ReadAnalogOutputHoldingRegisters, 3, 1),
+    });
+
+    ASSERT_EQ(4, results.size());
+    EXPECT_EQ(11, std::get<ModbusResponse>(results[0]).registerValues()[0].reg());
+    EXPECT_EQ(22, std::get<ModbusResponse>(results[1]).registerValues()[0].reg());
+    EXPECT_EQ(utils::IllegalDataAddress,
+              std::get<ModbusException>(results[2]).getErrorCode());
+    // Nobody serves unit 3
+    EXPECT_EQ(utils::Timeout, std::get<ModbusException>(results[3]).getErrorCode());
+
+    const auto stats = server.stats();
+    EXPECT_EQ(5, stats.requests);
+    EXPECT_EQ(1, stats.exceptions);
+    EXPECT_EQ(1, stats.ignored);
+
+    const auto bus = master.stats();
+    EXPECT_EQ(6, bus.transactions);
+    EXPECT_EQ(1, bus.exceptions);
+    EXPECT_EQ(1, bus.failures);
+
+    // Slave only answers, master only asks
+    uint64_t requests = 0, received = 0, responses = 0;
+    for (const auto &unit : metrics->snapshot().units) {
+        requests += unit.requests;
+        received += unit.requestsReceived;
+        responses += unit.responsesSent;
+    }
+    EXPECT_EQ(0, requests);
+    EXPECT_EQ(5, received);
+    EXPECT_EQ(5, responses);
+    EXPECT_EQ(5, metrics->snapshot().framesIn);
+
+    requests = 0, responses = 0;
+    for (const auto &unit : masterMetrics->snapshot().units) {
+        requests += unit.requests;
+        responses += unit.responsesSent;
+    }
+    EXPECT_EQ(6, requests);
+    EXPECT_EQ(0, responses);
+}
+
+TEST_F(SerialServer, Broadcast) {
+    Serial::BusMaster master(open(link.first()), 115200);
+    master.setTurnaround(10ms);
+
+    const auto results = master.transactAll({
+        ModbusRequest(0, utils::WriteSingleAnalogOutputRegister, 5, 1,
+                      {ModbusCell::initReg(7)}),
+        ModbusRequest(2, utils::ReadAnalogOutputHoldingRegisters, 5, 1),
+    });
+
+    EXPECT_TRUE(std::holds_alternative<std::monostate>(results[0]));
+    EXPECT_EQ(7, std::get<ModbusResponse>(results[1]).registerValues()[0].reg());
+    EXPECT_EQ(7, first.holdingRegisters()[5]);
+    EXPECT_EQ(1, server.stats().broadcasts);
+    const auto read = ModbusRequest(0, utils::ReadAnalogInputRegisters, 0, 1);
+    EXPECT_THROW(master.broadcast(read), std::invalid_argument);
+}
+
+TEST_F(SerialServer, ResynchronizesAfterNoise) {
+    auto master = open(link.first());
+
+    // Noise right before the request, without any silence
+    link.inject({0x55, 0x01, 0xAA});
+    master.clearInput();
+    master.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 0, 2));
+
+    const auto [response, raw] = master.awaitResponse();
+    EXPECT_EQ(2, response.registerValues().size());
+}
+
+TEST_F(SerialServer, BreakerChecksOnlyRequests) {
+    // Breaker of the slave is never consulted for its own responses
+    const auto opened = std::make_shared<CircuitBreaker>(1, 10s);
+    opened->failure(1);
+    server.connection().setCircuitBreaker(opened);
+
+    auto master = open(link.first());
+    master.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 0, 2));
+    EXPECT_EQ(2, std::get<0>(master.awaitResponse()).registerValues().size());
+
+    master.setCircuitBreaker(opened);
+    try {
+        master.sendRawRequest({1, 0x41});
+        FAIL() << "Open breaker has to reject the request";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::CircuitOpen, ex.getErrorCode());
+    }
+    // Responses are not requests
+    EXPECT_NO_THROW(master.sendResponse(
+        ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 0, 1,
+                       {ModbusCell::initReg(1)})));
+}
+
+TEST(Serial, MultiplexerKeepsPortOrder) {
+    // Every port has its own line with a slave serving unit 1
+    constexpr std::size_t Ports = 3;
+    std::array<Serial::VirtualLink, Ports> links;
+    std::array<RegisterBank, Ports> banks;
+    std::vector<std::unique_ptr<Serial::Server>> servers;
+    std::vector<std::thread> serving;
+
+    Serial::Multiplexer multiplexer;
+    const auto metrics = std::make_shared<Metrics>();
+    for (std::size_t i = 0; i < Ports; i++) {
+        banks[i] = RegisterBank(0, 0, 4, 0);
+        servers.push_back(std::make_unique<Serial::Server>(open(links[i].second())));
+        servers.back()->addUnit(1, banks[i]);
+        serving.emplace_back([&server = *servers.back()]() { server.run(); });
+
+        auto connection = open(links[i].first());
+        connection.setTimeout(50);
+        if (i == 0)
+            connection.setMetrics(metrics);
+        EXPECT_EQ(i, multiplexer.addPort(std::move(connection), 115200));
+        multiplexer.setTurnaround(i, 1ms);
+    }
+    std::thread running([&]() { multiplexer.run(); });
+
+    std::mutex mutex;
+    std::array<std::vector<Serial::Multiplexer::Result>, Ports> results;
+    std::atomic<std::size_t> done{0};
+    const auto submit = [&](std::size_t port, const ModbusRequest &request) {
+        multiplexer.submit(port, request, [&, port](const auto &result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results[port].push_back(result);
+            done++;
+        });
+    };
+
+    // Every read has to see the write submitted before it
+    for (std::size_t port = 0; port < Ports; port++) {
+        const auto value = static_cast<uint16_t>(100 + port);
+        submit(port, ModbusRequest(1, utils::WriteSingleAnalogOutputRegister, 2, 1,
+                                   {ModbusCell::initReg(value)}));
+        submit(port, ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 2, 1));
+        submit(port, ModbusRequest(0, utils::WriteSingleAnalogOutputRegister, 3, 1,
+                                   {ModbusCell::initReg(value)}));
+        submit(port, ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 3, 1));
+    }
+    // Nobody serves unit 5, next requests wait for the timeout
+    submit(0, ModbusRequest(5, utils::ReadAnalogOutputHoldingRegisters, 0, 1));
+    submit(0, ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 10, 1));
+    const auto read = ModbusRequest(0, utils::ReadAnalogOutputHoldingRegisters, 0, 1);
+    EXPECT_THROW(submit(0, read), std::invalid_argument);
+
+    const auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (done < 4 * Ports + 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    multiplexer.stop();
+    running.join();
+    for (std::size_t i = 0; i < Ports; i++) {
+        servers[i]->stop();
+        serving[i].join();
+    }
+
+    ASSERT_EQ(4 * Ports + 2, done);
+    for (std::size_t port = 0; port < Ports; port++) {
+        const auto &received = results[port];
+        const auto value     = 100 + port;
+        ASSERT_LE(4, received.size());
+        EXPECT_TRUE(std::holds_alternative<ModbusResponse>(received[0]));
+        EXPECT_EQ(value, std::get<ModbusResponse>(received[1]).registerValues()[0].reg());
+        EXPECT_TRUE(std::holds_alternative<std::monostate>(received[2]));
+        EXPECT_EQ(value, std::get<ModbusResponse>(received[3]).registerValues()[0].reg());
+        EXPECT_EQ(0, multiplexer.pending(port));
+    }
+
+    EXPECT_EQ(utils::Timeout, std::get<ModbusException>(results[0][4]).getErrorCode());
+    EXPECT_EQ(utils::IllegalDataAddress,
+              std::get<ModbusException>(results[0][5]).getErrorCode());
+    EXPECT_EQ(5, multiplexer.stats(0).transactions);
+
+    // Outcomes are reported as by awaitResponse()
+    const auto units = metrics->snapshot().units;
+    ASSERT_EQ(3, units.size());
+    EXPECT_EQ(4, units[1].requests);
+    EXPECT_EQ(4, units[1].responses);
+    EXPECT_EQ(1, units[1].exceptions[utils::IllegalDataAddress]);
+    EXPECT_EQ(5, units[2].unitId);
+    EXPECT_EQ(1, units[2].requests);
+    EXPECT_EQ(0, units[2].responses);
+    EXPECT_EQ(1, units[2].timeouts);
+}
+
+TEST(Serial, RtuOverTcp) {
+    int port;
+    const int listening = listenLocal(port);
+    auto master         = Serial::Connection::withTcp("127.0.0.1", port);
+    EXPECT_TRUE(master.isSocket());
+
+    RegisterBank bank(0, 0, 4, 0);
+    bank.holdingRegisters()[1] = 0x1234;
+    const int accepted = ::accept(listening, nullptr, nullptr);
+    ::close(listening);
+    Serial::Server server(Serial::Connection::fromSocket(accepted));
+    server.addUnit(1, bank);
+    std::thread serving([&]() { server.run(); });
+
+    master.sendRequest(ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 1, 1));
+    const auto [response, raw] = master.awaitResponse();
+    EXPECT_EQ(0x1234, response.registerValues()[0].reg());
+    EXPECT_EQ(7, raw.size());
+
+    server.stop();
+    serving.join();
+}
+
+TEST(Serial, RtuOverTcpSplitFrame) {
+    int port;
+    const int listening = listenLocal(port);
+    auto master         = Serial::Connection::withTcp("127.0.0.1", port);
+    const int converter = ::accept(listening, nullptr, nullptr);
+    ::close(listening);
+    const int noDelay = 1;
+    ::setsockopt(converter, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    // Leftovers of some previous transaction
+    const uint8_t garbage[] = {0x01, 0x03, 0x02};
+    ::send(converter, garbage, sizeof(garbage), 0);
+    std::this_thread::sleep_for(5ms);
+    master.clearInput();
+
+    const auto request = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 0, 1);
+    master.sendRequest(request);
+    uint8_t received[8];
+    EXPECT_EQ(8, ::recv(converter, received, sizeof(received), MSG_WAITALL));
+
+    // Response in two segments, with a delay longer than t3.5 of any serial line
+    const auto response = withCRC(
+        ModbusResponse(1, utils::ReadAnalogOutputHoldingRegisters, 0, 1,
+                       {ModbusCell::initReg(42)})
+            .toRaw());
+    ::send(converter, response.data(), 3, 0);
+    std::this_thread::sleep_for(10ms);
+    ::send(converter, response.data() + 3, response.size() - 3, 0);
+
+    const auto [parsed, raw] = master.awaitResponse();
+    EXPECT_EQ(42, parsed.registerValues()[0].reg());
+    EXPECT_EQ(response, raw);
+    ::close(converter);
+}
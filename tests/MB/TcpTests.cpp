@@ -0,0 +1,126 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/TCP/connection.hpp"
+#include "MB/client.hpp"
+#include "MB/mbap.hpp"
+#include "MB/registerBank.hpp"
+
+#include "gtest/gtest.h"
+#include <arpa/inet.h>
+#include <thread>
+#include <variant>
+
+using namespace MB;
+
+namespace {
+// Connected pair of client and server connections over the loopback interface
+std::pair<TCP::Connection, TCP::Connection> connectedPair() {
+    const int listening = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size          = sizeof(address);
+
+    if (listening < 0 ||
+        ::bind(listening, reinterpret_cast<sockaddr *>(&address), size) != 0 ||
+        ::listen(listening, 1) != 0 ||
+        ::getsockname(listening, reinterpret_cast<sockaddr *>(&address), &size) != 0)
+        throw std::runtime_error("Cannot listen");
+
+    auto client  = TCP::Connection::with("127.0.0.1", ntohs(address.sin_port));
+    const int fd = ::accept(listening, nullptr, nullptr);
+    ::close(listening);
+    return {std::move(client), TCP::Connection(fd)};
+}
+} // namespace
+
+TEST(Tcp, TransactionIdsAreBigEndian) {
+    auto [client, server] = connectedPair();
+    client.setMessageId(0x1234);
+
+    const auto first =
+        client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1));
+    EXPECT_EQ(0x12, first[0]);
+    EXPECT_EQ(0x34, first[1]);
+    (void)client.sendRequest(ModbusRequest(1, utils::ReadAnalogInputRegisters, 5, 1));
+    EXPECT_EQ(0x1235, client.getMessageId());
+
+    // Both requests may arrive in a single segment
+    const auto metrics = std::make_shared<Metrics>();
+    server.setMetrics(metrics);
+    const auto request = server.awaitRequest();
+    EXPECT_EQ(0x1234, server.getMessageId());
+    EXPECT_EQ(0, request.registerAddress());
+    EXPECT_EQ(5, server.awaitRequest().registerAddress());
+
+    // Server side counts what it has received
+    const auto received = metrics->snapshot();
+    EXPECT_EQ(24, received.bytesIn);
+    EXPECT_EQ(2, received.framesIn);
+    ASSERT_EQ(1, received.units.size());
+    EXPECT_EQ(2, received.units[0].requestsReceived);
+
+    // Answered in reverse order
+    server.sendResponse(ModbusResponse(1, utils::ReadAnalogInputRegisters, 5, 1,
+                                       {ModbusCell::initReg(50)}));
+    server.setMessageId(0x1234);
+    server.sendResponse(ModbusResponse(1, utils::ReadAnalogInputRegisters, 0, 1,
+                                       {ModbusCell::initReg(10)}));
+
+    EXPECT_EQ(10, client.awaitResponse(0x1234).registerValues()[0].reg());
+    EXPECT_EQ(50, client.awaitResponse(0x1235).registerValues()[0].reg());
+}
+
+TEST(Tcp, ReadRangePipelined) {
+    auto [connection, server] = connectedPair();
+    RegisterBank bank(0, 0, 0, 1000);
+    for (std::size_t i = 0; i < bank.inputRegisters().size(); i++)
+        bank.inputRegisters()[i] = static_cast<uint16_t>(1000 - i);
+
+    std::thread serving([&server = server, &bank]() {
+        server.setIdleTimeout(300);
+        try {
+            while (true) {
+                const auto result = bank.handle(server.awaitRequest());
+                if (const auto *response = std::get_if<ModbusResponse>(&result))
+                    server.sendResponse(*response);
+                else
+                    server.sendException(std::get<ModbusException>(result));
+            }
+        } catch (const ModbusException &) {
+        }
+    });
+
+    Client<TCP::Connection> client(connection);
+    client.setPipelineDepth(8);
+    const auto values = client.readRange(1, utils::InputRegisters, 0, 1000);
+    ASSERT_EQ(1000, values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+        ASSERT_EQ(1000 - i, values[i].reg());
+
+    serving.join();
+}
+
+TEST(Tcp, RawMessageAfterFrames) {
+    auto [client, server] = connectedPair();
+
+    // Two frames in a single segment, awaitRequest() receives both
+    const auto request = ModbusRequest(1, utils::ReadAnalogInputRegisters, 0, 1);
+    auto segment       = MBAP::wrap(7, request.toRaw());
+    const auto second  = MBAP::wrap(8, request.toRaw());
+    segment.insert(segment.end(), second.begin(), second.end());
+    ASSERT_EQ(static_cast<ssize_t>(segment.size()),
+              ::send(client.getSockfd(), segment.data(), segment.size(), 0));
+
+    (void)server.awaitRequest();
+    EXPECT_EQ(7, server.getMessageId());
+    // Rest is not lost
+    std::vector<uint8_t> raw;
+    while (raw.size() < second.size()) {
+        const auto part = server.awaitRawMessage();
+        raw.insert(raw.end(), part.begin(), part.end());
+    }
+    EXPECT_EQ(second, raw);
+}
@@ -0,0 +1,79 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/timerWheel.hpp"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+const auto start = TimerWheel::Clock::time_point();
+}
+
+TEST(TimerWheel, FiresInOrderNeverEarly) {
+    TimerWheel wheel(1ms, 8, start);
+
+    std::vector<char> order;
+    wheel.schedule(start + 3ms, [&]() { order.push_back('b'); });
+    wheel.schedule(start + 1500us, [&]() { order.push_back('a'); });
+    // More than one revolution away
+    wheel.schedule(start + 20ms, [&]() { order.push_back('c'); });
+    EXPECT_EQ(3, wheel.size());
+    EXPECT_EQ(start + 2ms, wheel.nextExpiry());
+
+    EXPECT_EQ(0, wheel.advance(start + 1ms));
+    EXPECT_EQ(1, wheel.advance(start + 2ms));
+    EXPECT_EQ(1, wheel.advance(start + 3ms));
+    EXPECT_EQ(start + 20ms, wheel.nextExpiry());
+    // Same slot, but one revolution earlier
+    EXPECT_EQ(0, wheel.advance(start + 12ms));
+    EXPECT_EQ(1, wheel.advance(start + 20ms));
+
+    EXPECT_EQ(std::vector<char>({'a', 'b', 'c'}), order);
+    EXPECT_EQ(0, wheel.size());
+    EXPECT_FALSE(wheel.nextExpiry());
+}
+
+TEST(TimerWheel, Cancel) {
+    TimerWheel wheel(1ms, 8, start);
+
+    int fired     = 0;
+    const auto id = wheel.schedule(start + 2ms, [&]() { fired++; });
+    wheel.schedule(start + 4ms, [&]() { fired++; });
+
+    EXPECT_TRUE(wheel.cancel(id));
+    EXPECT_FALSE(wheel.cancel(id));
+    EXPECT_EQ(start + 4ms, wheel.nextExpiry());
+    EXPECT_EQ(1, wheel.advance(start + 5ms));
+    EXPECT_EQ(1, fired);
+}
+
+TEST(TimerWheel, CallbacksRearm) {
+    TimerWheel wheel(1ms, 4, start);
+
+    // Timer rearming itself, like a periodic timeout
+    int fired = 0;
+    std::function<void()> tick;
+    tick = [&]() {
+        if (++fired < 3)
+            wheel.schedule(start + 1ms * (fired + 1), tick);
+    };
+    wheel.schedule(start + 1ms, tick);
+
+    // Long pause, only one timer was due at the time
+    EXPECT_EQ(1, wheel.advance(start + 100ms));
+    // Rescheduled to the past, fires on the next call
+    EXPECT_EQ(1, wheel.advance(start + 101ms));
+    EXPECT_EQ(1, wheel.advance(start + 102ms));
+    EXPECT_EQ(3, fired);
+    EXPECT_EQ(0, wheel.size());
+}
+
+TEST(TimerWheel, InvalidArguments) {
+    EXPECT_THROW(TimerWheel(0ms), std::invalid_argument);
+    EXPECT_THROW(TimerWheel(1ms, 0), std::invalid_argument);
+}
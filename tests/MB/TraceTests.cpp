@@ -0,0 +1,142 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/modbusRequest.hpp"
+#include "MB/modbusResponse.hpp"
+#include "MB/trace.hpp"
+
+#include "gtest/gtest.h"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace MB;
+
+namespace {
+TraceRecord recordOf(int32_t channel) {
+    TraceRecord record;
+    record.channel = channel;
+    return record;
+}
+} // namespace
+
+TEST(Trace, RingIsFifoAndDropsWhenFull) {
+    EXPECT_THROW(TraceRing(3), std::invalid_argument);
+
+    TraceRing ring(4);
+    EXPECT_EQ(4, ring.capacity());
+    EXPECT_FALSE(ring.tryPop().has_value());
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(ring.tryPush(recordOf(i)));
+    }
+    EXPECT_FALSE(ring.tryPush(recordOf(4)));
+    EXPECT_EQ(1, ring.dropped());
+
+    EXPECT_EQ(0, ring.tryPop()->channel);
+    EXPECT_TRUE(ring.tryPush(recordOf(5)));
+
+    std::vector<int32_t> channels;
+    EXPECT_EQ(4, ring.drain([&](const TraceRecord &record) {
+        channels.push_back(record.channel);
+    }));
+    EXPECT_EQ((std::vector<int32_t>{1, 2, 3, 5}), channels);
+}
+
+TEST(Trace, ConcurrentProducers) {
+    constexpr int producers = 4;
+    constexpr int records   = 20000;
+    TraceRing ring(1024);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&ring, p]() {
+            for (int i = 0; i < records; i++) {
+                auto record = recordOf(p);
+                record.size = static_cast<uint16_t>(i);
+                // Retry instead of dropping, so that every record is checked
+                while (!ring.tryPush(record)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Records of every producer arrive in order
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    while (received < producers * records) {
+        if (auto record = ring.tryPop()) {
+            ASSERT_EQ(next[record->channel], record->size);
+            next[record->channel] = (next[record->channel] + 1) % 65536;
+            received++;
+        }
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_FALSE(ring.tryPop().has_value());
+}
+
+TEST(Trace, Policies) {
+    static_assert(!NoTracing::Enabled);
+    static_assert(RingTracing::Enabled);
+
+    TraceRing ring(16);
+    RingTracing::install(&ring);
+
+    const std::vector<uint8_t> frame(40, 0xAB);
+    trace<NoTracing>(TraceEvent::FrameSent, TraceSource::TCP, 7, frame);
+    EXPECT_FALSE(ring.tryPop().has_value());
+
+    trace<RingTracing>(TraceEvent::FrameSent, TraceSource::TCP, 7, frame);
+    traceError<RingTracing>(TraceSource::Serial, 8, utils::Timeout);
+    RingTracing::install(nullptr);
+
+    // Not installed ring does not get records
+    trace<RingTracing>(TraceEvent::FrameSent, TraceSource::TCP, 7, frame);
+
+    const auto sent = ring.tryPop();
+    ASSERT_TRUE(sent.has_value());
+    EXPECT_EQ(TraceEvent::FrameSent, sent->event);
+    EXPECT_EQ(TraceSource::TCP, sent->source);
+    EXPECT_EQ(7, sent->channel);
+    EXPECT_EQ(40, sent->size);
+    EXPECT_EQ(TraceRecord::MaxBytes, sent->captured());
+    EXPECT_EQ(0xAB, sent->bytes[TraceRecord::MaxBytes - 1]);
+    EXPECT_GT(sent->timestamp, 0);
+
+    const auto error = ring.tryPop();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(TraceEvent::Error, error->event);
+    EXPECT_EQ(utils::Timeout, error->error);
+    EXPECT_EQ(0, error->size);
+
+    EXPECT_FALSE(ring.tryPop().has_value());
+}
+
+#ifdef MODBUS_TRACING
+TEST(Trace, ParserHooks) {
+    TraceRing ring(16);
+    RingTracing::install(&ring);
+
+    const auto request = ModbusRequest(1, utils::ReadAnalogOutputHoldingRegisters, 0, 2);
+    ModbusRequest::fromRaw(request.toRaw());
+    EXPECT_THROW(ModbusResponse::fromRaw({0x01, 0x42, 0x00}), ModbusException);
+    RingTracing::install(nullptr);
+
+    const auto parsed = ring.tryPop();
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(TraceEvent::FrameParsed, parsed->event);
+    EXPECT_EQ(TraceSource::RequestParser, parsed->source);
+    EXPECT_EQ(request.toRaw().size(), parsed->size);
+
+    const auto error = ring.tryPop();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(TraceEvent::Error, error->event);
+    EXPECT_EQ(TraceSource::ResponseParser, error->source);
+    EXPECT_EQ(utils::InvalidByteOrder, error->error);
+}
+#endif
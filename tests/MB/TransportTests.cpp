@@ -0,0 +1,301 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#include "MB/Loopback/connection.hpp"
+#include "MB/bridge.hpp"
+#include "MB/client.hpp"
+#include "MB/poller.hpp"
+#include "MB/registerBank.hpp"
+#include "MB/transport.hpp"
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <tuple>
+#include <variant>
+
+using namespace MB;
+using namespace std::chrono_literals;
+
+namespace {
+// Returns responses with raw frames, like Serial::Connection, but never gets any
+struct SilentTransport {
+    int sent = 0;
+
+    std::vector<uint8_t> sendRequest(const ModbusRequest &) {
+        sent++;
+        return {};
+    }
+    std::tuple<ModbusResponse, std::vector<uint8_t>> awaitResponse() {
+        throw ModbusException(utils::Timeout);
+    }
+    void setTimeout(int) {}
+    [[nodiscard]] int getTimeout() const { return 0; }
+};
+
+// Serves requests from the bank right away, like a serial line without pipelining
+struct BankTransport {
+    RegisterBank &bank;
+    std::vector<ModbusRequest> requests;
+
+    std::vector<uint8_t> sendRequest(const ModbusRequest &request) {
+        requests.push_back(request);
+        return {};
+    }
+    std::tuple<ModbusResponse, std::vector<uint8_t>> awaitResponse() {
+        const auto result = bank.handle(requests.back());
+        if (const auto *exception = std::get_if<ModbusException>(&result))
+            throw *exception;
+        return {std::get<ModbusResponse>(result), {}};
+    }
+    void setTimeout(int) {}
+    [[nodiscard]] int getTimeout() const { return 0; }
+};
+
+struct SendOnly {
+    void sendRequest(const ModbusRequest &) {}
+};
+
+static_assert(isClientTransport<Loopback::Connection>);
+static_assert(isServerTransport<Loopback::Connection>);
+static_assert(isClientTransport<SilentTransport>);
+static_assert(!isServerTransport<SilentTransport>);
+static_assert(!isClientTransport<SendOnly>);
+static_assert(isPipelinedTransport<Loopback::Connection>);
+static_assert(!isPipelinedTransport<SilentTransport>);
+static_assert(!isClientTransport<int>);
+
+// Serves requests from the bank until the client stops sending them
+std::thread serveBank(Loopback::Connection &server, RegisterBank &bank) {
+    return std::thread([&server, &bank]() {
+        server.setTimeout(300);
+        try {
+            while (true) {
+                const auto request =
+                    TransportTraits<Loopback::Connection>::awaitRequest(server);
+                const auto result = bank.handle(request);
+                if (const auto *response = std::get_if<ModbusResponse>(&result))
+                    server.sendResponse(*response);
+                else
+                    server.sendException(std::get<ModbusException>(result));
+            }
+        } catch (const ModbusException &) {
+        }
+    });
+}
+
+// Forwards requests until the upstream stops sending them
+template <typename Downstream>
+std::thread forward(Loopback::Connection &upstream, Downstream &downstream) {
+    return std::thread([&upstream, &downstream]() {
+        upstream.setTimeout(300);
+        Bridge<Loopback::Connection, Downstream> bridge(upstream, downstream);
+        try {
+            while (true)
+                bridge.forwardOne();
+        } catch (const ModbusException &) {
+        }
+    });
+}
+} // namespace
+
+TEST(Transport, ClientReadWrite) {
+    auto [connection, server] = Loopback::Connection::pair();
+    RegisterBank bank(10, 0, 16, 0);
+    auto serving = serveBank(server, bank);
+
+    Client<Loopback::Connection> client(connection);
+    client.write(1, utils::WriteMultipleAnalogOutputHoldingRegisters, 4,
+                 {ModbusCell::initReg(7), ModbusCell::initReg(8)});
+    client.write(1, utils::WriteSingleDiscreteOutputCoil, 2,
+                 {ModbusCell::initCoil(true)});
+
+    const auto registers = client.read(1, utils::ReadAnalogOutputHoldingRegisters, 4, 2);
+    ASSERT_EQ(2, registers.size());
+    EXPECT_EQ(7, registers[0].reg());
+    EXPECT_EQ(8, registers[1].reg());
+
+    // Not padded to whole bytes
+    const auto coils = client.read(1, utils::ReadDiscreteOutputCoils, 0, 3);
+    ASSERT_EQ(3, coils.size());
+    EXPECT_TRUE(coils[2].coil());
+    EXPECT_FALSE(coils[1].coil());
+
+    EXPECT_THROW(client.read(1, utils::WriteSingleAnalogOutputRegister, 0, 1),
+                 std::invalid_argument);
+    EXPECT_THROW(client.write(1, utils::WriteSingleAnalogOutputRegister, 0, {}),
+                 std::invalid_argument);
+
+    serving.join();
+}
+
+TEST(Transport, PollerMergesTags) {
+    auto [connection, server] = Loopback::Connection::pair();
+    RegisterBank bank(0, 0, 0, 16);
+    bank.inputRegisters()[2] = 20;
+    bank.inputRegisters()[5] = 50;
+    auto serving             = serveBank(server, bank);
+
+    Poller<Loopback::Connection> poller(connection, 4);
+    std::vector<uint16_t> values;
+    const auto collect = [&](const std::vector<ModbusCell> &cells) {
+        for (const auto &cell : cells)
+            values.push_back(cell.reg());
+    };
+    poller.add(1, utils::ReadAnalogInputRegisters, 2, 1, collect);
+    poller.add(1, utils::ReadAnalogInputRegisters, 5, 1, collect);
+    // Past the end of the bank
+    poller.add(2, utils::ReadAnalogInputRegisters, 15, 2, collect);
+
+    int errors = 0;
+    poller.onError([&](const ModbusRequest &request, const ModbusException &ex) {
+        EXPECT_EQ(2, request.slaveID());
+        EXPECT_EQ(utils::IllegalDataAddress, ex.getErrorCode());
+        errors++;
+    });
+
+    EXPECT_EQ(2, poller.requestsPerCycle());
+    EXPECT_EQ(1, poller.poll());
+    EXPECT_EQ(1, errors);
+    EXPECT_EQ(std::vector<uint16_t>({20, 50}), values);
+
+    serving.join();
+}
+
+TEST(Transport, BridgeForwardsToBank) {
+    auto [connection, upstream]   = Loopback::Connection::pair();
+    auto [downstream, bankServer] = Loopback::Connection::pair();
+    RegisterBank bank(0, 0, 16, 0);
+    auto serving    = serveBank(bankServer, bank);
+    auto forwarding = forward(upstream, downstream);
+
+    Client<Loopback::Connection> client(connection);
+    client.write(1, utils::WriteSingleAnalogOutputRegister, 3, {ModbusCell::initReg(33)});
+    EXPECT_EQ(33, client.read(1, utils::ReadAnalogOutputHoldingRegisters, 3, 1)[0].reg());
+
+    // Exception responses of the target are forwarded
+    try {
+        (void)client.read(1, utils::ReadAnalogOutputHoldingRegisters, 15, 2);
+        FAIL() << "Exception response expected";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::IllegalDataAddress, ex.getErrorCode());
+    }
+
+    forwarding.join();
+    serving.join();
+}
+
+TEST(Transport, BridgeReportsSilentTarget) {
+    auto [connection, upstream] = Loopback::Connection::pair();
+    SilentTransport downstream;
+    auto forwarding = forward(upstream, downstream);
+
+    Client<Loopback::Connection> client(connection);
+    try {
+        (void)client.read(3, utils::ReadAnalogInputRegisters, 0, 1);
+        FAIL() << "Exception response expected";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::GatewayTargetDeviceFailedToRespond, ex.getErrorCode());
+        EXPECT_EQ(3, ex.slaveID());
+    }
+
+    // Broadcasts are forwarded and not answered
+    connection.sendRequest(ModbusRequest(0, utils::WriteSingleAnalogOutputRegister, 0, 1,
+                                         {ModbusCell::initReg(1)}));
+    forwarding.join();
+    EXPECT_EQ(2, downstream.sent);
+}
+
+TEST(Transport, ReadRangeSequential) {
+    RegisterBank bank(2500, 0, 0, 2000);
+    for (std::size_t i = 0; i < bank.inputRegisters().size(); i++)
+        bank.inputRegisters()[i] = static_cast<uint16_t>(i);
+    bank.coils()[2100] = 1;
+
+    BankTransport transport{bank, {}};
+    Client<BankTransport> client(transport);
+
+    const auto registers = client.readRange(1, utils::InputRegisters, 0, 2000);
+    ASSERT_EQ(2000, registers.size());
+    for (std::size_t i = 0; i < registers.size(); i++)
+        ASSERT_EQ(i, registers[i].reg());
+    ASSERT_EQ(16, transport.requests.size());
+    EXPECT_EQ(1875, transport.requests.back().registerAddress());
+    EXPECT_EQ(125, transport.requests.back().numberOfRegisters());
+
+    transport.requests.clear();
+    const auto coils = client.readRange(1, utils::OutputCoils, 100, 2400);
+    ASSERT_EQ(2400, coils.size());
+    EXPECT_TRUE(coils[2000].coil());
+    EXPECT_FALSE(coils[1999].coil());
+    ASSERT_EQ(2, transport.requests.size());
+    EXPECT_EQ(400, transport.requests.back().numberOfRegisters());
+
+    EXPECT_TRUE(client.readRange(1, utils::InputRegisters, 0, 0).empty());
+    EXPECT_THROW(client.readRange(1, utils::InputRegisters, 0xFFFF, 2),
+                 std::invalid_argument);
+}
+
+TEST(Transport, ReadRangePipelined) {
+    auto [connection, server] = Loopback::Connection::pair();
+    RegisterBank bank(0, 0, 2000, 0);
+    for (std::size_t i = 0; i < bank.holdingRegisters().size(); i++)
+        bank.holdingRegisters()[i] = static_cast<uint16_t>(i * 3);
+
+    // Holds every request until the next one comes (or 100 ms pass), which only
+    // pipelining client can satisfy
+    std::size_t mostOutstanding = 0;
+    std::thread serving([&server = server, &bank, &mostOutstanding]() {
+        server.setTimeout(100);
+        // Requests with their transaction ids
+        std::vector<std::pair<uint16_t, ModbusRequest>> outstanding;
+        while (true) {
+            try {
+                auto request =
+                    TransportTraits<Loopback::Connection>::awaitRequest(server);
+                outstanding.emplace_back(server.getMessageId(), std::move(request));
+                mostOutstanding = std::max(mostOutstanding, outstanding.size());
+                if (outstanding.size() < 2)
+                    continue;
+            } catch (const ModbusException &) {
+                if (outstanding.empty())
+                    return;
+            }
+
+            for (const auto &[id, request] : outstanding) {
+                server.setMessageId(id);
+                const auto result = bank.handle(request);
+                if (const auto *response = std::get_if<ModbusResponse>(&result))
+                    server.sendResponse(*response);
+                else
+                    server.sendException(std::get<ModbusException>(result));
+            }
+            outstanding.clear();
+        }
+    });
+
+    Client<Loopback::Connection> client(connection);
+    client.setPipelineDepth(8);
+    EXPECT_THROW(client.setPipelineDepth(0), std::invalid_argument);
+
+    const auto values = client.readRange(1, utils::HoldingRegisters, 0, 2000);
+    ASSERT_EQ(2000, values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+        ASSERT_EQ(static_cast<uint16_t>(i * 3), values[i].reg());
+
+    // Failed chunk, responses of the following chunks in flight are dropped
+    try {
+        (void)client.readRange(1, utils::HoldingRegisters, 1000, 1500);
+        FAIL() << "Exception response expected";
+    } catch (const ModbusException &ex) {
+        EXPECT_EQ(utils::IllegalDataAddress, ex.getErrorCode());
+    }
+    const auto after = client.read(1, utils::ReadAnalogOutputHoldingRegisters, 10, 1);
+    EXPECT_EQ(30, after[0].reg());
+
+    serving.join();
+    // Server has seen more than one request in flight at once
+    EXPECT_LT(1, mostOutstanding);
+}
@@ -0,0 +1,73 @@
+// Modbus for c++ <https://github.com/Mazurel/Modbus>
+// Copyright (c) 2024 Mateusz Mazur aka Mazurel
+// Licensed under: MIT License <http://opensource.org/licenses/MIT>
+
+#pragma once
+
+#include "MB/Serial/connection.hpp"
+#include "MB/Serial/server.hpp"
+#include "MB/Serial/virtualLink.hpp"
+#include "MB/metrics.hpp"
+#include "MB/registerBank.hpp"
+
+#include "gtest/gtest.h"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+//! Helpers of the tests that run over virtual serial lines
+namespace MB::Testing {
+//! Configured and connected end of the link
+inline Serial::Connection open(const std::string &path,
+                               unsigned int baudRate = 115200) {
+    Serial::Connection connection(path);
+    connection.setBaudRate(baudRate);
+    connection.connect();
+    return Serial::Connection(std::move(connection));
+}
+
+//! Listening socket on a free local port
+inline int listenLocal(int &port) {
+    const int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size          = sizeof(address);
+
+    if (sock < 0 || ::bind(sock, reinterpret_cast<sockaddr *>(&address), size) != 0 ||
+        ::listen(sock, 1) != 0 ||
+        ::getsockname(sock, reinterpret_cast<sockaddr *>(&address), &size) != 0)
+        throw std::runtime_error("Cannot listen");
+
+    port = ntohs(address.sin_port);
+    return sock;
+}
+
+//! Slave serving units 1 and 2 on the second end of the link
+class SerialServer : public ::testing::Test {
+  protected:
+    Serial::VirtualLink link;
+    RegisterBank first{0, 0, 10, 0};
+    RegisterBank second{0, 0, 10, 0};
+    Serial::Server server{open(link.second())};
+    std::shared_ptr<Metrics> metrics = std::make_shared<Metrics>();
+    std::thread serving;
+
+    void SetUp() override {
+        server.connection().setMetrics(metrics);
+        server.addUnit(1, first);
+        server.addUnit(2, second);
+        serving = std::thread([this]() { server.run(); });
+    }
+
+    void TearDown() override {
+        server.stop();
+        serving.join();
+    }
+};
+} // namespace MB::Testing